@@ -0,0 +1,115 @@
+#include "device_table.hpp"
+#include "../utils/logging.hpp"
+
+namespace mali_wrapper {
+
+/* Key of a slot whose device was removed while later slots of its chain were taken, lookups probe past it. */
+static const VkDevice REMOVED_DEVICE = reinterpret_cast<VkDevice>(static_cast<uintptr_t>(1));
+
+size_t DeviceTable::first_slot(VkDevice device) {
+    /* Handles are heap pointers, the low bits are alignment. */
+    const uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(device)) >> 4;
+    return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 58) & (SLOT_COUNT - 1);
+}
+
+void DeviceTable::add(VkDevice device, VkInstance instance, PFN_vkGetInstanceProcAddr mali_get_instance_proc_addr) {
+    MaliDevice entry;
+    entry.instance = instance;
+    if (mali_get_instance_proc_addr) {
+        entry.get_device_proc_addr = reinterpret_cast<PFN_vkGetDeviceProcAddr>(
+            mali_get_instance_proc_addr(instance, "vkGetDeviceProcAddr"));
+    }
+    if (entry.get_device_proc_addr) {
+        entry.destroy_device = reinterpret_cast<PFN_vkDestroyDevice>(
+            entry.get_device_proc_addr(device, "vkDestroyDevice"));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t slot = first_slot(device);
+    for (size_t probe = 0; probe < SLOT_COUNT; probe++, slot = (slot + 1) & (SLOT_COUNT - 1)) {
+        VkDevice key = slots_[slot].device.load(std::memory_order_relaxed);
+        if (key == VK_NULL_HANDLE || key == REMOVED_DEVICE || key == device) {
+            slots_[slot].entry = entry;
+            slots_[slot].device.store(device, std::memory_order_release);
+            return;
+        }
+    }
+
+    LOG_WARN("Too many devices for the device table, looking the extra ones up under a lock");
+    overflow_[device] = entry;
+    overflow_count_.store(overflow_.size(), std::memory_order_release);
+}
+
+void DeviceTable::remove(VkDevice device) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t slot = first_slot(device);
+    for (size_t probe = 0; probe < SLOT_COUNT; probe++, slot = (slot + 1) & (SLOT_COUNT - 1)) {
+        VkDevice key = slots_[slot].device.load(std::memory_order_relaxed);
+        if (key == VK_NULL_HANDLE) {
+            break;
+        }
+        if (key == device) {
+            /* No chain continues past a slot followed by an empty one, so it and the tombstones before it can be
+             * emptied and misses stop early again. Otherwise lookups have to keep probing past it. */
+            if (slots_[(slot + 1) & (SLOT_COUNT - 1)].device.load(std::memory_order_relaxed) != VK_NULL_HANDLE) {
+                slots_[slot].device.store(REMOVED_DEVICE, std::memory_order_release);
+                return;
+            }
+            for (size_t cleared = 0; cleared < SLOT_COUNT; cleared++, slot = (slot - 1) & (SLOT_COUNT - 1)) {
+                if (cleared != 0 && slots_[slot].device.load(std::memory_order_relaxed) != REMOVED_DEVICE) {
+                    break;
+                }
+                slots_[slot].device.store(VK_NULL_HANDLE, std::memory_order_release);
+            }
+            return;
+        }
+    }
+
+    if (overflow_.erase(device) != 0) {
+        overflow_count_.store(overflow_.size(), std::memory_order_release);
+    }
+}
+
+const MaliDevice* DeviceTable::find(VkDevice device) const {
+    if (device == VK_NULL_HANDLE) {
+        return nullptr;
+    }
+
+    size_t slot = first_slot(device);
+    for (size_t probe = 0; probe < SLOT_COUNT; probe++, slot = (slot + 1) & (SLOT_COUNT - 1)) {
+        VkDevice key = slots_[slot].device.load(std::memory_order_acquire);
+        if (key == device) {
+            return &slots_[slot].entry;
+        }
+        if (key == VK_NULL_HANDLE) {
+            break;
+        }
+    }
+
+    if (overflow_count_.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = overflow_.find(device);
+    return it != overflow_.end() ? &it->second : nullptr;
+}
+
+std::vector<VkDevice> DeviceTable::devices_of(VkInstance instance) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<VkDevice> devices;
+    for (const Slot& slot : slots_) {
+        VkDevice key = slot.device.load(std::memory_order_relaxed);
+        if (key != VK_NULL_HANDLE && key != REMOVED_DEVICE && slot.entry.instance == instance) {
+            devices.push_back(key);
+        }
+    }
+    for (const auto& overflow : overflow_) {
+        if (overflow.second.instance == instance) {
+            devices.push_back(overflow.first);
+        }
+    }
+    return devices;
+}
+
+} // namespace mali_wrapper
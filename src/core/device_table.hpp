@@ -0,0 +1,69 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace mali_wrapper {
+
+/**
+ * @brief Mali driver state of a device, resolved once when the device is created.
+ */
+struct MaliDevice {
+    VkInstance instance = VK_NULL_HANDLE;
+    PFN_vkGetDeviceProcAddr get_device_proc_addr = nullptr;
+    PFN_vkDestroyDevice destroy_device = nullptr;
+};
+
+/**
+ * @brief Devices created through the Mali driver, found without taking a lock.
+ *
+ * Open addressing over a fixed number of slots. Adding and removing devices is serialized by a mutex, lookups
+ * only load the slot keys: a slot's entry is written before its key is published and stays untouched until the
+ * device is removed, which the application may not do while it still queries the device. Devices that do not fit
+ * are kept in a map looked up under the mutex, so every device keeps its record.
+ */
+class DeviceTable {
+public:
+    /**
+     * @brief Register a device, resolving its Mali entrypoints through @p instance.
+     */
+    void add(VkDevice device, VkInstance instance, PFN_vkGetInstanceProcAddr mali_get_instance_proc_addr);
+
+    void remove(VkDevice device);
+
+    /**
+     * @brief Find a registered device, lock-free unless the table has overflowed.
+     *
+     * @return The device's Mali state, or nullptr if it was not created through the wrapper.
+     */
+    const MaliDevice* find(VkDevice device) const;
+
+    /**
+     * @brief Devices created from an instance, to clean them up with it.
+     */
+    std::vector<VkDevice> devices_of(VkInstance instance) const;
+
+private:
+    static constexpr size_t SLOT_COUNT = 64;
+
+    struct Slot {
+        std::atomic<VkDevice> device{ VK_NULL_HANDLE };
+        MaliDevice entry;
+    };
+
+    static size_t first_slot(VkDevice device);
+
+    Slot slots_[SLOT_COUNT];
+    mutable std::mutex mutex_;
+
+    /* Devices beyond SLOT_COUNT, guarded by mutex_. Map nodes are stable, so entries can be handed out. */
+    std::unordered_map<VkDevice, MaliDevice> overflow_;
+    std::atomic<size_t> overflow_count_{ 0 };
+};
+
+} // namespace mali_wrapper
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "wsi/layer_utils/name_hash.hpp"
+
+namespace mali_wrapper {
+
+/**
+ * @brief Who answers GetProcAddr queries for an entrypoint the wrapper knows by name.
+ */
+enum class EntrypointOwner : uint8_t {
+    Icd,              // Implemented by the wrapper ICD itself
+    Wsi,              // Implemented by the WSIManager
+    WsiUnimplemented, // Claimed by the WSIManager without an implementation, device queries get nullptr
+    Driver,           // Resolved by the Mali driver, only listed to be hidden from its own GetProcAddr
+};
+
+/**
+ * @brief Every entrypoint the wrapper treats specially.
+ *
+ * EP(name without the vk prefix, owner, hidden from the Mali driver's GetProcAddr)
+ */
+#define MALI_WRAPPER_ENTRYPOINTS(EP)                                            \
+    /* Wrapper ICD */                                                           \
+    EP(GetInstanceProcAddr, Icd, false)                                         \
+    EP(GetDeviceProcAddr, Icd, false)                                           \
+    EP(CreateInstance, Icd, false)                                              \
+    EP(DestroyInstance, Icd, false)                                             \
+    EP(EnumerateInstanceExtensionProperties, Icd, false)                        \
+    EP(CreateDevice, Icd, false)                                                \
+    EP(DestroyDevice, Icd, false)                                               \
+    /* Surface */                                                               \
+    EP(CreateXlibSurfaceKHR, Wsi, true)                                         \
+    EP(CreateXcbSurfaceKHR, Wsi, true)                                          \
+    EP(CreateWaylandSurfaceKHR, Wsi, true)                                      \
+    EP(CreateHeadlessSurfaceEXT, Wsi, true)                                     \
+    EP(CreateDisplaySurfaceKHR, WsiUnimplemented, true)                         \
+    EP(DestroySurfaceKHR, Wsi, true)                                            \
+    EP(GetPhysicalDeviceSurfaceSupportKHR, Wsi, true)                           \
+    EP(GetPhysicalDeviceSurfaceCapabilitiesKHR, Wsi, true)                      \
+    EP(GetPhysicalDeviceSurfaceCapabilities2KHR, Wsi, true)                     \
+    EP(GetPhysicalDeviceSurfaceFormatsKHR, Wsi, true)                           \
+    EP(GetPhysicalDeviceSurfaceFormats2KHR, Wsi, true)                          \
+    EP(GetPhysicalDeviceSurfacePresentModesKHR, Wsi, true)                      \
+    /* Presentation support */                                                  \
+    EP(GetPhysicalDeviceWaylandPresentationSupportKHR, Wsi, true)               \
+    EP(GetPhysicalDeviceXlibPresentationSupportKHR, Driver, true)               \
+    EP(GetPhysicalDeviceXcbPresentationSupportKHR, Driver, true)                \
+    /* Swapchain */                                                             \
+    EP(CreateSwapchainKHR, Wsi, true)                                           \
+    EP(CreateSharedSwapchainsKHR, Driver, true)                                 \
+    EP(DestroySwapchainKHR, Wsi, true)                                          \
+    EP(GetSwapchainImagesKHR, Wsi, true)                                        \
+    EP(AcquireNextImageKHR, Wsi, true)                                          \
+    EP(AcquireNextImage2KHR, Wsi, true)                                         \
+    EP(QueuePresentKHR, Wsi, true)                                              \
+    EP(GetSwapchainStatusKHR, Wsi, true)                                        \
+    EP(ReleaseSwapchainImagesEXT, Driver, true)                                 \
+    /* Device groups */                                                         \
+    EP(GetDeviceGroupPresentCapabilitiesKHR, WsiUnimplemented, false)           \
+    EP(GetDeviceGroupSurfacePresentModesKHR, WsiUnimplemented, false)           \
+    EP(GetPhysicalDevicePresentRectanglesKHR, WsiUnimplemented, false)          \
+    /* Display */                                                               \
+    EP(GetPhysicalDeviceDisplayPropertiesKHR, Driver, true)                     \
+    EP(GetPhysicalDeviceDisplayProperties2KHR, Driver, true)                    \
+    EP(GetPhysicalDeviceDisplayPlanePropertiesKHR, Driver, true)                \
+    EP(GetPhysicalDeviceDisplayPlaneProperties2KHR, Driver, true)               \
+    EP(GetDisplayPlaneSupportedDisplaysKHR, Driver, true)                       \
+    EP(GetDisplayModePropertiesKHR, Driver, true)                               \
+    EP(GetDisplayModeProperties2KHR, Driver, true)                              \
+    EP(CreateDisplayModeKHR, Driver, true)                                      \
+    EP(GetDisplayPlaneCapabilitiesKHR, Driver, true)                            \
+    EP(GetDisplayPlaneCapabilities2KHR, Driver, true)                           \
+    /* Present timing */                                                        \
+    EP(GetSwapchainTimingPropertiesEXT, Driver, true)                           \
+    EP(GetSwapchainTimeDomainPropertiesEXT, Driver, true)                       \
+    EP(GetPastPresentationTimingEXT, Driver, true)                              \
+    EP(SetSwapchainPresentTimingQueueSizeEXT, Driver, true)
+
+enum class EntrypointId : uint8_t {
+#define MALI_WRAPPER_ENTRYPOINT_ID(name, owner, hidden) name,
+    MALI_WRAPPER_ENTRYPOINTS(MALI_WRAPPER_ENTRYPOINT_ID)
+#undef MALI_WRAPPER_ENTRYPOINT_ID
+    Count
+};
+
+struct Entrypoint {
+    const char* name;
+    EntrypointId id;
+    EntrypointOwner owner;
+    bool hidden_from_driver;
+};
+
+inline constexpr Entrypoint entrypoints[] = {
+#define MALI_WRAPPER_ENTRYPOINT_ENTRY(name, owner, hidden) \
+    { "vk" #name, EntrypointId::name, EntrypointOwner::owner, hidden },
+    MALI_WRAPPER_ENTRYPOINTS(MALI_WRAPPER_ENTRYPOINT_ENTRY)
+#undef MALI_WRAPPER_ENTRYPOINT_ENTRY
+};
+
+namespace entrypoint_hash {
+
+inline constexpr const char* names[] = {
+#define MALI_WRAPPER_ENTRYPOINT_NAME(name, owner, hidden) "vk" #name,
+    MALI_WRAPPER_ENTRYPOINTS(MALI_WRAPPER_ENTRYPOINT_NAME)
+#undef MALI_WRAPPER_ENTRYPOINT_NAME
+};
+
+using Table = util::perfect_name_hash<256>;
+
+inline constexpr Table table = Table::build(names);
+static_assert(table.is_valid(), "No collision free seed for the entrypoint names, grow the table");
+
+} // namespace entrypoint_hash
+
+/**
+ * @brief Look up an entrypoint by name with one hash and at most one string compare.
+ *
+ * @return The entrypoint, or nullptr for names the wrapper passes through to the Mali driver untouched.
+ */
+inline const Entrypoint* find_entrypoint(const char* name) {
+    const size_t index = entrypoint_hash::table.find(name);
+    if (index == entrypoint_hash::Table::not_found) {
+        return nullptr;
+    }
+    return &entrypoints[index];
+}
+
+} // namespace mali_wrapper
@@ -1,6 +1,8 @@
 #include "mali_wrapper_icd.hpp"
 #include "library_loader.hpp"
 #include "wsi_manager.hpp"
+#include "entrypoint_table.hpp"
+#include "device_table.hpp"
 #include "wsi/wsi_private_data.hpp"
 #include "wsi/wsi_factory.hpp"
 #include "wsi/layer_utils/extension_list.hpp"
@@ -33,7 +35,7 @@ struct InstanceInfo {
 };
 
 static std::unordered_map<VkInstance, std::unique_ptr<InstanceInfo>> managed_instances;
-static std::unordered_map<VkDevice, VkInstance> managed_devices;
+static DeviceTable managed_devices;
 static std::mutex instance_mutex;
 static VkInstance latest_instance = VK_NULL_HANDLE;
 
@@ -74,10 +76,10 @@ bool is_instance_valid(VkInstance instance) {
 
 static VkInstance get_device_parent_instance(VkDevice device)
 {
-    auto it = managed_devices.find(device);
-    if (it != managed_devices.end())
+    const MaliDevice* mali_device = managed_devices.find(device);
+    if (mali_device != nullptr)
     {
-        return it->second;
+        return mali_device->instance;
     }
 
     std::lock_guard<std::mutex> lock(instance_mutex);
@@ -99,58 +101,11 @@ static VkInstance get_device_parent_instance(VkDevice device)
 }
 
 
-static const std::unordered_set<std::string> wsi_functions = {
-    // Surface functions
-    "vkCreateXlibSurfaceKHR",
-    "vkCreateXcbSurfaceKHR",
-    "vkCreateWaylandSurfaceKHR",
-    "vkCreateDisplaySurfaceKHR",
-    "vkCreateHeadlessSurfaceEXT",
-    "vkDestroySurfaceKHR",
-    "vkGetPhysicalDeviceSurfaceSupportKHR",
-    "vkGetPhysicalDeviceSurfaceCapabilitiesKHR",
-    "vkGetPhysicalDeviceSurfaceCapabilities2KHR",
-    "vkGetPhysicalDeviceSurfaceFormatsKHR",
-    "vkGetPhysicalDeviceSurfaceFormats2KHR",
-    "vkGetPhysicalDeviceSurfacePresentModesKHR",
-
-    // Swapchain functions
-    "vkCreateSwapchainKHR",
-    "vkCreateSharedSwapchainsKHR",
-    "vkDestroySwapchainKHR",
-    "vkGetSwapchainImagesKHR",
-    "vkAcquireNextImageKHR",
-    "vkAcquireNextImage2KHR",
-    "vkQueuePresentKHR",
-    "vkGetSwapchainStatusKHR",
-    "vkReleaseSwapchainImagesEXT",
-
-    // Display functions
-    "vkGetPhysicalDeviceDisplayPropertiesKHR",
-    "vkGetPhysicalDeviceDisplayProperties2KHR",
-    "vkGetPhysicalDeviceDisplayPlanePropertiesKHR",
-    "vkGetPhysicalDeviceDisplayPlaneProperties2KHR",
-    "vkGetDisplayPlaneSupportedDisplaysKHR",
-    "vkGetDisplayModePropertiesKHR",
-    "vkGetDisplayModeProperties2KHR",
-    "vkCreateDisplayModeKHR",
-    "vkGetDisplayPlaneCapabilitiesKHR",
-    "vkGetDisplayPlaneCapabilities2KHR",
-
-    // Present timing functions
-    "vkGetSwapchainTimingPropertiesEXT",
-    "vkGetSwapchainTimeDomainPropertiesEXT",
-    "vkGetPastPresentationTimingEXT",
-    "vkSetSwapchainPresentTimingQueueSizeEXT",
-
-    // Presentation support functions
-    "vkGetPhysicalDeviceWaylandPresentationSupportKHR",
-    "vkGetPhysicalDeviceXlibPresentationSupportKHR",
-    "vkGetPhysicalDeviceXcbPresentationSupportKHR"
-};
-
-static bool IsWSIFunction(const char* name) {
-    return wsi_functions.find(name) != wsi_functions.end();
+/**
+ * @brief Whether the Mali driver's own implementation of an entrypoint must not leak to the application.
+ */
+static bool IsWSIFunction(const Entrypoint* entrypoint) {
+    return entrypoint && entrypoint->hidden_from_driver;
 }
 
 bool InitializeWrapper() {
@@ -197,11 +152,12 @@ static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL filtered_mali_get_instance_proc_
     }
 
 
-    if (IsWSIFunction(pName)) {
+    const Entrypoint* entrypoint = find_entrypoint(pName);
+    if (IsWSIFunction(entrypoint)) {
         return nullptr;
     }
 
-    if (strcmp(pName, "vkCreateDevice") == 0) {
+    if (entrypoint && entrypoint->id == EntrypointId::CreateDevice) {
         return reinterpret_cast<PFN_vkVoidFunction>(mali_driver_create_device);
     }
 
@@ -390,13 +346,9 @@ static VKAPI_ATTR void VKAPI_CALL internal_vkDestroyInstance(
     }
 
     // Cleanup associated devices
-    for (auto dev_it = managed_devices.begin(); dev_it != managed_devices.end(); ) {
-        if (dev_it->second == instance) {
-            GetWSIManager().release_device(dev_it->first);
-            dev_it = managed_devices.erase(dev_it);
-        } else {
-            ++dev_it;
-        }
+    for (VkDevice device : managed_devices.devices_of(instance)) {
+        GetWSIManager().release_device(device);
+        managed_devices.remove(device);
     }
 
     auto mali_proc_addr = LibraryLoader::Instance().GetMaliGetInstanceProcAddr();
@@ -506,38 +458,29 @@ static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL internal_vkGetInstanceProcAddr(V
     }
 
 
-    if (strcmp(pName, "vkGetInstanceProcAddr") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkGetInstanceProcAddr);
-    }
-
-    if (strcmp(pName, "vkCreateInstance") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkCreateInstance);
-    }
-
-    if (strcmp(pName, "vkDestroyInstance") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkDestroyInstance);
-    }
-
-    if (strcmp(pName, "vkDestroyDevice") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkDestroyDevice);
-    }
-
-    if (strcmp(pName, "vkEnumerateInstanceExtensionProperties") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkEnumerateInstanceExtensionProperties);
-    }
-
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkGetDeviceProcAddr);
-    }
-
-    if (strcmp(pName, "vkCreateDevice") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkCreateDevice);
-    }
+    const Entrypoint* entrypoint = find_entrypoint(pName);
+    if (entrypoint) {
+        switch (entrypoint->id) {
+        case EntrypointId::GetInstanceProcAddr:
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkGetInstanceProcAddr);
+        case EntrypointId::CreateInstance:
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkCreateInstance);
+        case EntrypointId::DestroyInstance:
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkDestroyInstance);
+        case EntrypointId::DestroyDevice:
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkDestroyDevice);
+        case EntrypointId::EnumerateInstanceExtensionProperties:
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkEnumerateInstanceExtensionProperties);
+        case EntrypointId::GetDeviceProcAddr:
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkGetDeviceProcAddr);
+        case EntrypointId::CreateDevice:
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkCreateDevice);
+        default:
+            break;
+        }
 
-    if (GetWSIManager().is_wsi_function(pName)) {
-        auto func = GetWSIManager().get_function_pointer(pName);
-        if (func) {
-            return func;
+        if (entrypoint->owner == EntrypointOwner::Wsi) {
+            return GetWSIManager().get_function_pointer(entrypoint->id);
         }
     }
 
@@ -565,31 +508,34 @@ static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL internal_vkGetDeviceProcAddr(VkD
         return nullptr;
     }
 
-    uintptr_t device_ptr = reinterpret_cast<uintptr_t>(device);
-    char hex_buffer[32];
-    snprintf(hex_buffer, sizeof(hex_buffer), "0x%lx", device_ptr);
+    const Entrypoint* entrypoint = find_entrypoint(pName);
+    if (entrypoint) {
+        if (entrypoint->id == EntrypointId::DestroyDevice) {
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkDestroyDevice);
+        }
 
-    if (strcmp(pName, "vkDestroyDevice") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkDestroyDevice);
-    }
+        if (entrypoint->owner == EntrypointOwner::Wsi) {
+            return GetWSIManager().get_function_pointer(entrypoint->id);
+        }
 
-    if (GetWSIManager().is_wsi_function(pName)) {
-        auto func = GetWSIManager().get_function_pointer(pName);
-        if (func) {
-            return func;
-        } else {
+        if (entrypoint->owner == EntrypointOwner::WsiUnimplemented) {
             return nullptr;
         }
-    }
 
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) {
-        return reinterpret_cast<PFN_vkVoidFunction>(internal_vkGetDeviceProcAddr);
+        if (entrypoint->id == EntrypointId::GetDeviceProcAddr) {
+            return reinterpret_cast<PFN_vkVoidFunction>(internal_vkGetDeviceProcAddr);
+        }
     }
 
     if (strstr(pName, "RayTracing") || strstr(pName, "MeshTask")) {
         return nullptr;
     }
 
+    const MaliDevice* mali_device = managed_devices.find(device);
+    if (mali_device) {
+        return mali_device->get_device_proc_addr ? mali_device->get_device_proc_addr(device, pName) : nullptr;
+    }
+
     auto mali_proc_addr = LibraryLoader::Instance().GetMaliGetInstanceProcAddr();
     if (mali_proc_addr) {
         VkInstance parent_instance = get_device_parent_instance(device);
@@ -648,14 +594,20 @@ static VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL filtered_mali_get_device_proc_ad
         return nullptr;
     }
 
-    if (IsWSIFunction(pName)) {
+    const Entrypoint* entrypoint = find_entrypoint(pName);
+    if (IsWSIFunction(entrypoint)) {
         return nullptr;
     }
 
-    if (strcmp(pName, "vkGetDeviceProcAddr") == 0) {
+    if (entrypoint && entrypoint->id == EntrypointId::GetDeviceProcAddr) {
         return reinterpret_cast<PFN_vkVoidFunction>(internal_vkGetDeviceProcAddr);
     }
 
+    const MaliDevice* mali_device = managed_devices.find(device);
+    if (mali_device) {
+        return mali_device->get_device_proc_addr ? mali_device->get_device_proc_addr(device, pName) : nullptr;
+    }
+
     auto mali_proc_addr = LibraryLoader::Instance().GetMaliGetInstanceProcAddr();
     if (mali_proc_addr) {
         VkInstance parent_instance = get_device_parent_instance(device);
@@ -789,7 +741,7 @@ static VKAPI_ATTR VkResult VKAPI_CALL internal_vkCreateDevice(
     if (result == VK_SUCCESS) {
         LOG_INFO("Device created successfully through Mali driver");
 
-        managed_devices.emplace(*pDevice, mali_instance);
+        managed_devices.add(*pDevice, mali_instance, mali_proc_addr);
 
         VkInstance target_mali_instance = mali_instance;
         {
@@ -841,16 +793,17 @@ static VKAPI_ATTR void VKAPI_CALL internal_vkDestroyDevice(
 
     VkInstance parent_instance = get_device_parent_instance(device);
 
-    if (managed_devices.find(device) == managed_devices.end()) {
+    const MaliDevice* mali_device = managed_devices.find(device);
+    if (!mali_device) {
         LOG_WARN("Destroying unmanaged device");
     }
 
     GetWSIManager().release_device(device);
 
     auto mali_proc_addr = LibraryLoader::Instance().GetMaliGetInstanceProcAddr();
-    PFN_vkDestroyDevice mali_destroy = nullptr;
+    PFN_vkDestroyDevice mali_destroy = mali_device ? mali_device->destroy_device : nullptr;
 
-    if (mali_proc_addr && parent_instance != VK_NULL_HANDLE) {
+    if (!mali_destroy && mali_proc_addr && parent_instance != VK_NULL_HANDLE) {
         auto mali_get_device_proc_addr = reinterpret_cast<PFN_vkGetDeviceProcAddr>(
             mali_proc_addr(parent_instance, "vkGetDeviceProcAddr"));
         if (mali_get_device_proc_addr) {
@@ -871,7 +824,7 @@ static VKAPI_ATTR void VKAPI_CALL internal_vkDestroyDevice(
         LOG_WARN("Failed to locate Mali vkDestroyDevice entry point");
     }
 
-    managed_devices.erase(device);
+    managed_devices.remove(device);
 }
 
 static VKAPI_ATTR VkResult VKAPI_CALL mali_driver_create_device(
@@ -941,7 +894,7 @@ static VKAPI_ATTR VkResult VKAPI_CALL mali_driver_create_device(
             }
         }
 
-        managed_devices.emplace(*pDevice, mali_instance);
+        managed_devices.add(*pDevice, mali_instance, mali_proc_addr);
 
         VkResult wsi_result = GetWSIManager().init_device(target_mali_instance, physicalDevice, *pDevice,
                                                          pCreateInfo->ppEnabledExtensionNames, pCreateInfo->enabledExtensionCount);
@@ -4,6 +4,7 @@
 #include "wsi/surface_api.hpp"
 #include "wsi/swapchain_api.hpp"
 #include "wsi/wsi_private_data.hpp"
+#include "wsi/host_memory_ranking.hpp"
 #include <vulkan/vk_layer.h>
 #include "wsi/wayland/surface_properties.hpp"
 #include "../utils/logging.hpp"
@@ -292,6 +293,9 @@ void WSIManager::cleanup() {
     pImpl->devices.clear();
 
     for (const auto &entry : pImpl->instances) {
+#if BUILD_WSI_X11
+        wsi::forget_host_memory_rankings(entry.first);
+#endif
         instance_private_data::disassociate(entry.first);
     }
     pImpl->instances.clear();
@@ -328,6 +332,11 @@ void WSIManager::release_instance(VkInstance instance) {
         pImpl->instances.erase(instance);
     }
 
+#if BUILD_WSI_X11
+    /* Physical device handles of a later instance may reuse the values of this one's. */
+    wsi::forget_host_memory_rankings(instance);
+#endif
+
     if (instance_private_data::try_get(instance) == nullptr)
     {
         mali_wrapper::Logger::Instance().Debug([instance]{
@@ -604,41 +613,6 @@ VkResult WSIManager::get_physical_device_present_rectangles(VkPhysicalDevice phy
     return wsi_GetPhysicalDevicePresentRectanglesKHR(physicalDevice, surface, pRectCount, pRects);
 }
 
-bool WSIManager::is_wsi_function(const char* function_name) {
-    if (!function_name) return false;
-
-    // Surface functions
-    if (strcmp(function_name, "vkCreateXlibSurfaceKHR") == 0) return true;
-    if (strcmp(function_name, "vkCreateXcbSurfaceKHR") == 0) return true;
-    if (strcmp(function_name, "vkCreateWaylandSurfaceKHR") == 0) return true;
-    if (strcmp(function_name, "vkCreateDisplaySurfaceKHR") == 0) return true;
-    if (strcmp(function_name, "vkCreateHeadlessSurfaceEXT") == 0) return true;
-    if (strcmp(function_name, "vkDestroySurfaceKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceSupportKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceCapabilities2KHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceFormatsKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceFormats2KHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfacePresentModesKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDeviceWaylandPresentationSupportKHR") == 0) return true;
-
-    // Swapchain functions
-    if (strcmp(function_name, "vkCreateSwapchainKHR") == 0) return true;
-    if (strcmp(function_name, "vkDestroySwapchainKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetSwapchainImagesKHR") == 0) return true;
-    if (strcmp(function_name, "vkAcquireNextImageKHR") == 0) return true;
-    if (strcmp(function_name, "vkAcquireNextImage2KHR") == 0) return true;
-    if (strcmp(function_name, "vkQueuePresentKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetSwapchainStatusKHR") == 0) return true;
-
-    // Device group functions
-    if (strcmp(function_name, "vkGetDeviceGroupPresentCapabilitiesKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetDeviceGroupSurfacePresentModesKHR") == 0) return true;
-    if (strcmp(function_name, "vkGetPhysicalDevicePresentRectanglesKHR") == 0) return true;
-
-    return false;
-}
-
 static VKAPI_ATTR VkResult VKAPI_CALL static_vkCreateXcbSurfaceKHR(VkInstance instance, const VkXcbSurfaceCreateInfoKHR* pCreateInfo, const VkAllocationCallbacks* pAllocator, VkSurfaceKHR* pSurface) {
     return GetWSIManager().create_surface_xcb(instance, pCreateInfo, pAllocator, pSurface);
 }
@@ -715,75 +689,54 @@ static VKAPI_ATTR VkResult VKAPI_CALL static_vkGetSwapchainStatusKHR(VkDevice de
     return GetWSIManager().get_swapchain_status(device, swapchain);
 }
 
-PFN_vkVoidFunction WSIManager::get_function_pointer(const char* function_name) {
-    if (!function_name || !is_wsi_function(function_name)) {
-        return nullptr;
-    }
-
+PFN_vkVoidFunction WSIManager::get_function_pointer(EntrypointId id) {
+    switch (id) {
     // Surface creation functions
-    if (strcmp(function_name, "vkCreateXcbSurfaceKHR") == 0) {
+    case EntrypointId::CreateXcbSurfaceKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkCreateXcbSurfaceKHR);
-    }
-    if (strcmp(function_name, "vkCreateXlibSurfaceKHR") == 0) {
+    case EntrypointId::CreateXlibSurfaceKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkCreateXlibSurfaceKHR);
-    }
-    if (strcmp(function_name, "vkCreateWaylandSurfaceKHR") == 0) {
+    case EntrypointId::CreateWaylandSurfaceKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkCreateWaylandSurfaceKHR);
-    }
-    if (strcmp(function_name, "vkCreateHeadlessSurfaceEXT") == 0) {
+    case EntrypointId::CreateHeadlessSurfaceEXT:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkCreateHeadlessSurfaceEXT);
-    }
-    if (strcmp(function_name, "vkDestroySurfaceKHR") == 0) {
+    case EntrypointId::DestroySurfaceKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkDestroySurfaceKHR);
-    }
 
     // Surface property functions
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceSupportKHR") == 0) {
+    case EntrypointId::GetPhysicalDeviceSurfaceSupportKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetPhysicalDeviceSurfaceSupportKHR);
-    }
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceCapabilitiesKHR") == 0) {
+    case EntrypointId::GetPhysicalDeviceSurfaceCapabilitiesKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetPhysicalDeviceSurfaceCapabilitiesKHR);
-    }
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceCapabilities2KHR") == 0) {
+    case EntrypointId::GetPhysicalDeviceSurfaceCapabilities2KHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetPhysicalDeviceSurfaceCapabilities2KHR);
-    }
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceFormatsKHR") == 0) {
+    case EntrypointId::GetPhysicalDeviceSurfaceFormatsKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetPhysicalDeviceSurfaceFormatsKHR);
-    }
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfaceFormats2KHR") == 0) {
+    case EntrypointId::GetPhysicalDeviceSurfaceFormats2KHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetPhysicalDeviceSurfaceFormats2KHR);
-    }
-    if (strcmp(function_name, "vkGetPhysicalDeviceSurfacePresentModesKHR") == 0) {
+    case EntrypointId::GetPhysicalDeviceSurfacePresentModesKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetPhysicalDeviceSurfacePresentModesKHR);
-    }
-    if (strcmp(function_name, "vkGetPhysicalDeviceWaylandPresentationSupportKHR") == 0) {
+    case EntrypointId::GetPhysicalDeviceWaylandPresentationSupportKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetPhysicalDeviceWaylandPresentationSupportKHR);
-    }
 
     // Swapchain functions
-    if (strcmp(function_name, "vkCreateSwapchainKHR") == 0) {
+    case EntrypointId::CreateSwapchainKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkCreateSwapchainKHR);
-    }
-    if (strcmp(function_name, "vkDestroySwapchainKHR") == 0) {
+    case EntrypointId::DestroySwapchainKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkDestroySwapchainKHR);
-    }
-    if (strcmp(function_name, "vkGetSwapchainImagesKHR") == 0) {
+    case EntrypointId::GetSwapchainImagesKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetSwapchainImagesKHR);
-    }
-    if (strcmp(function_name, "vkAcquireNextImageKHR") == 0) {
+    case EntrypointId::AcquireNextImageKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkAcquireNextImageKHR);
-    }
-    if (strcmp(function_name, "vkAcquireNextImage2KHR") == 0) {
+    case EntrypointId::AcquireNextImage2KHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkAcquireNextImage2KHR);
-    }
-    if (strcmp(function_name, "vkQueuePresentKHR") == 0) {
+    case EntrypointId::QueuePresentKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkQueuePresentKHR);
-    }
-    if (strcmp(function_name, "vkGetSwapchainStatusKHR") == 0) {
+    case EntrypointId::GetSwapchainStatusKHR:
         return reinterpret_cast<PFN_vkVoidFunction>(static_vkGetSwapchainStatusKHR);
+    default:
+        return nullptr;
     }
-
-    return nullptr;
 }
 
 
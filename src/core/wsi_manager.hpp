@@ -5,6 +5,8 @@
 #include <memory>
 #include <unordered_map>
 
+#include "entrypoint_table.hpp"
+
 namespace mali_wrapper {
 
 class instance_private_data;
@@ -78,8 +80,10 @@ public:
     VkResult get_physical_device_present_rectangles(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface,
                                                    uint32_t* pRectCount, VkRect2D* pRects);
 
-    bool is_wsi_function(const char* function_name);
-    PFN_vkVoidFunction get_function_pointer(const char* function_name);
+    /**
+     * @brief Implementation of an entrypoint owned by the WSIManager, see EntrypointOwner::Wsi.
+     */
+    PFN_vkVoidFunction get_function_pointer(EntrypointId id);
 
 
     instance_private_data* lookup_instance(VkInstance instance);
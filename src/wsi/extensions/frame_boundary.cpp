@@ -86,9 +86,9 @@ VkFrameBoundaryEXT wsi_ext_frame_boundary::create_frame_boundary(VkImage *image)
    frame_boundary.sType = VK_STRUCTURE_TYPE_FRAME_BOUNDARY_EXT;
    frame_boundary.flags = VK_FRAME_BOUNDARY_FRAME_END_BIT_EXT;
    /* Number of presented images by swapchain as the frame boundary
-    * would not work as when the page flip thread is running, the
+    * would not work as when page flipping is scheduled, the
     * number frame ID could remain the same until the image is picked
-    * up by the thread so we use our own counter for the frame boundary. */
+    * up by the scheduler so we use our own counter for the frame boundary. */
    frame_boundary.frameID = m_current_frame_boundary_id++;
    frame_boundary.imageCount = 1;
    frame_boundary.pImages = image;
@@ -112,6 +112,10 @@ VkResult wsi_ext_swapchain_maintenance1::handle_scaling_create_info(
       {
          return VK_ERROR_INITIALIZATION_FAILED;
       }
+
+      m_scaling_behavior = present_scaling_create_info->scalingBehavior;
+      m_present_gravity_x = present_scaling_create_info->presentGravityX;
+      m_present_gravity_y = present_scaling_create_info->presentGravityY;
    }
    return VK_SUCCESS;
 }
@@ -96,6 +96,30 @@ public:
    VkResult handle_scaling_create_info(VkDevice device, const VkSwapchainCreateInfoKHR *swapchain_create_info,
                                        const VkSurfaceKHR surface);
 
+   /**
+    * @brief Scaling behavior requested through VkSwapchainPresentScalingCreateInfoEXT, 0 if none.
+    */
+   VkPresentScalingFlagsEXT get_scaling_behavior() const
+   {
+      return m_scaling_behavior;
+   }
+
+   /**
+    * @brief Horizontal gravity requested through VkSwapchainPresentScalingCreateInfoEXT, 0 if none.
+    */
+   VkPresentGravityFlagsEXT get_present_gravity_x() const
+   {
+      return m_present_gravity_x;
+   }
+
+   /**
+    * @brief Vertical gravity requested through VkSwapchainPresentScalingCreateInfoEXT, 0 if none.
+    */
+   VkPresentGravityFlagsEXT get_present_gravity_y() const
+   {
+      return m_present_gravity_y;
+   }
+
 private:
    /**
     * @brief Possible presentation modes this swapchain is allowed to present with VkSwapchainPresentModesCreateInfoEXT
@@ -106,6 +130,13 @@ private:
     * @brief Present mode currently being used for this swapchain
     */
    VkPresentModeKHR m_present_mode;
+
+   /**
+    * @brief Scaling and gravity from VkSwapchainPresentScalingCreateInfoEXT
+    */
+   VkPresentScalingFlagsEXT m_scaling_behavior{ 0 };
+   VkPresentGravityFlagsEXT m_present_gravity_x{ 0 };
+   VkPresentGravityFlagsEXT m_present_gravity_y{ 0 };
 };
 
 } /* namespace wsi */
@@ -23,6 +23,7 @@
  */
 
 #include "external_memory.hpp"
+#include "host_memory_ranking.hpp"
 
 #include <cassert>
 #include <cstdint>
@@ -52,6 +53,7 @@ external_memory::~external_memory()
          break;
          
       case wsi_memory_type::HOST_VISIBLE:
+      case wsi_memory_type::EXTERNAL_HOST_POINTER:
          cleanup_host_visible_memory();
          break;
          
@@ -85,6 +87,9 @@ bool external_memory::is_valid() const
          
       case wsi_memory_type::HOST_VISIBLE:
          return m_required_props != 0;
+
+      case wsi_memory_type::EXTERNAL_HOST_POINTER:
+         return m_host_pointer != nullptr && m_host_pointer_size != 0;
          
       default:
          return false;
@@ -96,6 +101,11 @@ bool external_memory::is_host_visible() const
    return m_memory_type == wsi_memory_type::HOST_VISIBLE;
 }
 
+bool external_memory::is_host_pointer() const
+{
+   return m_memory_type == wsi_memory_type::EXTERNAL_HOST_POINTER;
+}
+
 wsi_memory_type external_memory::get_memory_type() const
 {
    return m_memory_type;
@@ -117,6 +127,21 @@ VkResult external_memory::configure_for_host_visible(const VkImageCreateInfo &im
    return VK_SUCCESS;
 }
 
+void external_memory::configure_for_host_pointer(void *host_pointer, size_t size,
+                                                 VkMemoryPropertyFlags required_props,
+                                                 VkMemoryPropertyFlags optimal_props)
+{
+   m_memory_type = wsi_memory_type::EXTERNAL_HOST_POINTER;
+   m_handle_type = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+   m_host_pointer = host_pointer;
+   m_host_pointer_size = size;
+   m_required_props = required_props;
+   m_optimal_props = optimal_props;
+
+   m_num_planes = 1;
+   m_num_memories = 1;
+}
+
 VkResult external_memory::get_fd_mem_type_index(int fd, uint32_t *mem_idx)
 {
    auto &device_data = wsi::device_private_data::get(m_device);
@@ -272,6 +297,16 @@ VkResult external_memory::find_host_visible_memory_type(const VkMemoryRequiremen
    memory_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
    device_data.instance_data.disp.GetPhysicalDeviceMemoryProperties2KHR(device_data.physical_device, &memory_props);
    
+   /* Memory the CPU reads frames back from goes by measured read speed rather than by flags when available. */
+   if (m_memory_type == wsi_memory_type::HOST_VISIBLE &&
+       find_fastest_host_read_memory_type(device_data, mem_requirements.memoryTypeBits, m_required_props,
+                                          memory_type_index))
+   {
+      m_host_coherent = (memory_props.memoryProperties.memoryTypes[*memory_type_index].propertyFlags &
+                         VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+      return VK_SUCCESS;
+   }
+
    VkMemoryPropertyFlags props_to_try[] = { m_optimal_props, m_required_props };
    
    for (VkMemoryPropertyFlags props : props_to_try)
@@ -282,6 +317,8 @@ VkResult external_memory::find_host_visible_memory_type(const VkMemoryRequiremen
              (memory_props.memoryProperties.memoryTypes[i].propertyFlags & props) == props)
          {
             *memory_type_index = i;
+            m_host_coherent = (memory_props.memoryProperties.memoryTypes[i].propertyFlags &
+                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
             return VK_SUCCESS;
          }
       }
@@ -322,8 +359,66 @@ VkResult external_memory::allocate_host_visible_and_bind(const VkImage &image, c
    return VK_SUCCESS;
 }
 
+VkResult external_memory::import_host_pointer_and_bind(const VkImage &image)
+{
+   auto &device_data = wsi::device_private_data::get(m_device);
+
+   VkMemoryRequirements mem_requirements;
+   device_data.disp.GetImageMemoryRequirements(m_device, image, &mem_requirements);
+   if (mem_requirements.size > m_host_pointer_size)
+   {
+      WSI_LOG_ERROR("Host allocation of %zu bytes is too small for image requiring %llu bytes", m_host_pointer_size,
+                    static_cast<unsigned long long>(mem_requirements.size));
+      return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+   }
+
+   VkMemoryHostPointerPropertiesEXT host_pointer_props = {};
+   host_pointer_props.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+   TRY_LOG(device_data.disp.GetMemoryHostPointerPropertiesEXT(m_device, m_handle_type, m_host_pointer,
+                                                              &host_pointer_props),
+           "Failed to query host pointer properties");
+
+   mem_requirements.memoryTypeBits &= host_pointer_props.memoryTypeBits;
+
+   uint32_t memory_type_index;
+   TRY_LOG(find_host_visible_memory_type(mem_requirements, &memory_type_index),
+           "No memory type can import the host allocation");
+
+   VkImportMemoryHostPointerInfoEXT import_info = {};
+   import_info.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+   import_info.handleType = m_handle_type;
+   import_info.pHostPointer = m_host_pointer;
+
+   VkMemoryAllocateInfo alloc_info = {};
+   alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+   alloc_info.pNext = &import_info;
+   alloc_info.allocationSize = m_host_pointer_size;
+   alloc_info.memoryTypeIndex = memory_type_index;
+
+   TRY_LOG(device_data.disp.AllocateMemory(m_device, &alloc_info, m_allocator.get_original_callbacks(), &m_host_memory),
+           "Failed to import host allocation");
+
+   TRY_LOG(device_data.disp.BindImageMemory(m_device, image, m_host_memory, 0),
+           "Failed to bind imported host memory to image");
+
+   VkImageSubresource subresource = {};
+   subresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+   subresource.mipLevel = 0;
+   subresource.arrayLayer = 0;
+
+   device_data.disp.GetImageSubresourceLayout(m_device, image, &subresource, &m_host_layout);
+
+   return VK_SUCCESS;
+}
+
 VkResult external_memory::map_host_memory(void **mapped_ptr)
 {
+   if (m_memory_type == wsi_memory_type::EXTERNAL_HOST_POINTER && m_host_memory != VK_NULL_HANDLE)
+   {
+      *mapped_ptr = m_host_pointer;
+      return VK_SUCCESS;
+   }
+
    if (m_memory_type != wsi_memory_type::HOST_VISIBLE || m_host_memory == VK_NULL_HANDLE)
    {
       return VK_ERROR_MEMORY_MAP_FAILED;
@@ -345,6 +440,23 @@ VkResult external_memory::map_host_memory(void **mapped_ptr)
    return result;
 }
 
+VkResult external_memory::invalidate_host_memory()
+{
+   if (m_host_coherent || m_host_mapped_ptr == nullptr)
+   {
+      return VK_SUCCESS;
+   }
+
+   VkMappedMemoryRange range = {};
+   range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+   range.memory = m_host_memory;
+   range.offset = 0;
+   range.size = VK_WHOLE_SIZE;
+
+   auto &device_data = wsi::device_private_data::get(m_device);
+   return device_data.disp.InvalidateMappedMemoryRanges(m_device, 1, &range);
+}
+
 void external_memory::unmap_host_memory()
 {
    if (m_host_mapped_ptr != nullptr && m_host_memory != VK_NULL_HANDLE)
@@ -357,7 +469,14 @@ void external_memory::unmap_host_memory()
 
 VkDeviceMemory external_memory::get_host_memory() const
 {
-   return m_memory_type == wsi_memory_type::HOST_VISIBLE ? m_host_memory : VK_NULL_HANDLE;
+   return (m_memory_type == wsi_memory_type::HOST_VISIBLE || m_memory_type == wsi_memory_type::EXTERNAL_HOST_POINTER) ?
+             m_host_memory :
+             VK_NULL_HANDLE;
+}
+
+void external_memory::release_host_memory()
+{
+   cleanup_host_visible_memory();
 }
 
 const VkSubresourceLayout& external_memory::get_host_layout() const
@@ -374,6 +493,9 @@ VkResult external_memory::allocate_and_bind_image(const VkImage &image, const Vk
          
       case wsi_memory_type::HOST_VISIBLE:
          return allocate_host_visible_and_bind(image, image_info);
+
+      case wsi_memory_type::EXTERNAL_HOST_POINTER:
+         return import_host_pointer_and_bind(image);
          
       default:
          WSI_LOG_ERROR("Unsupported memory type: %d", static_cast<int>(m_memory_type));
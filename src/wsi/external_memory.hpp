@@ -48,7 +48,7 @@ enum class wsi_memory_type
 {
    EXTERNAL_DMA_BUF,      // External file descriptors (current default)
    HOST_VISIBLE,          // Host-accessible memory
-   EXTERNAL_HOST_POINTER  // Future: external host pointers
+   EXTERNAL_HOST_POINTER  // Host allocation imported through VK_EXT_external_memory_host
 };
 
 class external_memory
@@ -157,6 +157,19 @@ public:
                                        VkMemoryPropertyFlags required_props,
                                        VkMemoryPropertyFlags optimal_props);
 
+   /**
+    * @brief Configure for importing an existing host allocation with VK_EXT_external_memory_host.
+    *
+    * The allocation stays owned by the caller and must outlive the imported memory, see release_host_memory().
+    *
+    * @param host_pointer     Start of the allocation, aligned to minImportedHostPointerAlignment
+    * @param size             Size of the allocation, a multiple of minImportedHostPointerAlignment
+    * @param required_props   Required memory property flags
+    * @param optimal_props    Optimal memory property flags (fallback to required)
+    */
+   void configure_for_host_pointer(void *host_pointer, size_t size, VkMemoryPropertyFlags required_props,
+                                   VkMemoryPropertyFlags optimal_props);
+
    /**
     * @brief Check if external_memory instance is properly configured.
     */
@@ -167,6 +180,11 @@ public:
     */
    bool is_host_visible() const;
 
+   /**
+    * @brief Check if backed by an imported host allocation.
+    */
+   bool is_host_pointer() const;
+
    /**
     * @brief Get current memory type.
     */
@@ -238,6 +256,16 @@ public:
     */
    VkResult map_host_memory(void **mapped_ptr);
 
+   /**
+    * @brief Make device writes visible to the mapping before the CPU reads it.
+    *
+    * Does nothing for coherent memory, which find_host_visible_memory_type may skip in favour of a faster
+    * non-coherent type when only HOST_VISIBLE is required.
+    *
+    * @return VK_SUCCESS on success, error code on failure
+    */
+   VkResult invalidate_host_memory();
+
    /**
     * @brief Unmap previously mapped host memory.
     */
@@ -250,6 +278,13 @@ public:
     */
    VkDeviceMemory get_host_memory() const;
 
+   /**
+    * @brief Free host-visible or imported host memory ahead of destruction.
+    *
+    * Imported host memory must be freed before the host allocation backing it is released.
+    */
+   void release_host_memory();
+
    /**
     * @brief Get host memory layout information.
     *
@@ -295,6 +330,7 @@ private:
    // Host-visible memory methods
    VkResult allocate_host_visible_and_bind(const VkImage &image, const VkImageCreateInfo &image_info);
    VkResult find_host_visible_memory_type(const VkMemoryRequirements &mem_requirements, uint32_t *memory_type_index);
+   VkResult import_host_pointer_and_bind(const VkImage &image);
    void cleanup_host_visible_memory();
    void cleanup_external_memory();
 
@@ -312,10 +348,14 @@ private:
    
    VkDeviceMemory m_host_memory = VK_NULL_HANDLE;
    void* m_host_mapped_ptr = nullptr;
+   bool m_host_coherent = true;
    VkSubresourceLayout m_host_layout = {};
    VkMemoryPropertyFlags m_required_props = 0;
    VkMemoryPropertyFlags m_optimal_props = 0;
 
+   void *m_host_pointer = nullptr;
+   size_t m_host_pointer_size = 0;
+
    const VkDevice &m_device;
    const util::allocator &m_allocator;
 };
@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "host_memory_ranking.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils/logging.hpp"
+#include "layer_utils/pixel_copy.hpp"
+
+namespace wsi
+{
+
+/* About a 512x512 frame, enough for the copy to run at its streaming rate. */
+static constexpr VkDeviceSize PROBE_BYTES = 1024 * 1024;
+static constexpr size_t PROBE_ROW_BYTES = 4096;
+static constexpr unsigned PROBE_ROUNDS = 3;
+
+/*
+ * Written from the CPU before every round, larger than the last level cache of the SoCs Mali ships in, so that reads
+ * from cached types reach memory like those of a frame the GPU just rendered. Plain heap memory, the driver only
+ * allocates PROBE_BYTES per memory type.
+ */
+static constexpr size_t EVICT_BYTES = 4 * 1024 * 1024;
+
+/* Bumped whenever the probe or the file layout changes, so that stale rankings are measured again. */
+static constexpr unsigned CACHE_FILE_VERSION = 1;
+
+struct host_memory_ranking
+{
+   /* Instance the physical device handle belongs to, the handle may be reused once it is destroyed. */
+   VkInstance instance;
+
+   /* Memory type indices, fastest to read first. */
+   std::vector<uint32_t> memory_types;
+};
+
+static std::mutex g_rankings_lock;
+static std::unordered_map<VkPhysicalDevice, host_memory_ranking> g_rankings;
+
+static bool is_probe_enabled()
+{
+   const char *env = std::getenv("MALI_WRAPPER_HOST_MEMORY_PROBE");
+   return env == nullptr || std::strcmp(env, "0") != 0;
+}
+
+static bool is_probed_type(const VkMemoryType &type)
+{
+   const VkMemoryPropertyFlags excluded = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT | VK_MEMORY_PROPERTY_PROTECTED_BIT;
+   return (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0 && (type.propertyFlags & excluded) == 0;
+}
+
+/**
+ * @brief Path of the ranking file, one per device, driver version and pipeline cache UUID.
+ *
+ * The pipeline cache UUID changes with every Mali driver build, which the version number alone does not.
+ */
+static std::string get_cache_path(const VkPhysicalDeviceProperties &props)
+{
+   std::string dir;
+   const char *xdg_cache = std::getenv("XDG_CACHE_HOME");
+   const char *home = std::getenv("HOME");
+   if (xdg_cache != nullptr && xdg_cache[0] == '/')
+   {
+      dir = xdg_cache;
+   }
+   else if (home != nullptr && home[0] == '/')
+   {
+      dir = std::string(home) + "/.cache";
+   }
+   else
+   {
+      return std::string();
+   }
+
+   char name[128];
+   int len = std::snprintf(name, sizeof(name), "/mali_wrapper/host_memory_%08x_%08x_%08x_", props.vendorID,
+                           props.deviceID, props.driverVersion);
+   for (uint32_t i = 0; i < VK_UUID_SIZE; i++)
+   {
+      len += std::snprintf(name + len, sizeof(name) - len, "%02x", props.pipelineCacheUUID[i]);
+   }
+   return dir + name;
+}
+
+static bool ensure_cache_dir(const std::string &path)
+{
+   /* Create the cache root and our directory below it, whichever is missing. */
+   const size_t ours = path.rfind('/');
+   const size_t root = path.rfind('/', ours - 1);
+   for (size_t end : { root, ours })
+   {
+      const std::string dir = path.substr(0, end);
+      if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+      {
+         return false;
+      }
+   }
+   return true;
+}
+
+/**
+ * @brief Describe the memory types so that a ranking is only reused for the layout it was measured on.
+ */
+static std::string describe_memory_types(const VkPhysicalDeviceMemoryProperties &memory_props)
+{
+   std::string layout = std::to_string(CACHE_FILE_VERSION) + " " +
+                        util::pixel_copy_isa_name(util::get_pixel_copy_isa()) + " " +
+                        std::to_string(memory_props.memoryTypeCount);
+   for (uint32_t i = 0; i < memory_props.memoryTypeCount; i++)
+   {
+      layout += " " + std::to_string(memory_props.memoryTypes[i].propertyFlags);
+   }
+   return layout;
+}
+
+static bool load_ranking(const std::string &path, const std::string &layout, uint32_t memory_type_count,
+                         std::vector<uint32_t> &ranking)
+{
+   FILE *file = std::fopen(path.c_str(), "r");
+   if (file == nullptr)
+   {
+      return false;
+   }
+
+   char line[512];
+   bool valid = std::fgets(line, sizeof(line), file) != nullptr && line[std::strcspn(line, "\n")] == '\n';
+   if (valid)
+   {
+      line[std::strcspn(line, "\n")] = '\0';
+      valid = layout == line;
+   }
+
+   unsigned index;
+   while (valid && std::fscanf(file, "%u", &index) == 1)
+   {
+      valid = index < memory_type_count && std::find(ranking.begin(), ranking.end(), index) == ranking.end();
+      ranking.push_back(index);
+   }
+   std::fclose(file);
+
+   if (!valid || ranking.empty())
+   {
+      ranking.clear();
+      return false;
+   }
+   return true;
+}
+
+static void store_ranking(const std::string &path, const std::string &layout, const std::vector<uint32_t> &ranking)
+{
+   if (!ensure_cache_dir(path))
+   {
+      return;
+   }
+
+   /* Written aside and renamed, so that a process probing concurrently never reads half a file. */
+   const std::string tmp_path = path + "." + std::to_string(getpid());
+   FILE *file = std::fopen(tmp_path.c_str(), "w");
+   if (file == nullptr)
+   {
+      return;
+   }
+
+   std::fprintf(file, "%s\n", layout.c_str());
+   for (uint32_t index : ranking)
+   {
+      std::fprintf(file, "%u\n", index);
+   }
+
+   if (std::fclose(file) != 0 || rename(tmp_path.c_str(), path.c_str()) != 0)
+   {
+      unlink(tmp_path.c_str());
+   }
+}
+
+/**
+ * @brief Time reading one memory type the way a presented frame is read.
+ *
+ * @return Best time of the rounds in nanoseconds, 0 if the type could not be allocated or mapped.
+ */
+static uint64_t time_memory_type_reads(device_private_data &device_data, uint32_t memory_type_index, bool coherent,
+                                       uint8_t *dst, std::vector<uint8_t> &evict)
+{
+   const VkAllocationCallbacks *callbacks = device_data.get_allocator().get_original_callbacks();
+
+   VkMemoryAllocateInfo alloc_info = {};
+   alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+   alloc_info.allocationSize = PROBE_BYTES;
+   alloc_info.memoryTypeIndex = memory_type_index;
+
+   VkDeviceMemory memory = VK_NULL_HANDLE;
+   if (device_data.disp.AllocateMemory(device_data.device, &alloc_info, callbacks, &memory) != VK_SUCCESS)
+   {
+      return 0;
+   }
+
+   uint64_t best_ns = 0;
+   void *mapped = nullptr;
+   if (device_data.disp.MapMemory(device_data.device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) == VK_SUCCESS)
+   {
+      VkMappedMemoryRange range = {};
+      range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+      range.memory = memory;
+      range.offset = 0;
+      range.size = VK_WHOLE_SIZE;
+
+      /* Fault every page in, and leave no dirty lines behind for the first invalidate to write back. */
+      std::memset(mapped, 0x5a, PROBE_BYTES);
+      if (!coherent)
+      {
+         device_data.disp.FlushMappedMemoryRanges(device_data.device, 1, &range);
+      }
+
+      const uint32_t rows = static_cast<uint32_t>(PROBE_BYTES / PROBE_ROW_BYTES);
+      for (unsigned round = 0; round < PROBE_ROUNDS; round++)
+      {
+         std::memset(evict.data(), static_cast<int>(round), evict.size());
+
+         const auto start = std::chrono::steady_clock::now();
+
+         /* Non-coherent memory pays for the invalidate before every frame, so it is part of the measurement. */
+         if (!coherent)
+         {
+            device_data.disp.InvalidateMappedMemoryRanges(device_data.device, 1, &range);
+         }
+         util::copy_pixel_rows(dst, PROBE_ROW_BYTES, mapped, PROBE_ROW_BYTES, PROBE_ROW_BYTES, rows,
+                               util::copy_destination::write_only);
+
+         const uint64_t elapsed_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+         if (best_ns == 0 || elapsed_ns < best_ns)
+         {
+            best_ns = std::max<uint64_t>(elapsed_ns, 1);
+         }
+      }
+
+      device_data.disp.UnmapMemory(device_data.device, memory);
+   }
+
+   device_data.disp.FreeMemory(device_data.device, memory, callbacks);
+   return best_ns;
+}
+
+static std::vector<uint32_t> measure_ranking(device_private_data &device_data,
+                                             const VkPhysicalDeviceMemoryProperties &memory_props)
+{
+   struct measurement
+   {
+      uint32_t index;
+      uint64_t ns;
+   };
+   std::vector<measurement> measurements;
+
+   std::vector<uint8_t> dst(PROBE_BYTES);
+   std::memset(dst.data(), 0, dst.size());
+   std::vector<uint8_t> evict(EVICT_BYTES);
+
+   for (uint32_t i = 0; i < memory_props.memoryTypeCount; i++)
+   {
+      const VkMemoryType &type = memory_props.memoryTypes[i];
+      if (!is_probed_type(type))
+      {
+         continue;
+      }
+
+      const bool coherent = (type.propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+      const uint64_t ns = time_memory_type_reads(device_data, i, coherent, dst.data(), evict);
+      if (ns == 0)
+      {
+         WSI_LOG_WARNING("Host memory probe could not map memory type %u", i);
+         continue;
+      }
+
+      WSI_LOG_INFO("Host memory type %u (flags 0x%x) reads at %llu MB/s", i, type.propertyFlags,
+                   static_cast<unsigned long long>(PROBE_BYTES * 1000 / ns));
+      measurements.push_back({ i, ns });
+   }
+
+   std::stable_sort(measurements.begin(), measurements.end(),
+                    [](const measurement &a, const measurement &b) { return a.ns < b.ns; });
+
+   std::vector<uint32_t> ranking;
+   for (const auto &m : measurements)
+   {
+      ranking.push_back(m.index);
+   }
+   return ranking;
+}
+
+void probe_host_memory_read_speed(device_private_data &device_data)
+{
+   if (!is_probe_enabled())
+   {
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock(g_rankings_lock);
+   if (g_rankings.find(device_data.physical_device) != g_rankings.end())
+   {
+      return;
+   }
+
+   auto &instance_data = device_data.instance_data;
+   VkPhysicalDeviceProperties props = {};
+   instance_data.disp.GetPhysicalDeviceProperties(device_data.physical_device, &props);
+
+   VkPhysicalDeviceMemoryProperties2 memory_props = {};
+   memory_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+   instance_data.disp.GetPhysicalDeviceMemoryProperties2KHR(device_data.physical_device, &memory_props);
+
+   const std::string path = get_cache_path(props);
+   const std::string layout = describe_memory_types(memory_props.memoryProperties);
+
+   std::vector<uint32_t> ranking;
+   if (path.empty() || !load_ranking(path, layout, memory_props.memoryProperties.memoryTypeCount, ranking))
+   {
+      const auto start = std::chrono::steady_clock::now();
+      ranking = measure_ranking(device_data, memory_props.memoryProperties);
+      WSI_LOG_INFO("Probed host memory read speed in %lld ms",
+                   static_cast<long long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                             std::chrono::steady_clock::now() - start)
+                                             .count()));
+
+      if (!path.empty() && !ranking.empty())
+      {
+         store_ranking(path, layout, ranking);
+      }
+   }
+
+   g_rankings.emplace(device_data.physical_device,
+                      host_memory_ranking{ instance_data.get_instance_handle(), std::move(ranking) });
+}
+
+void forget_host_memory_rankings(VkInstance instance)
+{
+   std::lock_guard<std::mutex> lock(g_rankings_lock);
+   for (auto it = g_rankings.begin(); it != g_rankings.end();)
+   {
+      it = it->second.instance == instance ? g_rankings.erase(it) : std::next(it);
+   }
+}
+
+bool find_fastest_host_read_memory_type(const device_private_data &device_data, uint32_t memory_type_bits,
+                                        VkMemoryPropertyFlags required_props, uint32_t *memory_type_index)
+{
+   std::lock_guard<std::mutex> lock(g_rankings_lock);
+   auto it = g_rankings.find(device_data.physical_device);
+   if (it == g_rankings.end())
+   {
+      return false;
+   }
+
+   VkPhysicalDeviceMemoryProperties2 memory_props = {};
+   memory_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+   device_data.instance_data.disp.GetPhysicalDeviceMemoryProperties2KHR(device_data.physical_device, &memory_props);
+
+   for (uint32_t index : it->second.memory_types)
+   {
+      if ((memory_type_bits & (1u << index)) != 0 &&
+          (memory_props.memoryProperties.memoryTypes[index].propertyFlags & required_props) == required_props)
+      {
+         *memory_type_index = index;
+         return true;
+      }
+   }
+   return false;
+}
+
+} /* namespace wsi */
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file host_memory_ranking.hpp
+ *
+ * @brief Ranking of host-visible memory types by CPU read bandwidth.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+#include "wsi/wsi_private_data.hpp"
+
+namespace wsi
+{
+
+/**
+ * @brief Measure how fast the CPU reads each host-visible memory type of a device.
+ *
+ * Mali exposes cached coherent, cached non-coherent and uncached host-visible types, and reading a frame back from
+ * them differs by several times. Each eligible type is timed with the copy kernel presentation uses, on a small
+ * allocation read with cold CPU caches. The ranking is stored per driver build under $XDG_CACHE_HOME, so the
+ * measurement only runs the first time a driver is seen. Set MALI_WRAPPER_HOST_MEMORY_PROBE=0 to skip it.
+ *
+ * Only copied presentation reads frames back, so this is called when its first swapchain is created.
+ *
+ * @param device_data Device to probe, later calls for the same physical device return immediately.
+ */
+void probe_host_memory_read_speed(device_private_data &device_data);
+
+/**
+ * @brief Drop the rankings of the physical devices of an instance that is being destroyed.
+ */
+void forget_host_memory_rankings(VkInstance instance);
+
+/**
+ * @brief Pick the host-visible memory type the CPU reads fastest.
+ *
+ * @param device_data       Device the memory is allocated from.
+ * @param memory_type_bits  Memory types allowed by the resource.
+ * @param required_props    Properties the memory type must have.
+ * @param memory_type_index Receives the chosen type.
+ *
+ * @return false if the device was not probed or no ranked type is allowed.
+ */
+bool find_fastest_host_read_memory_type(const device_private_data &device_data, uint32_t memory_type_bits,
+                                        VkMemoryPropertyFlags required_props, uint32_t *memory_type_index);
+
+} /* namespace wsi */
@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file handle_registry.hpp
+ *
+ * @brief Read-mostly map from Vulkan handles to the objects tracking them, looked up without taking a lock.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+
+/**
+ * @brief Fixed size open addressing map from handles to objects, for lookups on hot paths.
+ *
+ * Lookups take no lock: every slot is guarded by its own sequence counter, which readers check to get a consistent
+ * handle and value pair, and each thread remembers its last hit until the next change to the registry. Changes are
+ * rare and must be serialized by the caller. The registry holds no ownership, values must be erased before the
+ * objects they point to are destroyed. Handles that do not fit are simply not found, so callers keep a slower,
+ * complete lookup to fall back to.
+ *
+ * @tparam T        Type of the objects handles map to.
+ * @tparam SlotCount Maximum number of handles, a power of two.
+ */
+template <typename T, size_t SlotCount>
+class handle_registry
+{
+public:
+   static_assert((SlotCount & (SlotCount - 1)) == 0, "Slot count must be a power of two");
+
+   handle_registry() = default;
+
+   handle_registry(const handle_registry &) = delete;
+   handle_registry &operator=(const handle_registry &) = delete;
+
+   /**
+    * @brief Find the object a handle maps to, lock-free.
+    *
+    * @return the object, or nullptr if the handle is not registered.
+    */
+   T *find(const void *handle) const
+   {
+      if (handle == nullptr)
+      {
+         return nullptr;
+      }
+
+      /* Loaded before the slots, so a hit remembered with it is dropped by any change made during the lookup. */
+      const uint64_t generation = m_generation.load(std::memory_order_acquire);
+      static thread_local last_hit hit = {};
+      if (hit.registry == this && hit.handle == handle && hit.generation == generation)
+      {
+         return hit.value;
+      }
+
+      size_t index = first_slot(handle);
+      for (size_t probe = 0; probe < SlotCount; probe++, index = (index + 1) & (SlotCount - 1))
+      {
+         const void *key = nullptr;
+         T *value = nullptr;
+         read_slot(m_slots[index], key, value);
+         if (key == handle)
+         {
+            hit = { this, handle, value, generation };
+            return value;
+         }
+         if (key == nullptr)
+         {
+            return nullptr;
+         }
+      }
+      return nullptr;
+   }
+
+   /**
+    * @brief Map a handle to an object, replacing any previous mapping. Callers serialize changes.
+    *
+    * @return false if the registry is full.
+    */
+   bool insert(const void *handle, T *value)
+   {
+      if (handle == nullptr)
+      {
+         return false;
+      }
+
+      slot *free_slot = nullptr;
+      size_t index = first_slot(handle);
+      for (size_t probe = 0; probe < SlotCount; probe++, index = (index + 1) & (SlotCount - 1))
+      {
+         slot &candidate = m_slots[index];
+         const void *key = candidate.handle.load(std::memory_order_relaxed);
+         if (key == handle)
+         {
+            if (candidate.value.load(std::memory_order_relaxed) != value)
+            {
+               write_slot(candidate, handle, value);
+               m_generation.fetch_add(1, std::memory_order_release);
+            }
+            return true;
+         }
+         if (key == removed_handle() && free_slot == nullptr)
+         {
+            free_slot = &candidate;
+         }
+         if (key == nullptr)
+         {
+            if (free_slot == nullptr)
+            {
+               free_slot = &candidate;
+            }
+            break;
+         }
+      }
+
+      if (free_slot == nullptr)
+      {
+         return false;
+      }
+      write_slot(*free_slot, handle, value);
+      return true;
+   }
+
+   /**
+    * @brief Remove the mapping of a handle. Callers serialize changes.
+    */
+   void erase(const void *handle)
+   {
+      size_t index = first_slot(handle);
+      for (size_t probe = 0; probe < SlotCount; probe++, index = (index + 1) & (SlotCount - 1))
+      {
+         const void *key = m_slots[index].handle.load(std::memory_order_relaxed);
+         if (key == nullptr)
+         {
+            return;
+         }
+         if (key == handle)
+         {
+            write_slot(m_slots[index], removed_handle(), nullptr);
+            m_generation.fetch_add(1, std::memory_order_release);
+            return;
+         }
+      }
+   }
+
+   /**
+    * @brief Remove every handle mapping to an object, before it is destroyed. Callers serialize changes.
+    */
+   void erase_value(const T *value)
+   {
+      if (value == nullptr)
+      {
+         return;
+      }
+
+      bool erased = false;
+      for (slot &candidate : m_slots)
+      {
+         if (candidate.value.load(std::memory_order_relaxed) == value)
+         {
+            write_slot(candidate, removed_handle(), nullptr);
+            erased = true;
+         }
+      }
+      if (erased)
+      {
+         m_generation.fetch_add(1, std::memory_order_release);
+      }
+   }
+
+private:
+   struct slot
+   {
+      /* Odd while the slot is being written. */
+      std::atomic<uint32_t> sequence{ 0 };
+      std::atomic<const void *> handle{ nullptr };
+      std::atomic<T *> value{ nullptr };
+   };
+
+   struct last_hit
+   {
+      const handle_registry *registry;
+      const void *handle;
+      T *value;
+      uint64_t generation;
+   };
+
+   slot m_slots[SlotCount];
+
+   /* Bumped after every change that removes or retargets a mapping, invalidating the per-thread last hits. */
+   std::atomic<uint64_t> m_generation{ 0 };
+
+   /* Key of a slot whose handle was erased, lookups continue probing past it. */
+   static const void *removed_handle()
+   {
+      return reinterpret_cast<const void *>(static_cast<uintptr_t>(1));
+   }
+
+   static size_t first_slot(const void *handle)
+   {
+      /* Handles are heap pointers, the low bits are alignment. */
+      const uint64_t key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(handle)) >> 4;
+      return static_cast<size_t>((key * 0x9e3779b97f4a7c15ull) >> 32) & (SlotCount - 1);
+   }
+
+   static void read_slot(const slot &source, const void *&handle, T *&value)
+   {
+      uint32_t sequence = 0;
+      do
+      {
+         sequence = source.sequence.load(std::memory_order_acquire);
+         handle = source.handle.load(std::memory_order_relaxed);
+         value = source.value.load(std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_acquire);
+      } while ((sequence & 1) != 0 || sequence != source.sequence.load(std::memory_order_relaxed));
+   }
+
+   static void write_slot(slot &target, const void *handle, T *value)
+   {
+      const uint32_t sequence = target.sequence.load(std::memory_order_relaxed);
+      target.sequence.store(sequence + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      target.handle.store(handle, std::memory_order_relaxed);
+      target.value.store(value, std::memory_order_relaxed);
+      target.sequence.store(sequence + 2, std::memory_order_release);
+   }
+};
+
+} /* namespace util */
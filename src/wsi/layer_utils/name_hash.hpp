@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/**
+ * @file name_hash.hpp
+ *
+ * @brief Collision free hash of a fixed set of names, built at compile time.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace util
+{
+
+/**
+ * @brief Maps each of a fixed set of names to its index with one hash and at most one string compare.
+ *
+ * The hash seed is searched at compile time so that every name lands in a slot of its own.
+ *
+ * @tparam SlotCount Power of two, about four times the number of names so that a seed turns up quickly.
+ */
+template <size_t SlotCount>
+class perfect_name_hash
+{
+public:
+   static_assert((SlotCount & (SlotCount - 1)) == 0, "Slot count must be a power of two");
+
+   /** @brief Returned by find for names outside the set. */
+   static constexpr size_t not_found = SIZE_MAX;
+
+   /**
+    * @brief Build the table for @p names, check the result with is_valid.
+    */
+   template <size_t N>
+   static constexpr perfect_name_hash build(const char *const (&names)[N])
+   {
+      static_assert(N < SlotCount / 2, "Too many names for the slot count");
+
+      perfect_name_hash table{};
+      table.m_seed = find_seed(names);
+      for (size_t slot = 0; slot < SlotCount; slot++)
+      {
+         table.m_names[slot] = nullptr;
+         table.m_indices[slot] = 0;
+      }
+      if (table.m_seed == no_seed)
+      {
+         return table;
+      }
+      for (size_t i = 0; i < N; i++)
+      {
+         const size_t slot = slot_of(names[i], table.m_seed);
+         table.m_names[slot] = names[i];
+         table.m_indices[slot] = static_cast<uint16_t>(i);
+      }
+      return table;
+   }
+
+   /**
+    * @brief Whether a collision free seed was found, grow SlotCount otherwise.
+    */
+   constexpr bool is_valid() const
+   {
+      return m_seed != no_seed;
+   }
+
+   /**
+    * @brief Index of @p name in the names the table was built from, or not_found.
+    */
+   size_t find(const char *name) const
+   {
+      if (name == nullptr)
+      {
+         return not_found;
+      }
+
+      const size_t slot = slot_of(name, m_seed);
+      if (m_names[slot] == nullptr || strcmp(m_names[slot], name) != 0)
+      {
+         return not_found;
+      }
+      return m_indices[slot];
+   }
+
+private:
+   static constexpr uint32_t no_seed = UINT32_MAX;
+
+   uint32_t m_seed;
+   const char *m_names[SlotCount];
+   uint16_t m_indices[SlotCount];
+
+   /* Seeded FNV-1a with a final mix, so the low bits used as slot depend on the whole name. */
+   static constexpr size_t slot_of(const char *name, uint32_t seed)
+   {
+      uint32_t hash = 2166136261u ^ seed;
+      for (; *name != '\0'; name++)
+      {
+         hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+      }
+      hash ^= hash >> 15;
+      return hash & (SlotCount - 1);
+   }
+
+   template <size_t N>
+   static constexpr bool is_perfect(const char *const (&names)[N], uint32_t seed)
+   {
+      bool used[SlotCount] = {};
+      for (size_t i = 0; i < N; i++)
+      {
+         const size_t slot = slot_of(names[i], seed);
+         if (used[slot])
+         {
+            return false;
+         }
+         used[slot] = true;
+      }
+      return true;
+   }
+
+   template <size_t N>
+   static constexpr uint32_t find_seed(const char *const (&names)[N])
+   {
+      for (uint32_t seed = 0; seed < 100000; seed++)
+      {
+         if (is_perfect(names, seed))
+         {
+            return seed;
+         }
+      }
+      return no_seed;
+   }
+};
+
+} /* namespace util */
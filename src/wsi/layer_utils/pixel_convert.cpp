@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_convert.cpp
+ *
+ * @brief Pixel layout handling and kernel selection for util::pixel_converter.
+ */
+
+#include "pixel_convert.hpp"
+#include "pixel_convert_kernels.hpp"
+#include "pixel_copy.hpp"
+
+namespace util
+{
+
+namespace pixel_convert_kernels
+{
+
+pixel_converter::convert_rows_function get_generic_kernel(pack_kind kind, bool dither)
+{
+   return select_kernel(kind, dither);
+}
+
+} /* namespace pixel_convert_kernels */
+
+static bool mask_to_channel(uint32_t mask, pixel_channel *channel)
+{
+   if (mask == 0)
+   {
+      return false;
+   }
+
+   const uint32_t shift = __builtin_ctz(mask);
+   const uint32_t bits = __builtin_popcount(mask);
+   if (bits > 16 || (mask >> shift) != (1u << bits) - 1)
+   {
+      return false;
+   }
+
+   *channel = { static_cast<uint8_t>(shift), static_cast<uint8_t>(bits) };
+   return true;
+}
+
+bool pixel_layout::from_masks(uint8_t bits_per_pixel, uint32_t red_mask, uint32_t green_mask, uint32_t blue_mask,
+                              pixel_layout *layout)
+{
+   const uint64_t pixel_mask = (uint64_t{ 1 } << bits_per_pixel) - 1;
+   if ((red_mask | green_mask | blue_mask) & ~pixel_mask)
+   {
+      return false;
+   }
+
+   pixel_layout result = {};
+   result.bits_per_pixel = bits_per_pixel;
+   if (!mask_to_channel(red_mask, &result.red) || !mask_to_channel(green_mask, &result.green) ||
+       !mask_to_channel(blue_mask, &result.blue))
+   {
+      return false;
+   }
+
+   *layout = result;
+   return true;
+}
+
+static bool operator==(const pixel_channel &a, const pixel_channel &b)
+{
+   return a.shift == b.shift && a.bits == b.bits;
+}
+
+bool pixel_layout::operator==(const pixel_layout &other) const
+{
+   return bits_per_pixel == other.bits_per_pixel && red == other.red && green == other.green && blue == other.blue;
+}
+
+static uint32_t channel_mask(const pixel_channel &channel)
+{
+   return ((1u << channel.bits) - 1) << channel.shift;
+}
+
+static bool has_bits(const pixel_layout &layout, uint8_t bits_per_pixel, uint8_t red_blue_bits, uint8_t green_bits)
+{
+   return layout.bits_per_pixel == bits_per_pixel && layout.red.bits == red_blue_bits &&
+          layout.green.bits == green_bits && layout.blue.bits == red_blue_bits;
+}
+
+bool pixel_converter::configure(const pixel_layout &src, const pixel_layout &dst, bool dither)
+{
+   /* The kernels read alpha from the top byte of the source. */
+   const uint32_t src_rgb = channel_mask(src.red) | channel_mask(src.green) | channel_mask(src.blue);
+   if (!has_bits(src, 32, 8, 8) || src_rgb != 0x00ffffffu)
+   {
+      return false;
+   }
+
+   if (src == dst)
+   {
+      m_params = {};
+      m_convert_rows = nullptr;
+      m_dst_bytes_per_pixel = 4;
+      return true;
+   }
+
+   pixel_convert_kernels::pack_kind kind;
+   if (has_bits(dst, 32, 8, 8))
+   {
+      kind = pixel_convert_kernels::pack_kind::rgb8888;
+   }
+   else if (has_bits(dst, 16, 5, 6))
+   {
+      kind = pixel_convert_kernels::pack_kind::rgb565;
+   }
+   else if (has_bits(dst, 32, 10, 10))
+   {
+      kind = pixel_convert_kernels::pack_kind::rgb2101010;
+   }
+   else
+   {
+      return false;
+   }
+
+   const uint32_t dst_rgb = channel_mask(dst.red) | channel_mask(dst.green) | channel_mask(dst.blue);
+   const uint32_t unused = dst.bits_per_pixel == 32 ? ~dst_rgb : (~dst_rgb & 0xffffu);
+
+   params new_params = {};
+   new_params.src_red = src.red;
+   new_params.src_green = src.green;
+   new_params.src_blue = src.blue;
+   new_params.dst_red = dst.red;
+   new_params.dst_green = dst.green;
+   new_params.dst_blue = dst.blue;
+   if (!mask_to_channel(unused, &new_params.dst_alpha) || new_params.dst_alpha.bits > 8)
+   {
+      new_params.dst_alpha = {};
+   }
+
+   const bool lossy = kind == pixel_convert_kernels::pack_kind::rgb565;
+#if defined(__arm__)
+   if (get_pixel_copy_isa() == pixel_copy_isa::neon)
+   {
+      m_convert_rows = pixel_convert_kernels::get_neon_kernel(kind, dither && lossy);
+   }
+   else
+#endif
+   {
+      m_convert_rows = pixel_convert_kernels::get_generic_kernel(kind, dither && lossy);
+   }
+
+   m_params = new_params;
+   m_dst_bytes_per_pixel = dst.bits_per_pixel / 8;
+   return true;
+}
+
+void pixel_converter::convert_rows(void *dst, size_t dst_stride, const void *src, size_t src_stride, uint32_t width,
+                                   uint32_t rows, uint32_t x, uint32_t y) const
+{
+   if (m_convert_rows == nullptr)
+   {
+      copy_pixel_rows(dst, dst_stride, src, src_stride, width * sizeof(uint32_t), rows, copy_destination::cached);
+      return;
+   }
+
+   if (dst == nullptr || src == nullptr || width == 0 || rows == 0)
+   {
+      return;
+   }
+
+   m_convert_rows(m_params, static_cast<uint8_t *>(dst), dst_stride, static_cast<const uint8_t *>(src), src_stride,
+                  width, rows, x, y);
+}
+
+} /* namespace util */
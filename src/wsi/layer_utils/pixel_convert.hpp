@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_convert.hpp
+ *
+ * @brief Conversion of 32bpp 8-bit per channel images into the pixel layouts of CPU presentation targets.
+ *
+ * Conversions are fused into the copy so each pixel is read and written once. The kernels use 128-bit vectors
+ * (SSE2, NEON) and, like the pixel copy engine, pick NEON at runtime on 32-bit Arm.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+
+/**
+ * @brief Position of one colour channel in a packed pixel.
+ */
+struct pixel_channel
+{
+   uint8_t shift;
+   uint8_t bits;
+};
+
+/**
+ * @brief Packed little-endian RGB pixel layout. Bits outside the three channels are alpha or padding.
+ */
+struct pixel_layout
+{
+   uint8_t bits_per_pixel;
+   pixel_channel red;
+   pixel_channel green;
+   pixel_channel blue;
+
+   /**
+    * @brief Build a layout from channel masks, such as the ones of an X visual.
+    *
+    * @return false if a mask is empty or not contiguous.
+    */
+   static bool from_masks(uint8_t bits_per_pixel, uint32_t red_mask, uint32_t green_mask, uint32_t blue_mask,
+                          pixel_layout *layout);
+
+   bool operator==(const pixel_layout &other) const;
+};
+
+/** B8G8R8A8 as laid out in memory, i.e. 0xAARRGGBB words. */
+static constexpr pixel_layout PIXEL_LAYOUT_BGRA8888 = { 32, { 16, 8 }, { 8, 8 }, { 0, 8 } };
+/** R8G8B8A8 as laid out in memory, i.e. 0xAABBGGRR words. */
+static constexpr pixel_layout PIXEL_LAYOUT_RGBA8888 = { 32, { 0, 8 }, { 8, 8 }, { 16, 8 } };
+
+/**
+ * @brief Converts rows of a 32bpp source into a destination layout.
+ *
+ * Supported destinations are 32bpp with 8-bit channels in any order (channel swizzle), 16bpp 5/6/5 in either order
+ * and 32bpp 10-bit channels in either order. Alpha is carried over where the destination has room for it.
+ */
+class pixel_converter
+{
+public:
+   /**
+    * @brief Select the kernel converting @p src into @p dst.
+    *
+    * @param src    Source layout, must be 32bpp with 8-bit channels.
+    * @param dst    Destination layout.
+    * @param dither Apply a 4x4 ordered dither when channels lose precision.
+    *
+    * @return false if the conversion is not supported, the converter is then left unchanged.
+    */
+   bool configure(const pixel_layout &src, const pixel_layout &dst, bool dither);
+
+   /**
+    * @brief Whether source and destination layouts are identical and a plain copy does the job.
+    */
+   bool is_copy() const
+   {
+      return m_convert_rows == nullptr;
+   }
+
+   uint32_t get_dst_bytes_per_pixel() const
+   {
+      return m_dst_bytes_per_pixel;
+   }
+
+   /**
+    * @brief Convert a block of pixels.
+    *
+    * @param dst        Destination of the first pixel.
+    * @param dst_stride Distance in bytes between destination rows.
+    * @param src        Source of the first pixel.
+    * @param src_stride Distance in bytes between source rows.
+    * @param width      Pixels per row.
+    * @param rows       Number of rows.
+    * @param x          Image x coordinate of the first pixel, keeps the dither pattern stable across partial updates.
+    * @param y          Image y coordinate of the first row.
+    */
+   void convert_rows(void *dst, size_t dst_stride, const void *src, size_t src_stride, uint32_t width, uint32_t rows,
+                     uint32_t x, uint32_t y) const;
+
+   /** Conversion parameters handed to the kernels. */
+   struct params
+   {
+      pixel_channel src_red;
+      pixel_channel src_green;
+      pixel_channel src_blue;
+      pixel_channel dst_red;
+      pixel_channel dst_green;
+      pixel_channel dst_blue;
+      pixel_channel dst_alpha;
+   };
+
+   using convert_rows_function = void (*)(const params &params, uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                                          size_t src_stride, uint32_t width, uint32_t rows, uint32_t x, uint32_t y);
+
+private:
+   params m_params = {};
+   convert_rows_function m_convert_rows = nullptr;
+   uint32_t m_dst_bytes_per_pixel = 4;
+};
+
+} /* namespace util */
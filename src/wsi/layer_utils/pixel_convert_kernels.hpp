@@ -0,0 +1,188 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_convert_kernels.hpp
+ *
+ * @brief Conversion kernels behind util::pixel_converter. Internal to the pixel conversion code.
+ *
+ * The kernels are written with GCC vector extensions, so each file including this header gets them built for the
+ * instruction set it is compiled for: SSE2 on x86-64, NEON on AArch64 and, through pixel_convert_neon.cpp, NEON on
+ * 32-bit Arm. Everything lives in an anonymous namespace so those builds never get merged by the linker.
+ */
+
+#pragma once
+
+#include "pixel_convert.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+namespace util
+{
+namespace pixel_convert_kernels
+{
+
+enum class pack_kind
+{
+   /** 32bpp, 8-bit channels. */
+   rgb8888,
+   /** 16bpp, 5-bit red and blue, 6-bit green. */
+   rgb565,
+   /** 32bpp, 10-bit channels. */
+   rgb2101010,
+};
+
+pixel_converter::convert_rows_function get_generic_kernel(pack_kind kind, bool dither);
+
+#if defined(__arm__)
+/* Lives in pixel_convert_neon.cpp, the same kernels built with NEON enabled. */
+pixel_converter::convert_rows_function get_neon_kernel(pack_kind kind, bool dither);
+#endif
+
+namespace
+{
+
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+typedef uint16_t u16x4 __attribute__((vector_size(8)));
+
+constexpr uint8_t BAYER_4X4[4][4] = {
+   { 0, 8, 2, 10 },
+   { 12, 4, 14, 6 },
+   { 3, 11, 1, 9 },
+   { 15, 7, 13, 5 },
+};
+
+template <typename T>
+inline T saturate_u8(T value)
+{
+   /* Inputs never exceed 255 + 15, so bit 8 alone flags an overflow. */
+   return (value | (T{} - (value >> 8))) & 0xff;
+}
+
+template <uint8_t DST_BITS, bool DITHER, typename T>
+inline T convert_channel(T pixel, pixel_channel src, pixel_channel dst, T dither)
+{
+   T value = (pixel >> src.shift) & 0xff;
+
+   if constexpr (DST_BITS < 8)
+   {
+      static_assert(DST_BITS >= 4, "Dither thresholds only cover up to 4 dropped bits");
+      if constexpr (DITHER)
+      {
+         value = saturate_u8(value + (dither >> (DST_BITS - 4)));
+      }
+      value = value >> (8 - DST_BITS);
+   }
+   else if constexpr (DST_BITS > 8)
+   {
+      /* Replicate the top bits so 0xff maps to full intensity. */
+      value = (value << (DST_BITS - 8)) | (value >> (16 - DST_BITS));
+   }
+
+   return value << dst.shift;
+}
+
+template <pack_kind KIND, bool DITHER, typename T>
+inline T convert_pixel(T pixel, const pixel_converter::params &params, T dither)
+{
+   constexpr uint8_t RB_BITS = KIND == pack_kind::rgb565 ? 5 : (KIND == pack_kind::rgb2101010 ? 10 : 8);
+   constexpr uint8_t G_BITS = KIND == pack_kind::rgb565 ? 6 : RB_BITS;
+
+   T out = convert_channel<RB_BITS, DITHER>(pixel, params.src_red, params.dst_red, dither) |
+           convert_channel<G_BITS, DITHER>(pixel, params.src_green, params.dst_green, dither) |
+           convert_channel<RB_BITS, DITHER>(pixel, params.src_blue, params.dst_blue, dither);
+
+   if (params.dst_alpha.bits != 0)
+   {
+      /* Source alpha is always the top byte. */
+      out |= ((pixel >> 24) >> (8 - params.dst_alpha.bits)) << params.dst_alpha.shift;
+   }
+
+   return out;
+}
+
+template <pack_kind KIND, bool DITHER>
+void convert_rows(const pixel_converter::params &params, uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                  size_t src_stride, uint32_t width, uint32_t rows, uint32_t x, uint32_t y)
+{
+   using dst_pixel = typename std::conditional<KIND == pack_kind::rgb565, uint16_t, uint32_t>::type;
+
+   for (uint32_t row = 0; row < rows; row++)
+   {
+      const uint8_t *bayer_row = BAYER_4X4[(y + row) & 3];
+      /* Four pixels per vector and a pattern four wide, so every lane keeps the same threshold along the row. */
+      const u32x4 dither = { bayer_row[x & 3], bayer_row[(x + 1) & 3], bayer_row[(x + 2) & 3],
+                             bayer_row[(x + 3) & 3] };
+
+      const uint8_t *src_row = src + row * src_stride;
+      uint8_t *dst_row = dst + row * dst_stride;
+
+      uint32_t i = 0;
+      for (; i + 4 <= width; i += 4)
+      {
+         u32x4 pixels;
+         std::memcpy(&pixels, src_row + i * sizeof(uint32_t), sizeof(pixels));
+         const u32x4 out = convert_pixel<KIND, DITHER>(pixels, params, dither);
+
+         if constexpr (KIND == pack_kind::rgb565)
+         {
+            const u16x4 packed = __builtin_convertvector(out, u16x4);
+            std::memcpy(dst_row + i * sizeof(dst_pixel), &packed, sizeof(packed));
+         }
+         else
+         {
+            std::memcpy(dst_row + i * sizeof(dst_pixel), &out, sizeof(out));
+         }
+      }
+
+      for (; i < width; i++)
+      {
+         uint32_t pixel;
+         std::memcpy(&pixel, src_row + i * sizeof(uint32_t), sizeof(pixel));
+         const dst_pixel out =
+            static_cast<dst_pixel>(convert_pixel<KIND, DITHER>(pixel, params, uint32_t{ bayer_row[(x + i) & 3] }));
+         std::memcpy(dst_row + i * sizeof(dst_pixel), &out, sizeof(out));
+      }
+   }
+}
+
+inline pixel_converter::convert_rows_function select_kernel(pack_kind kind, bool dither)
+{
+   switch (kind)
+   {
+   case pack_kind::rgb565:
+      return dither ? convert_rows<pack_kind::rgb565, true> : convert_rows<pack_kind::rgb565, false>;
+   case pack_kind::rgb2101010:
+      return convert_rows<pack_kind::rgb2101010, false>;
+   case pack_kind::rgb8888:
+   default:
+      return convert_rows<pack_kind::rgb8888, false>;
+   }
+}
+
+} /* anonymous namespace */
+
+} /* namespace pixel_convert_kernels */
+} /* namespace util */
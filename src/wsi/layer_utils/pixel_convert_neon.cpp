@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_convert_neon.cpp
+ *
+ * @brief The pixel conversion kernels built with NEON enabled for 32-bit Arm.
+ *
+ * AArch64 and x86-64 get vector kernels from pixel_convert.cpp directly, their baseline has 128-bit vectors.
+ */
+
+#if defined(__arm__)
+
+#if !defined(__ARM_NEON) && !defined(__ARM_NEON__)
+#error "pixel_convert_neon.cpp must be built with NEON enabled (-mfpu=neon)"
+#endif
+
+#include "pixel_convert_kernels.hpp"
+
+namespace util
+{
+namespace pixel_convert_kernels
+{
+
+pixel_converter::convert_rows_function get_neon_kernel(pack_kind kind, bool dither)
+{
+   return select_kernel(kind, dither);
+}
+
+} /* namespace pixel_convert_kernels */
+} /* namespace util */
+
+#endif
@@ -0,0 +1,336 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_copy.cpp
+ *
+ * @brief Runtime selection of the pixel copy kernels, plus the scalar and x86 variants.
+ */
+
+#include "pixel_copy.hpp"
+#include "pixel_copy_kernels.hpp"
+#include "utils/logging.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__arm__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace util
+{
+namespace pixel_copy_kernels
+{
+
+static constexpr size_t CACHE_LINE_SIZE = 64;
+
+void copy_rows_scalar(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride, size_t row_bytes,
+                      uint32_t rows, bool /*streaming*/)
+{
+   for (uint32_t row = 0; row < rows; row++)
+   {
+      const uint8_t *src_row = src + row * src_stride;
+
+      if (row + 1 < rows)
+      {
+         const uint8_t *next_row = src_row + src_stride;
+         const size_t prefetch_bytes = std::min(row_bytes, PREFETCH_DISTANCE);
+         for (size_t offset = 0; offset < prefetch_bytes; offset += CACHE_LINE_SIZE)
+         {
+            __builtin_prefetch(next_row + offset, 0, 0);
+         }
+      }
+
+      std::memcpy(dst + row * dst_stride, src_row, row_bytes);
+   }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+template <bool STREAMING>
+__attribute__((target("sse2"), always_inline)) static inline void copy_row_sse2(uint8_t *dst, const uint8_t *src,
+                                                                                size_t bytes)
+{
+   if (STREAMING)
+   {
+      /* Streaming stores need an aligned destination. */
+      const size_t head = std::min(bytes, (16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15);
+      std::memcpy(dst, src, head);
+      dst += head;
+      src += head;
+      bytes -= head;
+   }
+
+   for (; bytes >= 64; bytes -= 64, src += 64, dst += 64)
+   {
+      _mm_prefetch(reinterpret_cast<const char *>(src + PREFETCH_DISTANCE), _MM_HINT_NTA);
+      const __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+      const __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 16));
+      const __m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 32));
+      const __m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 48));
+      if (STREAMING)
+      {
+         _mm_stream_si128(reinterpret_cast<__m128i *>(dst), v0);
+         _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 16), v1);
+         _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 32), v2);
+         _mm_stream_si128(reinterpret_cast<__m128i *>(dst + 48), v3);
+      }
+      else
+      {
+         _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v0);
+         _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), v1);
+         _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 32), v2);
+         _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 48), v3);
+      }
+   }
+
+   std::memcpy(dst, src, bytes);
+}
+
+__attribute__((target("sse2"))) void copy_rows_sse2(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                                                    size_t src_stride, size_t row_bytes, uint32_t rows, bool streaming)
+{
+   if (streaming)
+   {
+      for (uint32_t row = 0; row < rows; row++)
+      {
+         copy_row_sse2<true>(dst + row * dst_stride, src + row * src_stride, row_bytes);
+      }
+      /* Order the weakly ordered streaming stores before whatever tells the reader the data is there. */
+      _mm_sfence();
+   }
+   else
+   {
+      for (uint32_t row = 0; row < rows; row++)
+      {
+         copy_row_sse2<false>(dst + row * dst_stride, src + row * src_stride, row_bytes);
+      }
+   }
+}
+
+template <bool STREAMING>
+__attribute__((target("avx2"), always_inline)) static inline void copy_row_avx2(uint8_t *dst, const uint8_t *src,
+                                                                                size_t bytes)
+{
+   if (STREAMING)
+   {
+      const size_t head = std::min(bytes, (32 - (reinterpret_cast<uintptr_t>(dst) & 31)) & 31);
+      std::memcpy(dst, src, head);
+      dst += head;
+      src += head;
+      bytes -= head;
+   }
+
+   for (; bytes >= 128; bytes -= 128, src += 128, dst += 128)
+   {
+      _mm_prefetch(reinterpret_cast<const char *>(src + PREFETCH_DISTANCE), _MM_HINT_NTA);
+      _mm_prefetch(reinterpret_cast<const char *>(src + PREFETCH_DISTANCE + CACHE_LINE_SIZE), _MM_HINT_NTA);
+      const __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+      const __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 32));
+      const __m256i v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 64));
+      const __m256i v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 96));
+      if (STREAMING)
+      {
+         _mm256_stream_si256(reinterpret_cast<__m256i *>(dst), v0);
+         _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 32), v1);
+         _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 64), v2);
+         _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + 96), v3);
+      }
+      else
+      {
+         _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), v0);
+         _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), v1);
+         _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 64), v2);
+         _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 96), v3);
+      }
+   }
+
+   std::memcpy(dst, src, bytes);
+}
+
+__attribute__((target("avx2"))) void copy_rows_avx2(uint8_t *dst, size_t dst_stride, const uint8_t *src,
+                                                    size_t src_stride, size_t row_bytes, uint32_t rows, bool streaming)
+{
+   if (streaming)
+   {
+      for (uint32_t row = 0; row < rows; row++)
+      {
+         copy_row_avx2<true>(dst + row * dst_stride, src + row * src_stride, row_bytes);
+      }
+      _mm_sfence();
+   }
+   else
+   {
+      for (uint32_t row = 0; row < rows; row++)
+      {
+         copy_row_avx2<false>(dst + row * dst_stride, src + row * src_stride, row_bytes);
+      }
+   }
+}
+
+#endif
+
+} /* namespace pixel_copy_kernels */
+
+namespace
+{
+
+struct pixel_copy_dispatch
+{
+   pixel_copy_isa isa;
+   pixel_copy_kernels::copy_rows_function copy_rows;
+};
+
+bool is_isa_supported(pixel_copy_isa isa)
+{
+   switch (isa)
+   {
+   case pixel_copy_isa::scalar:
+      return true;
+#if defined(__x86_64__) || defined(__i386__)
+   case pixel_copy_isa::sse2:
+      return __builtin_cpu_supports("sse2");
+   case pixel_copy_isa::avx2:
+      return __builtin_cpu_supports("avx2");
+#elif defined(__aarch64__)
+   case pixel_copy_isa::neon:
+      return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#elif defined(__arm__)
+   case pixel_copy_isa::neon:
+      return (getauxval(AT_HWCAP) & HWCAP_NEON) != 0;
+#endif
+   default:
+      return false;
+   }
+}
+
+pixel_copy_kernels::copy_rows_function get_kernel(pixel_copy_isa isa)
+{
+   switch (isa)
+   {
+#if defined(__x86_64__) || defined(__i386__)
+   case pixel_copy_isa::sse2:
+      return pixel_copy_kernels::copy_rows_sse2;
+   case pixel_copy_isa::avx2:
+      return pixel_copy_kernels::copy_rows_avx2;
+#elif defined(__aarch64__) || defined(__arm__)
+   case pixel_copy_isa::neon:
+      return pixel_copy_kernels::copy_rows_neon;
+#endif
+   default:
+      return pixel_copy_kernels::copy_rows_scalar;
+   }
+}
+
+pixel_copy_dispatch select_dispatch()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   __builtin_cpu_init();
+#endif
+
+   /* Widest first. */
+   static constexpr pixel_copy_isa preference[] = { pixel_copy_isa::avx2, pixel_copy_isa::neon, pixel_copy_isa::sse2,
+                                                    pixel_copy_isa::scalar };
+
+   pixel_copy_isa isa = pixel_copy_isa::scalar;
+   for (pixel_copy_isa candidate : preference)
+   {
+      if (is_isa_supported(candidate))
+      {
+         isa = candidate;
+         break;
+      }
+   }
+
+   const char *override_env = std::getenv("MALI_WRAPPER_PIXEL_COPY_ISA");
+   if (override_env != nullptr)
+   {
+      bool applied = false;
+      for (pixel_copy_isa candidate : preference)
+      {
+         if (std::strcmp(override_env, pixel_copy_isa_name(candidate)) == 0 && is_isa_supported(candidate))
+         {
+            isa = candidate;
+            applied = true;
+            break;
+         }
+      }
+
+      if (!applied)
+      {
+         WSI_LOG_WARNING("Ignoring MALI_WRAPPER_PIXEL_COPY_ISA=%s, not supported on this CPU", override_env);
+      }
+   }
+
+   WSI_LOG_INFO("Pixel copy engine using %s kernels", pixel_copy_isa_name(isa));
+   return { isa, get_kernel(isa) };
+}
+
+const pixel_copy_dispatch &get_dispatch()
+{
+   static const pixel_copy_dispatch dispatch = select_dispatch();
+   return dispatch;
+}
+
+} /* anonymous namespace */
+
+void copy_pixel_rows(void *dst, size_t dst_stride, const void *src, size_t src_stride, size_t row_bytes,
+                     uint32_t rows, copy_destination destination)
+{
+   if (dst == nullptr || src == nullptr || row_bytes == 0 || rows == 0)
+   {
+      return;
+   }
+
+   get_dispatch().copy_rows(static_cast<uint8_t *>(dst), dst_stride, static_cast<const uint8_t *>(src), src_stride,
+                            row_bytes, rows, destination == copy_destination::write_only);
+}
+
+pixel_copy_isa get_pixel_copy_isa()
+{
+   return get_dispatch().isa;
+}
+
+const char *pixel_copy_isa_name(pixel_copy_isa isa)
+{
+   switch (isa)
+   {
+   case pixel_copy_isa::sse2:
+      return "sse2";
+   case pixel_copy_isa::avx2:
+      return "avx2";
+   case pixel_copy_isa::neon:
+      return "neon";
+   case pixel_copy_isa::scalar:
+   default:
+      return "scalar";
+   }
+}
+
+} /* namespace util */
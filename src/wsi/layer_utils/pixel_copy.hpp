@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_copy.hpp
+ *
+ * @brief Row based pixel transfer engine shared by the CPU presentation paths.
+ *
+ * The kernels (scalar, SSE2, AVX2, NEON) are selected once at runtime from the CPU features reported by
+ * cpuid/HWCAP, so a single binary runs the widest variant the machine supports.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+
+/**
+ * @brief Instruction set used by the pixel copy kernels.
+ */
+enum class pixel_copy_isa
+{
+   scalar,
+   sse2,
+   avx2,
+   neon,
+};
+
+/**
+ * @brief Total transfer size from which streaming stores pay off.
+ *
+ * Below this the copy fits in the cache levels the reader is likely to hit, bypassing them would only make the
+ * reader miss.
+ */
+static constexpr size_t STREAMING_COPY_MIN_BYTES = 1024 * 1024;
+
+/**
+ * @brief How the destination of a copy is going to be used.
+ */
+enum class copy_destination
+{
+   /** The CPU may read the destination back soon, keep it in cache. */
+   cached,
+   /**
+    * Only another agent (the X server, a display engine) reads the destination. Uses streaming stores where the
+    * instruction set has them, so the copy does not evict the rest of the working set. Meant for transfers of at
+    * least STREAMING_COPY_MIN_BYTES in total.
+    */
+   write_only,
+};
+
+/**
+ * @brief Copy a block of rows.
+ *
+ * @param dst         Destination of the first row.
+ * @param dst_stride  Distance in bytes between destination rows.
+ * @param src         Source of the first row.
+ * @param src_stride  Distance in bytes between source rows.
+ * @param row_bytes   Number of bytes copied per row.
+ * @param rows        Number of rows.
+ * @param destination Usage of the destination, see @ref copy_destination.
+ */
+void copy_pixel_rows(void *dst, size_t dst_stride, const void *src, size_t src_stride, size_t row_bytes,
+                     uint32_t rows, copy_destination destination);
+
+/**
+ * @brief Get the instruction set selected for this process.
+ *
+ * Can be lowered with MALI_WRAPPER_PIXEL_COPY_ISA=scalar|sse2|avx2|neon, a variant the CPU does not support is ignored.
+ */
+pixel_copy_isa get_pixel_copy_isa();
+
+/**
+ * @brief Printable name of @p isa.
+ */
+const char *pixel_copy_isa_name(pixel_copy_isa isa);
+
+} /* namespace util */
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_copy_kernels.hpp
+ *
+ * @brief Per instruction set kernels behind util::copy_pixel_rows. Internal to the pixel copy engine.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+namespace pixel_copy_kernels
+{
+
+/** Bytes the source prefetch runs ahead of the loads. */
+static constexpr size_t PREFETCH_DISTANCE = 512;
+
+using copy_rows_function = void (*)(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride,
+                                    size_t row_bytes, uint32_t rows, bool streaming);
+
+void copy_rows_scalar(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride, size_t row_bytes,
+                      uint32_t rows, bool streaming);
+
+#if defined(__x86_64__) || defined(__i386__)
+void copy_rows_sse2(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride, size_t row_bytes,
+                    uint32_t rows, bool streaming);
+void copy_rows_avx2(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride, size_t row_bytes,
+                    uint32_t rows, bool streaming);
+#endif
+
+#if defined(__aarch64__) || defined(__arm__)
+/* Lives in pixel_copy_neon.cpp, the only file built with NEON enabled on 32-bit Arm. */
+void copy_rows_neon(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride, size_t row_bytes,
+                    uint32_t rows, bool streaming);
+#endif
+
+} /* namespace pixel_copy_kernels */
+} /* namespace util */
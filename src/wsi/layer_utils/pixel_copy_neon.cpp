@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_copy_neon.cpp
+ *
+ * @brief NEON pixel copy kernel for AArch64 and ARMv7.
+ *
+ * Built with NEON enabled even on 32-bit Arm, where it is only called after HWCAP reported NEON support. Nothing
+ * else may go in this file, the compiler is free to use NEON anywhere in it.
+ */
+
+#if defined(__aarch64__) || defined(__arm__)
+
+#if !defined(__ARM_NEON) && !defined(__ARM_NEON__)
+#error "pixel_copy_neon.cpp must be built with NEON enabled (-mfpu=neon on 32-bit Arm)"
+#endif
+
+#include "pixel_copy_kernels.hpp"
+
+#include <arm_neon.h>
+#include <cstring>
+
+namespace util
+{
+namespace pixel_copy_kernels
+{
+
+template <bool STREAMING>
+static inline void copy_row_neon(uint8_t *dst, const uint8_t *src, size_t bytes)
+{
+   for (; bytes >= 64; bytes -= 64, src += 64, dst += 64)
+   {
+      __builtin_prefetch(src + PREFETCH_DISTANCE, 0, 0);
+      const uint8x16_t v0 = vld1q_u8(src);
+      const uint8x16_t v1 = vld1q_u8(src + 16);
+      const uint8x16_t v2 = vld1q_u8(src + 32);
+      const uint8x16_t v3 = vld1q_u8(src + 48);
+#if defined(__aarch64__)
+      if (STREAMING)
+      {
+         /* No intrinsic exists for STNP, the non-temporal hint of AArch64. */
+         __asm__ volatile("stnp %q[v0], %q[v1], [%[dst]]\n\t"
+                          "stnp %q[v2], %q[v3], [%[dst], #32]"
+                          :
+                          : [v0] "w"(v0), [v1] "w"(v1), [v2] "w"(v2), [v3] "w"(v3), [dst] "r"(dst)
+                          : "memory");
+         continue;
+      }
+#endif
+      vst1q_u8(dst, v0);
+      vst1q_u8(dst + 16, v1);
+      vst1q_u8(dst + 32, v2);
+      vst1q_u8(dst + 48, v3);
+   }
+
+   std::memcpy(dst, src, bytes);
+}
+
+void copy_rows_neon(uint8_t *dst, size_t dst_stride, const uint8_t *src, size_t src_stride, size_t row_bytes,
+                    uint32_t rows, bool streaming)
+{
+   if (streaming)
+   {
+      for (uint32_t row = 0; row < rows; row++)
+      {
+         copy_row_neon<true>(dst + row * dst_stride, src + row * src_stride, row_bytes);
+      }
+#if defined(__aarch64__)
+      __asm__ volatile("dmb ishst" ::: "memory");
+#endif
+   }
+   else
+   {
+      for (uint32_t row = 0; row < rows; row++)
+      {
+         copy_row_neon<false>(dst + row * dst_stride, src + row * src_stride, row_bytes);
+      }
+   }
+}
+
+} /* namespace pixel_copy_kernels */
+} /* namespace util */
+
+#endif
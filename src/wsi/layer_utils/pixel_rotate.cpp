@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_rotate.cpp
+ *
+ * @brief Kernel selection for util::rotate_pixels.
+ */
+
+#include "pixel_rotate.hpp"
+#include "pixel_rotate_kernels.hpp"
+#include "pixel_copy.hpp"
+
+namespace util
+{
+
+namespace pixel_rotate_kernels
+{
+
+const kernel_table &get_generic_kernels()
+{
+   return KERNELS;
+}
+
+} /* namespace pixel_rotate_kernels */
+
+static const pixel_rotate_kernels::kernel_table &get_kernels()
+{
+#if defined(__arm__)
+   static const pixel_rotate_kernels::kernel_table &kernels = get_pixel_copy_isa() == pixel_copy_isa::neon ?
+                                                                 pixel_rotate_kernels::get_neon_kernels() :
+                                                                 pixel_rotate_kernels::get_generic_kernels();
+   return kernels;
+#else
+   return pixel_rotate_kernels::get_generic_kernels();
+#endif
+}
+
+void rotate_pixels(void *dst, size_t dst_stride, const void *src, size_t src_stride, uint32_t src_width,
+                   uint32_t src_height, pixel_rotation rotation, uint32_t x, uint32_t y, uint32_t width,
+                   uint32_t height)
+{
+   uint32_t *dst_pixels = static_cast<uint32_t *>(dst);
+   const uint32_t *src_pixels = static_cast<const uint32_t *>(src);
+   const size_t dst_stride_pixels = dst_stride / sizeof(uint32_t);
+   const size_t src_stride_pixels = src_stride / sizeof(uint32_t);
+
+   pixel_rotate_kernels::rotate_fn rotate = nullptr;
+   switch (rotation)
+   {
+   case pixel_rotation::rotate_90:
+      rotate = get_kernels().rotate_90;
+      break;
+   case pixel_rotation::rotate_180:
+      rotate = get_kernels().rotate_180;
+      break;
+   case pixel_rotation::rotate_270:
+      rotate = get_kernels().rotate_270;
+      break;
+   case pixel_rotation::none:
+   default:
+      copy_pixel_rows(dst, dst_stride, src_pixels + y * src_stride_pixels + x, src_stride, width * sizeof(uint32_t),
+                      height, copy_destination::cached);
+      return;
+   }
+
+   rotate(dst_pixels, dst_stride_pixels, src_pixels, src_stride_pixels, src_width, src_height, x, y, width, height);
+}
+
+} /* namespace util */
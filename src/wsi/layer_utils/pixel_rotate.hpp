@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_rotate.hpp
+ *
+ * @brief Rotation of 32bpp images by multiples of 90 degrees for the CPU presentation paths.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace util
+{
+
+/**
+ * @brief Clockwise rotation applied to an image.
+ */
+enum class pixel_rotation
+{
+   none,
+   rotate_90,
+   rotate_180,
+   rotate_270,
+};
+
+/**
+ * @brief Whether the rotation swaps the width and height of the image.
+ */
+inline bool rotation_swaps_extent(pixel_rotation rotation)
+{
+   return rotation == pixel_rotation::rotate_90 || rotation == pixel_rotation::rotate_270;
+}
+
+/**
+ * @brief Produce a rectangle of the rotated image.
+ *
+ * The quarter turns transpose 4x4 pixel blocks in registers, visiting them in tiles small enough for the source rows
+ * of a tile to stay in L1, so each source cache line is fetched once instead of once per destination row.
+ *
+ * Safe to call from several threads at once for disjoint rectangles.
+ *
+ * @param dst        Destination of the rectangle's top left pixel.
+ * @param dst_stride Distance in bytes between destination rows.
+ * @param src        First row of the image before rotation.
+ * @param src_stride Distance in bytes between source rows.
+ * @param src_width  Width of the image before rotation.
+ * @param src_height Height of the image before rotation.
+ * @param rotation   Rotation to apply.
+ * @param x, y       Top left corner of the rectangle, in rotated image coordinates.
+ * @param width      Width of the rectangle.
+ * @param height     Height of the rectangle.
+ */
+void rotate_pixels(void *dst, size_t dst_stride, const void *src, size_t src_stride, uint32_t src_width,
+                   uint32_t src_height, pixel_rotation rotation, uint32_t x, uint32_t y, uint32_t width,
+                   uint32_t height);
+
+} /* namespace util */
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_rotate_kernels.hpp
+ *
+ * @brief Rotation kernels behind util::rotate_pixels. Internal to the rotation code.
+ *
+ * Built per instruction set the same way as the pixel conversion kernels, see pixel_convert_kernels.hpp.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace util
+{
+namespace pixel_rotate_kernels
+{
+
+/**
+ * @brief Rotation of the rectangle (x, y, width, height) of the rotated image into dst.
+ *
+ * @p src is the image before rotation, of @p src_width x @p src_height pixels. Strides are in pixels.
+ */
+typedef void (*rotate_fn)(uint32_t *dst, size_t dst_stride, const uint32_t *src, size_t src_stride,
+                          uint32_t src_width, uint32_t src_height, uint32_t x, uint32_t y, uint32_t width,
+                          uint32_t height);
+
+struct kernel_table
+{
+   rotate_fn rotate_90;
+   rotate_fn rotate_180;
+   rotate_fn rotate_270;
+};
+
+const kernel_table &get_generic_kernels();
+
+#if defined(__arm__)
+/* Lives in pixel_rotate_neon.cpp, the same kernels built with NEON enabled. */
+const kernel_table &get_neon_kernels();
+#endif
+
+namespace
+{
+
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+/* 32x32 pixels is 4 KiB of source per tile, which stays in L1 while the tile's destination rows are written. */
+constexpr uint32_t TILE_SIZE = 32;
+constexpr uint32_t BLOCK_SIZE = 4;
+
+inline u32x4 load_block_row(const uint32_t *pixels)
+{
+   u32x4 row;
+   std::memcpy(&row, pixels, sizeof(row));
+   return row;
+}
+
+inline void store_block_row(uint32_t *pixels, u32x4 row)
+{
+   std::memcpy(pixels, &row, sizeof(row));
+}
+
+/**
+ * @brief Transpose the 4x4 block held in r0-r3, in registers.
+ */
+inline void transpose_block(u32x4 &r0, u32x4 &r1, u32x4 &r2, u32x4 &r3)
+{
+   const u32x4 t0 = __builtin_shuffle(r0, r1, u32x4{ 0, 4, 1, 5 });
+   const u32x4 t1 = __builtin_shuffle(r0, r1, u32x4{ 2, 6, 3, 7 });
+   const u32x4 t2 = __builtin_shuffle(r2, r3, u32x4{ 0, 4, 1, 5 });
+   const u32x4 t3 = __builtin_shuffle(r2, r3, u32x4{ 2, 6, 3, 7 });
+   r0 = __builtin_shuffle(t0, t2, u32x4{ 0, 1, 4, 5 });
+   r1 = __builtin_shuffle(t0, t2, u32x4{ 2, 3, 6, 7 });
+   r2 = __builtin_shuffle(t1, t3, u32x4{ 0, 1, 4, 5 });
+   r3 = __builtin_shuffle(t1, t3, u32x4{ 2, 3, 6, 7 });
+}
+
+/**
+ * @brief Visit a width x height rectangle tile by tile, as 4x4 blocks plus single pixels along the edges.
+ *
+ * Blocks are visited down the columns of a tile. Destination columns are source rows for the quarter turns, so the
+ * source is read sequentially, which the hardware prefetchers follow better than the strided destination writes.
+ */
+template <typename BlockFn, typename PixelFn>
+inline void for_each_tile(uint32_t width, uint32_t height, BlockFn block, PixelFn pixel)
+{
+   for (uint32_t tile_y = 0; tile_y < height; tile_y += TILE_SIZE)
+   {
+      const uint32_t tile_bottom = std::min(tile_y + TILE_SIZE, height);
+      for (uint32_t tile_x = 0; tile_x < width; tile_x += TILE_SIZE)
+      {
+         const uint32_t tile_right = std::min(tile_x + TILE_SIZE, width);
+
+         for (uint32_t column = tile_x; column + BLOCK_SIZE <= tile_right; column += BLOCK_SIZE)
+         {
+            for (uint32_t row = tile_y; row + BLOCK_SIZE <= tile_bottom; row += BLOCK_SIZE)
+            {
+               block(column, row);
+            }
+         }
+
+         /* Right and bottom edges left over by the blocks. */
+         const uint32_t full_right = tile_x + (tile_right - tile_x) / BLOCK_SIZE * BLOCK_SIZE;
+         const uint32_t full_bottom = tile_y + (tile_bottom - tile_y) / BLOCK_SIZE * BLOCK_SIZE;
+         for (uint32_t row = tile_y; row < tile_bottom; row++)
+         {
+            for (uint32_t column = row < full_bottom ? full_right : tile_x; column < tile_right; column++)
+            {
+               pixel(column, row);
+            }
+         }
+      }
+   }
+}
+
+/* rotated(x, y) = src(y, src_height - 1 - x) */
+void rotate_90(uint32_t *dst, size_t dst_stride, const uint32_t *src, size_t src_stride, uint32_t /*src_width*/,
+               uint32_t src_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+   auto source = [&](uint32_t column, uint32_t row) {
+      return src + static_cast<size_t>(src_height - 1 - (x + column)) * src_stride + (y + row);
+   };
+
+   /* Destination columns walk source rows upwards, so the block's rows are loaded bottom up. */
+   auto block = [&](uint32_t column, uint32_t row) {
+      const uint32_t *s = source(column, row);
+      u32x4 r0 = load_block_row(s);
+      u32x4 r1 = load_block_row(s - src_stride);
+      u32x4 r2 = load_block_row(s - 2 * src_stride);
+      u32x4 r3 = load_block_row(s - 3 * src_stride);
+      transpose_block(r0, r1, r2, r3);
+
+      uint32_t *d = dst + row * dst_stride + column;
+      store_block_row(d, r0);
+      store_block_row(d + dst_stride, r1);
+      store_block_row(d + 2 * dst_stride, r2);
+      store_block_row(d + 3 * dst_stride, r3);
+   };
+   auto pixel = [&](uint32_t column, uint32_t row) { dst[row * dst_stride + column] = *source(column, row); };
+
+   for_each_tile(width, height, block, pixel);
+}
+
+/* rotated(x, y) = src(src_width - 1 - x, src_height - 1 - y) */
+void rotate_180(uint32_t *dst, size_t dst_stride, const uint32_t *src, size_t src_stride, uint32_t src_width,
+                uint32_t src_height, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+   /* Rows stay rows, reversed, so this streams like a plain copy. */
+   for (uint32_t row = 0; row < height; row++)
+   {
+      const uint32_t *s = src + static_cast<size_t>(src_height - 1 - (y + row)) * src_stride + (src_width - 1 - x);
+      uint32_t *d = dst + row * dst_stride;
+
+      uint32_t column = 0;
+      for (; column + BLOCK_SIZE <= width; column += BLOCK_SIZE)
+      {
+         const u32x4 pixels = load_block_row(s - column - (BLOCK_SIZE - 1));
+         store_block_row(d + column, __builtin_shuffle(pixels, u32x4{ 3, 2, 1, 0 }));
+      }
+      for (; column < width; column++)
+      {
+         d[column] = *(s - column);
+      }
+   }
+}
+
+/* rotated(x, y) = src(src_width - 1 - y, x) */
+void rotate_270(uint32_t *dst, size_t dst_stride, const uint32_t *src, size_t src_stride, uint32_t src_width,
+                uint32_t /*src_height*/, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+   auto source = [&](uint32_t column, uint32_t row) {
+      return src + static_cast<size_t>(x + column) * src_stride + (src_width - 1 - (y + row));
+   };
+
+   /* Destination rows walk source columns leftwards, so the transposed rows are stored bottom up. */
+   auto block = [&](uint32_t column, uint32_t row) {
+      const uint32_t *s = source(column, row + BLOCK_SIZE - 1);
+      u32x4 r0 = load_block_row(s);
+      u32x4 r1 = load_block_row(s + src_stride);
+      u32x4 r2 = load_block_row(s + 2 * src_stride);
+      u32x4 r3 = load_block_row(s + 3 * src_stride);
+      transpose_block(r0, r1, r2, r3);
+
+      uint32_t *d = dst + row * dst_stride + column;
+      store_block_row(d, r3);
+      store_block_row(d + dst_stride, r2);
+      store_block_row(d + 2 * dst_stride, r1);
+      store_block_row(d + 3 * dst_stride, r0);
+   };
+   auto pixel = [&](uint32_t column, uint32_t row) { dst[row * dst_stride + column] = *source(column, row); };
+
+   for_each_tile(width, height, block, pixel);
+}
+
+constexpr kernel_table KERNELS = { rotate_90, rotate_180, rotate_270 };
+
+} /* anonymous namespace */
+
+} /* namespace pixel_rotate_kernels */
+} /* namespace util */
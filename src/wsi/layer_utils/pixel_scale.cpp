@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_scale.cpp
+ *
+ * @brief Scaling tables and row driver for util::pixel_scaler.
+ */
+
+#include "pixel_scale.hpp"
+#include "pixel_scale_kernels.hpp"
+#include "pixel_copy.hpp"
+
+#include <algorithm>
+
+namespace util
+{
+
+namespace pixel_scale_kernels
+{
+
+const kernel_table &get_generic_kernels()
+{
+   return KERNELS;
+}
+
+} /* namespace pixel_scale_kernels */
+
+/**
+ * @brief Source position of destination pixel @p dst in 16.16 fixed point, pixel-centre aligned and clamped.
+ */
+static uint32_t source_position(uint32_t dst, uint32_t step, uint32_t src_size)
+{
+   const int64_t position = static_cast<int64_t>(dst) * step + step / 2 - 0x8000;
+   const int64_t last = static_cast<int64_t>(src_size - 1) << 16;
+   return static_cast<uint32_t>(std::clamp<int64_t>(position, 0, last));
+}
+
+/**
+ * @brief Source pixel whose centre is nearest to the centre of destination pixel @p dst, in exact integer arithmetic.
+ */
+static uint32_t nearest_source(uint32_t dst, uint32_t src_size, uint32_t dst_size)
+{
+   const uint64_t centre = static_cast<uint64_t>(2 * dst + 1) * src_size;
+   return static_cast<uint32_t>(centre / (2 * static_cast<uint64_t>(dst_size)));
+}
+
+bool pixel_scaler::configure(uint32_t src_width, uint32_t src_height, uint32_t dst_width, uint32_t dst_height,
+                             scale_filter filter)
+{
+   if (src_width == 0 || src_height == 0 || dst_width == 0 || dst_height == 0)
+   {
+      return false;
+   }
+
+   if (src_width == m_src_width && src_height == m_src_height && dst_width == m_dst_width &&
+       dst_height == m_dst_height && filter == m_filter && m_kernels != nullptr)
+   {
+      return true;
+   }
+
+#if defined(__arm__)
+   m_kernels = get_pixel_copy_isa() == pixel_copy_isa::neon ? &pixel_scale_kernels::get_neon_kernels() :
+                                                              &pixel_scale_kernels::get_generic_kernels();
+#else
+   m_kernels = &pixel_scale_kernels::get_generic_kernels();
+#endif
+
+   m_src_width = src_width;
+   m_src_height = src_height;
+   m_dst_width = dst_width;
+   m_dst_height = dst_height;
+   m_filter = filter;
+   m_x_step = static_cast<uint32_t>((static_cast<uint64_t>(src_width) << 16) / dst_width);
+   m_y_step = static_cast<uint32_t>((static_cast<uint64_t>(src_height) << 16) / dst_height);
+
+   m_x_index.resize(dst_width);
+   m_x_weight.resize(filter == scale_filter::bilinear ? dst_width : 0);
+   for (uint32_t x = 0; x < dst_width; x++)
+   {
+      if (filter == scale_filter::bilinear)
+      {
+         const uint32_t position = source_position(x, m_x_step, src_width);
+         m_x_index[x] = position >> 16;
+         m_x_weight[x] = (position >> 8) & 0xff;
+      }
+      else
+      {
+         m_x_index[x] = nearest_source(x, src_width, dst_width);
+      }
+   }
+
+   return true;
+}
+
+void pixel_scaler::scale_rows(void *dst, size_t dst_stride, const void *src, size_t src_stride, uint32_t begin_row,
+                              uint32_t end_row) const
+{
+   const uint8_t *src_bytes = static_cast<const uint8_t *>(src);
+   uint8_t *dst_bytes = static_cast<uint8_t *>(dst);
+
+   if (m_filter == scale_filter::nearest)
+   {
+      const bool doubled = m_dst_width == 2 * m_src_width;
+      for (uint32_t row = begin_row; row < end_row; row++)
+      {
+         const uint32_t src_row = nearest_source(row, m_src_height, m_dst_height);
+         const uint32_t *src_pixels = reinterpret_cast<const uint32_t *>(src_bytes + src_row * src_stride);
+         uint32_t *dst_pixels = reinterpret_cast<uint32_t *>(dst_bytes + (row - begin_row) * dst_stride);
+
+         if (doubled)
+         {
+            m_kernels->double_columns(dst_pixels, src_pixels, m_dst_width);
+         }
+         else
+         {
+            m_kernels->gather(dst_pixels, src_pixels, m_x_index.data(), m_dst_width);
+         }
+      }
+      return;
+   }
+
+   /* Vertically blended source row plus one duplicated pixel, so the right neighbour of the last column exists. */
+   thread_local std::vector<uint32_t> blended_row;
+   blended_row.resize(m_src_width + 1);
+
+   uint32_t blended_index = UINT32_MAX;
+   uint32_t blended_weight = 0;
+   for (uint32_t row = begin_row; row < end_row; row++)
+   {
+      const uint32_t position = source_position(row, m_y_step, m_src_height);
+      const uint32_t top = position >> 16;
+      const uint32_t weight = (position >> 8) & 0xff;
+
+      /* Strong magnification maps runs of destination rows to the same blend. */
+      if (top != blended_index || weight != blended_weight)
+      {
+         const uint32_t bottom = std::min(top + 1, m_src_height - 1);
+         m_kernels->blend_rows(blended_row.data(), reinterpret_cast<const uint32_t *>(src_bytes + top * src_stride),
+                               reinterpret_cast<const uint32_t *>(src_bytes + bottom * src_stride), m_src_width,
+                               weight);
+         blended_row[m_src_width] = blended_row[m_src_width - 1];
+         blended_index = top;
+         blended_weight = weight;
+      }
+
+      m_kernels->blend_columns(reinterpret_cast<uint32_t *>(dst_bytes + (row - begin_row) * dst_stride),
+                               blended_row.data(), m_x_index.data(), m_x_weight.data(), m_dst_width);
+   }
+}
+
+} /* namespace util */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_scale.hpp
+ *
+ * @brief 2D scaling of 32bpp images for the CPU presentation paths.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace util
+{
+
+enum class scale_filter
+{
+   nearest,
+   bilinear,
+};
+
+namespace pixel_scale_kernels
+{
+struct kernel_table;
+} /* namespace pixel_scale_kernels */
+
+/**
+ * @brief Scales 32bpp images, with any 8-bit per channel layout, to a different size.
+ *
+ * Sampling is pixel-centre aligned. Bilinear uses 8-bit fixed point weights and is meant for magnification and mild
+ * minification, it does not filter away aliasing when shrinking by more than 2x.
+ */
+class pixel_scaler
+{
+public:
+   /**
+    * @brief Prepare the scaling tables, a no-op when nothing changed since the previous call.
+    *
+    * @return false if any extent is zero.
+    */
+   bool configure(uint32_t src_width, uint32_t src_height, uint32_t dst_width, uint32_t dst_height,
+                  scale_filter filter);
+
+   uint32_t get_dst_width() const
+   {
+      return m_dst_width;
+   }
+
+   uint32_t get_dst_height() const
+   {
+      return m_dst_height;
+   }
+
+   /**
+    * @brief Produce destination rows [@p begin_row, @p end_row).
+    *
+    * Safe to call from several threads at once for disjoint row ranges.
+    *
+    * @param dst        Destination of row @p begin_row.
+    * @param dst_stride Distance in bytes between destination rows.
+    * @param src        First row of the source image.
+    * @param src_stride Distance in bytes between source rows.
+    * @param begin_row  First destination row to produce.
+    * @param end_row    One past the last destination row to produce.
+    */
+   void scale_rows(void *dst, size_t dst_stride, const void *src, size_t src_stride, uint32_t begin_row,
+                   uint32_t end_row) const;
+
+private:
+   uint32_t m_src_width = 0;
+   uint32_t m_src_height = 0;
+   uint32_t m_dst_width = 0;
+   uint32_t m_dst_height = 0;
+   scale_filter m_filter = scale_filter::nearest;
+
+   /** Source step per destination pixel, 16.16 fixed point. */
+   uint32_t m_x_step = 0;
+   uint32_t m_y_step = 0;
+
+   /** Left source pixel for each destination column. */
+   std::vector<uint32_t> m_x_index;
+   /** Weight of the right neighbour for each destination column, bilinear only. */
+   std::vector<uint16_t> m_x_weight;
+
+   const pixel_scale_kernels::kernel_table *m_kernels = nullptr;
+};
+
+} /* namespace util */
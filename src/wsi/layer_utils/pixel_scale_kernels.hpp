@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file pixel_scale_kernels.hpp
+ *
+ * @brief Row kernels behind util::pixel_scaler. Internal to the scaling code.
+ *
+ * Built per instruction set the same way as the pixel conversion kernels, see pixel_convert_kernels.hpp.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace util
+{
+namespace pixel_scale_kernels
+{
+
+struct kernel_table
+{
+   /** out[i] = top[i] * (256 - weight) + bottom[i] * weight, per channel, for @p width pixels. */
+   void (*blend_rows)(uint32_t *out, const uint32_t *top, const uint32_t *bottom, uint32_t width, uint32_t weight);
+   /** out[x] = row[index[x]] * (256 - weight[x]) + row[index[x] + 1] * weight[x], per channel. */
+   void (*blend_columns)(uint32_t *out, const uint32_t *row, const uint32_t *index, const uint16_t *weight,
+                         uint32_t width);
+   /** out[x] = row[index[x]]. */
+   void (*gather)(uint32_t *out, const uint32_t *row, const uint32_t *index, uint32_t width);
+   /** out[x] = row[x / 2]. */
+   void (*double_columns)(uint32_t *out, const uint32_t *row, uint32_t width);
+};
+
+const kernel_table &get_generic_kernels();
+
+#if defined(__arm__)
+/* Lives in pixel_scale_neon.cpp, the same kernels built with NEON enabled. */
+const kernel_table &get_neon_kernels();
+#endif
+
+namespace
+{
+
+typedef uint8_t u8x8 __attribute__((vector_size(8)));
+typedef uint8_t u8x4 __attribute__((vector_size(4)));
+typedef uint16_t u16x8 __attribute__((vector_size(16)));
+typedef uint16_t u16x4 __attribute__((vector_size(8)));
+typedef uint32_t u32x4 __attribute__((vector_size(16)));
+
+void blend_rows(uint32_t *out, const uint32_t *top, const uint32_t *bottom, uint32_t width, uint32_t weight)
+{
+   if (weight == 0)
+   {
+      std::memcpy(out, top, width * sizeof(uint32_t));
+      return;
+   }
+
+   const uint16_t bottom_weight = static_cast<uint16_t>(weight);
+   const uint16_t top_weight = static_cast<uint16_t>(256 - weight);
+   const uint8_t *top_bytes = reinterpret_cast<const uint8_t *>(top);
+   const uint8_t *bottom_bytes = reinterpret_cast<const uint8_t *>(bottom);
+   uint8_t *out_bytes = reinterpret_cast<uint8_t *>(out);
+   const size_t bytes = width * sizeof(uint32_t);
+
+   size_t i = 0;
+   for (; i + sizeof(u8x8) <= bytes; i += sizeof(u8x8))
+   {
+      u8x8 t, b;
+      std::memcpy(&t, top_bytes + i, sizeof(t));
+      std::memcpy(&b, bottom_bytes + i, sizeof(b));
+      /* 255 * 256 is the largest sum, it fits 16 bits. */
+      const u16x8 sum =
+         __builtin_convertvector(t, u16x8) * top_weight + __builtin_convertvector(b, u16x8) * bottom_weight;
+      const u8x8 result = __builtin_convertvector(sum >> 8, u8x8);
+      std::memcpy(out_bytes + i, &result, sizeof(result));
+   }
+
+   for (; i < bytes; i++)
+   {
+      out_bytes[i] = static_cast<uint8_t>((top_bytes[i] * top_weight + bottom_bytes[i] * bottom_weight) >> 8);
+   }
+}
+
+void blend_columns(uint32_t *out, const uint32_t *row, const uint32_t *index, const uint16_t *weight, uint32_t width)
+{
+   for (uint32_t x = 0; x < width; x++)
+   {
+      u8x4 left, right;
+      std::memcpy(&left, row + index[x], sizeof(left));
+      std::memcpy(&right, row + index[x] + 1, sizeof(right));
+
+      const uint16_t right_weight = weight[x];
+      const uint16_t left_weight = static_cast<uint16_t>(256 - right_weight);
+      const u16x4 sum =
+         __builtin_convertvector(left, u16x4) * left_weight + __builtin_convertvector(right, u16x4) * right_weight;
+      const u8x4 result = __builtin_convertvector(sum >> 8, u8x4);
+      std::memcpy(out + x, &result, sizeof(result));
+   }
+}
+
+void gather(uint32_t *out, const uint32_t *row, const uint32_t *index, uint32_t width)
+{
+   uint32_t x = 0;
+   for (; x + 4 <= width; x += 4)
+   {
+      out[x] = row[index[x]];
+      out[x + 1] = row[index[x + 1]];
+      out[x + 2] = row[index[x + 2]];
+      out[x + 3] = row[index[x + 3]];
+   }
+
+   for (; x < width; x++)
+   {
+      out[x] = row[index[x]];
+   }
+}
+
+void double_columns(uint32_t *out, const uint32_t *row, uint32_t width)
+{
+   uint32_t x = 0;
+   for (; x + 8 <= width; x += 8)
+   {
+      u32x4 pixels;
+      std::memcpy(&pixels, row + x / 2, sizeof(pixels));
+      const u32x4 low = __builtin_shuffle(pixels, u32x4{ 0, 0, 1, 1 });
+      const u32x4 high = __builtin_shuffle(pixels, u32x4{ 2, 2, 3, 3 });
+      std::memcpy(out + x, &low, sizeof(low));
+      std::memcpy(out + x + 4, &high, sizeof(high));
+   }
+
+   for (; x < width; x++)
+   {
+      out[x] = row[x / 2];
+   }
+}
+
+constexpr kernel_table KERNELS = { blend_rows, blend_columns, gather, double_columns };
+
+} /* anonymous namespace */
+
+} /* namespace pixel_scale_kernels */
+} /* namespace util */
@@ -0,0 +1,457 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file present_scheduler.cpp
+ *
+ * @brief Process-wide event loop driving the presentation work of every swapchain.
+ */
+
+#include "present_scheduler.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <system_error>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "utils/logging.hpp"
+
+namespace wsi
+{
+
+/* Sources handled in parallel, handlers do not block so a few threads serve any number of swapchains. */
+static constexpr uint32_t DEFAULT_SCHEDULER_THREADS = 4;
+static constexpr uint32_t MAX_SCHEDULER_THREADS = 16;
+
+/* Identifier of the stop descriptor, sources count from 1. */
+static constexpr uint64_t STOP_SOURCE_ID = 0;
+
+/* Retry interval of a wait for more descriptors than present_wait holds. */
+static constexpr std::chrono::milliseconds WAIT_OVERFLOW_POLL_INTERVAL(1);
+
+void present_wait::add_fd(int fd)
+{
+   for (uint32_t i = 0; i < fd_count; i++)
+   {
+      if (fds[i] == fd)
+      {
+         return;
+      }
+   }
+
+   if (fd_count == MAX_FDS)
+   {
+      add_deadline(std::chrono::steady_clock::now() + WAIT_OVERFLOW_POLL_INTERVAL);
+      return;
+   }
+   fds[fd_count++] = fd;
+}
+
+static uint32_t get_scheduler_thread_count()
+{
+   const char *env = std::getenv("MALI_WRAPPER_PRESENT_THREADS");
+   if (env != nullptr)
+   {
+      const long count = std::strtol(env, nullptr, 10);
+      return static_cast<uint32_t>(std::clamp<long>(count, 1, static_cast<long>(MAX_SCHEDULER_THREADS)));
+   }
+
+   /* Two at least, so that one swapchain waiting for its vblank does not hold up the others. */
+   return std::clamp(std::thread::hardware_concurrency(), 2u, DEFAULT_SCHEDULER_THREADS);
+}
+
+present_scheduler &present_scheduler::get()
+{
+   static present_scheduler scheduler;
+   return scheduler;
+}
+
+present_scheduler::present_scheduler()
+{
+   m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   m_stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+   if (m_epoll_fd < 0 || m_stop_fd < 0)
+   {
+      WSI_LOG_ERROR("Failed to create the presentation scheduler: %s", strerror(errno));
+      return;
+   }
+
+   epoll_event stop_event = {};
+   stop_event.events = EPOLLIN;
+   stop_event.data.u64 = STOP_SOURCE_ID;
+   if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_stop_fd, &stop_event) != 0)
+   {
+      WSI_LOG_ERROR("Failed to watch the scheduler stop event: %s", strerror(errno));
+      return;
+   }
+
+   const uint32_t thread_count = get_scheduler_thread_count();
+   m_threads.reserve(thread_count);
+   for (uint32_t i = 0; i < thread_count; i++)
+   {
+      try
+      {
+         m_threads.emplace_back(&present_scheduler::thread_main, this);
+      }
+      catch (const std::system_error &e)
+      {
+         WSI_LOG_WARNING("Failed to spawn presentation thread %u: %s", i, e.what());
+         break;
+      }
+   }
+
+   WSI_LOG_DEBUG("Presentation scheduler started with %zu threads", m_threads.size());
+}
+
+present_scheduler::~present_scheduler()
+{
+   if (m_stop_fd >= 0)
+   {
+      const uint64_t value = 1;
+      if (write(m_stop_fd, &value, sizeof(value)) != sizeof(value))
+      {
+         WSI_LOG_ERROR("Failed to stop the presentation scheduler: %s", strerror(errno));
+      }
+   }
+
+   for (auto &thread : m_threads)
+   {
+      thread.join();
+   }
+
+   if (m_stop_fd >= 0)
+   {
+      close(m_stop_fd);
+   }
+   if (m_epoll_fd >= 0)
+   {
+      close(m_epoll_fd);
+   }
+}
+
+uint64_t present_scheduler::add_source(int fd, handler_function handler, void *context)
+{
+   if (m_threads.empty())
+   {
+      return 0;
+   }
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+
+   const uint64_t id = m_next_id++;
+   try
+   {
+      m_sources.emplace(id, source{ fd, handler, context, false, false, false, {} });
+   }
+   catch (const std::bad_alloc &)
+   {
+      return 0;
+   }
+
+   epoll_event event = {};
+   event.events = EPOLLIN | EPOLLONESHOT;
+   event.data.u64 = id;
+   if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+   {
+      WSI_LOG_ERROR("Failed to watch descriptor %d: %s", fd, strerror(errno));
+      m_sources.erase(id);
+      return 0;
+   }
+
+   return id;
+}
+
+bool present_scheduler::wait(uint64_t id, const int *fds, uint32_t fd_count)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+
+   auto it = m_sources.find(id);
+   if (it == m_sources.end() || it->second.removed)
+   {
+      return true;
+   }
+
+   for (uint32_t i = 0; i < fd_count; i++)
+   {
+      /* A duplicate is registered, so the same descriptor can be waited for again before its last wait fired. */
+      const int wait_fd = fcntl(fds[i], F_DUPFD_CLOEXEC, 0);
+      if (wait_fd < 0)
+      {
+         WSI_LOG_ERROR("Failed to duplicate descriptor %d: %s", fds[i], strerror(errno));
+         return false;
+      }
+
+      try
+      {
+         it->second.waits.push_back(wait_fd);
+      }
+      catch (const std::bad_alloc &)
+      {
+         close(wait_fd);
+         return false;
+      }
+
+      /* Events of waits carry the source's identifier too, a running handler is simply run once more. */
+      epoll_event event = {};
+      event.events = EPOLLIN | EPOLLONESHOT;
+      event.data.u64 = id;
+      if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, wait_fd, &event) != 0)
+      {
+         WSI_LOG_ERROR("Failed to watch descriptor %d: %s", fds[i], strerror(errno));
+         return false;
+      }
+   }
+
+   return true;
+}
+
+void present_scheduler::drop_waits(source &src)
+{
+   for (int wait_fd : src.waits)
+   {
+      epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, wait_fd, nullptr);
+      close(wait_fd);
+   }
+   src.waits.clear();
+}
+
+void present_scheduler::remove_source(uint64_t id)
+{
+   std::unique_lock<std::mutex> lock(m_mutex);
+
+   auto it = m_sources.find(id);
+   if (it == m_sources.end())
+   {
+      return;
+   }
+
+   /* A thread that already got the event finds the source removed and leaves it alone. */
+   it->second.removed = true;
+   epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+
+   m_idle_cond.wait(lock, [&] { return !it->second.running; });
+   drop_waits(it->second);
+   m_sources.erase(it);
+}
+
+void present_scheduler::thread_main()
+{
+   for (;;)
+   {
+      epoll_event event = {};
+      const int count = epoll_wait(m_epoll_fd, &event, 1, -1);
+      if (count < 0)
+      {
+         if (errno == EINTR)
+         {
+            continue;
+         }
+
+         WSI_LOG_ERROR("Presentation thread failed to wait for events: %s", strerror(errno));
+         return;
+      }
+      if (count == 0)
+      {
+         continue;
+      }
+
+      if (event.data.u64 == STOP_SOURCE_ID)
+      {
+         return;
+      }
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      auto it = m_sources.find(event.data.u64);
+      if (it == m_sources.end() || it->second.removed)
+      {
+         continue;
+      }
+
+      /* Nodes of the map stay put until remove_source() saw the source idle. */
+      source &src = it->second;
+      if (src.running)
+      {
+         src.rerun = true;
+         continue;
+      }
+
+      src.running = true;
+      do
+      {
+         src.rerun = false;
+         drop_waits(src);
+         lock.unlock();
+
+         src.handler(src.context);
+
+         lock.lock();
+      } while (src.rerun && !src.removed);
+
+      src.running = false;
+      if (src.removed)
+      {
+         m_idle_cond.notify_all();
+         continue;
+      }
+
+      epoll_event rearm = {};
+      rearm.events = EPOLLIN | EPOLLONESHOT;
+      rearm.data.u64 = event.data.u64;
+      if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, src.fd, &rearm) != 0)
+      {
+         WSI_LOG_ERROR("Failed to re-arm descriptor %d: %s", src.fd, strerror(errno));
+      }
+   }
+}
+
+present_source::~present_source()
+{
+   stop();
+
+   if (m_event_fd >= 0)
+   {
+      close(m_event_fd);
+   }
+   if (m_timer_fd >= 0)
+   {
+      close(m_timer_fd);
+   }
+}
+
+VkResult present_source::init(present_scheduler::handler_function handler, void *context)
+{
+   m_handler = handler;
+   m_context = context;
+
+   m_event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+   if (m_event_fd < 0)
+   {
+      WSI_LOG_ERROR("Failed to create a presentation event: %s", strerror(errno));
+      return VK_ERROR_INITIALIZATION_FAILED;
+   }
+
+   m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+   if (m_timer_fd < 0)
+   {
+      WSI_LOG_ERROR("Failed to create a presentation timer: %s", strerror(errno));
+      return VK_ERROR_INITIALIZATION_FAILED;
+   }
+
+   m_id = present_scheduler::get().add_source(m_event_fd, &present_source::dispatch, this);
+   if (m_id == 0)
+   {
+      close(m_event_fd);
+      m_event_fd = -1;
+      return VK_ERROR_INITIALIZATION_FAILED;
+   }
+
+   return VK_SUCCESS;
+}
+
+void present_source::notify()
+{
+   /* The descriptor outlives stop(), a late wake-up only bumps a counter nobody watches any more. */
+   if (m_event_fd < 0)
+   {
+      return;
+   }
+
+   const uint64_t value = 1;
+   if (write(m_event_fd, &value, sizeof(value)) != sizeof(value))
+   {
+      WSI_LOG_ERROR("Failed to signal a presentation event: %s", strerror(errno));
+   }
+}
+
+void present_source::wait(const present_wait &wait)
+{
+   if (m_id == 0 || wait.empty())
+   {
+      return;
+   }
+
+   int fds[present_wait::MAX_FDS + 1];
+   uint32_t fd_count = 0;
+   bool armed = true;
+   for (uint32_t i = 0; i < wait.fd_count; i++)
+   {
+      fds[fd_count++] = wait.fds[i];
+   }
+
+   if (wait.deadline != std::chrono::steady_clock::time_point::max())
+   {
+      /* steady_clock is CLOCK_MONOTONIC. A deadline already passed fires right away, but a zero one would disarm. */
+      const int64_t deadline_ns = std::max<int64_t>(
+         std::chrono::duration_cast<std::chrono::nanoseconds>(wait.deadline.time_since_epoch()).count(), 1);
+      itimerspec expiry = {};
+      expiry.it_value.tv_sec = static_cast<time_t>(deadline_ns / 1000000000);
+      expiry.it_value.tv_nsec = static_cast<long>(deadline_ns % 1000000000);
+      if (timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &expiry, nullptr) != 0)
+      {
+         WSI_LOG_ERROR("Failed to arm a presentation timer: %s", strerror(errno));
+         armed = false;
+      }
+      else
+      {
+         fds[fd_count++] = m_timer_fd;
+      }
+   }
+
+   if (!present_scheduler::get().wait(m_id, fds, fd_count) || !armed)
+   {
+      /* Nothing would wake the handler, so poll instead of stalling. */
+      notify();
+   }
+}
+
+void present_source::stop()
+{
+   if (m_id != 0)
+   {
+      present_scheduler::get().remove_source(m_id);
+      m_id = 0;
+   }
+}
+
+void present_source::dispatch(void *context)
+{
+   auto *self = static_cast<present_source *>(context);
+
+   /* Consume the wake-ups first, so that a notify() racing with the handler runs it once more. */
+   uint64_t value = 0;
+   if (read(self->m_event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+   {
+      WSI_LOG_ERROR("Failed to read a presentation event: %s", strerror(errno));
+   }
+
+   self->m_handler(self->m_context);
+}
+
+} /* namespace wsi */
@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file present_scheduler.hpp
+ *
+ * @brief Process-wide event loop driving the presentation work of every swapchain.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+namespace wsi
+{
+
+/**
+ * @brief What a handler waits for before it can make progress again, see present_source::wait().
+ */
+struct present_wait
+{
+   static constexpr uint32_t MAX_FDS = 2;
+
+   int fds[MAX_FDS] = { -1, -1 };
+   uint32_t fd_count = 0;
+
+   /* Latest time to run again, time_point::max() for none. */
+   std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+
+   /**
+    * @brief Wait for @p fd to turn readable, or for a short while once MAX_FDS descriptors are waited for.
+    */
+   void add_fd(int fd);
+
+   void add_deadline(std::chrono::steady_clock::time_point time)
+   {
+      deadline = std::min(deadline, time);
+   }
+
+   bool empty() const
+   {
+      return fd_count == 0 && deadline == std::chrono::steady_clock::time_point::max();
+   }
+};
+
+/**
+ * @brief A small fixed set of threads sleeping in epoll on the file descriptors of all swapchains.
+ *
+ * Every watched descriptor is armed one-shot, so when it becomes readable exactly one thread runs its handler and
+ * the descriptor is only re-armed once the handler returned. The work of a source is therefore never run on two
+ * threads at once, while different sources are handled in parallel up to the size of the thread set. Nothing wakes
+ * up unless a descriptor does.
+ *
+ * Handlers must not block: instead of waiting on a fence, a vblank or frame pacing they hand what they wait for to
+ * wait() and return, which keeps a handful of threads enough for any number of swapchains.
+ */
+class present_scheduler
+{
+public:
+   /**
+    * @brief Function invoked on a scheduler thread when a source's descriptor is readable.
+    */
+   using handler_function = void (*)(void *context);
+
+   /**
+    * @brief Get the process-wide scheduler, spawning its threads on first use.
+    */
+   static present_scheduler &get();
+
+   ~present_scheduler();
+
+   present_scheduler(const present_scheduler &) = delete;
+   present_scheduler &operator=(const present_scheduler &) = delete;
+
+   /**
+    * @brief Start watching a descriptor.
+    *
+    * The handler has to consume whatever made @p fd readable, it is called again as long as the descriptor stays so.
+    *
+    * @param fd      Descriptor to wait on, owned by the caller and kept open until remove_source() returned.
+    * @param handler Function run when @p fd is readable.
+    * @param context Opaque pointer passed to @p handler.
+    *
+    * @return Identifier of the source, 0 if it could not be watched.
+    */
+   uint64_t add_source(int fd, handler_function handler, void *context);
+
+   /**
+    * @brief Run a source's handler once more when any of @p fds turns readable.
+    *
+    * Meant for the handler itself, for whatever it could not do without blocking. The descriptors are duplicated, so
+    * the caller may close them right away. Waits are dropped whenever the handler runs, it asks again for whatever it
+    * still waits for.
+    *
+    * @return false if a descriptor could not be watched.
+    */
+   bool wait(uint64_t id, const int *fds, uint32_t fd_count);
+
+   /**
+    * @brief Stop watching a source, waiting for its handler if it is running.
+    *
+    * Must not be called from the source's own handler.
+    */
+   void remove_source(uint64_t id);
+
+private:
+   present_scheduler();
+
+   struct source
+   {
+      int fd;
+      handler_function handler;
+      void *context;
+      bool running;
+      bool removed;
+
+      /* Run the handler again as soon as it returns, something it waits for turned readable while it ran. */
+      bool rerun;
+
+      /* Duplicates of the descriptors passed to wait(). */
+      std::vector<int> waits;
+   };
+
+   void thread_main();
+
+   /* Stop watching and close the waits of @p src, with m_mutex held. */
+   void drop_waits(source &src);
+
+   int m_epoll_fd = -1;
+
+   /* Left readable for good once the scheduler is destroyed so that every thread sees it. */
+   int m_stop_fd = -1;
+
+   std::vector<std::thread> m_threads;
+
+   std::mutex m_mutex;
+   std::condition_variable m_idle_cond;
+   std::unordered_map<uint64_t, source> m_sources;
+   uint64_t m_next_id = 1;
+};
+
+/**
+ * @brief Work queue on the scheduler woken through an eventfd, e.g. the pending presents of a swapchain.
+ */
+class present_source
+{
+public:
+   present_source() = default;
+   ~present_source();
+
+   present_source(const present_source &) = delete;
+   present_source &operator=(const present_source &) = delete;
+
+   /**
+    * @brief Register with the scheduler, @p handler runs after any number of notify() calls.
+    */
+   VkResult init(present_scheduler::handler_function handler, void *context);
+
+   /**
+    * @brief Wake the handler, a no-op before init() and once stopped.
+    *
+    * Safe from any thread, including the handler itself which then runs again once it returned.
+    */
+   void notify();
+
+   /**
+    * @brief Run the handler again once @p wait is met, or earlier when notified.
+    *
+    * Only from the handler, whatever it waited for before is forgotten once it runs.
+    */
+   void wait(const present_wait &wait);
+
+   /**
+    * @brief Unregister, waiting for a running handler to return.
+    */
+   void stop();
+
+private:
+   static void dispatch(void *context);
+
+   int m_event_fd = -1;
+
+   /* CLOCK_MONOTONIC timer for the deadlines passed to wait(). */
+   int m_timer_fd = -1;
+   uint64_t m_id = 0;
+   present_scheduler::handler_function m_handler = nullptr;
+   void *m_context = nullptr;
+};
+
+} /* namespace wsi */
@@ -28,7 +28,9 @@
  * @brief Contains the Vulkan entrypoints for the swapchain.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <cstdlib>
 #include <new>
 
@@ -199,6 +201,43 @@ static VkResult submit_wait_request(VkQueue queue, const VkPresentInfoKHR &prese
    return VK_SUCCESS;
 }
 
+/**
+ * @brief Copy a VK_KHR_incremental_present region into a present request.
+ *
+ * Regions with more rectangles than a request can hold are reduced to their bounding box.
+ */
+static void fill_present_damage(const VkPresentRegionKHR &region, wsi::pending_present_request &pending_present)
+{
+   pending_present.damage_rect_count = 0;
+   if (region.rectangleCount == 0 || region.pRectangles == nullptr)
+   {
+      return;
+   }
+
+   if (region.rectangleCount <= wsi::MAX_PRESENT_DAMAGE_RECTS)
+   {
+      for (uint32_t i = 0; i < region.rectangleCount; ++i)
+      {
+         pending_present.damage_rects[i] = { region.pRectangles[i].offset, region.pRectangles[i].extent };
+      }
+      pending_present.damage_rect_count = region.rectangleCount;
+      return;
+   }
+
+   int64_t min_x = INT64_MAX, min_y = INT64_MAX, max_x = INT64_MIN, max_y = INT64_MIN;
+   for (uint32_t i = 0; i < region.rectangleCount; ++i)
+   {
+      const VkRectLayerKHR &rect = region.pRectangles[i];
+      min_x = std::min<int64_t>(min_x, rect.offset.x);
+      min_y = std::min<int64_t>(min_y, rect.offset.y);
+      max_x = std::max<int64_t>(max_x, static_cast<int64_t>(rect.offset.x) + rect.extent.width);
+      max_y = std::max<int64_t>(max_y, static_cast<int64_t>(rect.offset.y) + rect.extent.height);
+   }
+   pending_present.damage_rects[0] = { { static_cast<int32_t>(min_x), static_cast<int32_t>(min_y) },
+                                       { static_cast<uint32_t>(max_x - min_x), static_cast<uint32_t>(max_y - min_y) } };
+   pending_present.damage_rect_count = 1;
+}
+
 VWL_VKAPI_CALL(VkResult) __attribute__((visibility("default")))
 wsi_layer_vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPresentInfo) VWL_API_POST
 {
@@ -229,6 +268,8 @@ wsi_layer_vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPresentInfo)
       VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_FENCE_INFO_EXT, present_info->pNext);
    const auto swapchain_present_mode_info = util::find_extension<VkSwapchainPresentModeInfoEXT>(
       VK_STRUCTURE_TYPE_SWAPCHAIN_PRESENT_MODE_INFO_EXT, present_info->pNext);
+   const auto present_regions =
+      util::find_extension<VkPresentRegionsKHR>(VK_STRUCTURE_TYPE_PRESENT_REGIONS_KHR, present_info->pNext);
 #if VULKAN_WSI_LAYER_EXPERIMENTAL
    const auto present_timings_info =
       util::find_extension<VkPresentTimingsInfoEXT>(VK_STRUCTURE_TYPE_PRESENT_TIMINGS_INFO_EXT, present_info->pNext);
@@ -259,6 +300,11 @@ wsi_layer_vkQueuePresentKHR(VkQueue queue, const VkPresentInfoKHR *pPresentInfo)
 
       present_params.pending_present.image_index = pPresentInfo->pImageIndices[i];
       present_params.pending_present.present_id = present_id;
+      if (present_regions != nullptr && present_regions->pRegions != nullptr &&
+          present_regions->swapchainCount == pPresentInfo->swapchainCount)
+      {
+         fill_present_damage(present_regions->pRegions[i], present_params.pending_present);
+      }
 
       present_params.use_image_present_semaphore = use_image_present_semaphore;
       present_params.handle_present_frame_boundary_event = frame_boundary_event_handled;
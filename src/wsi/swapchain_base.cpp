@@ -31,9 +31,11 @@
  * that is not specific to how images are created or presented.
  */
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cerrno>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <system_error>
@@ -53,72 +55,187 @@
 namespace wsi
 {
 
-void swapchain_base::page_flip_thread()
+/**
+ * @brief Add the damage of frames replaced in mailbox mode to the frame presented in their place.
+ *
+ * The damage of a request is relative to the request queued before it, so the presented frame must also cover what
+ * changed in the frames it replaces. Lists that outgrow a request are reduced to their bounding box.
+ */
+static void merge_replaced_damage(pending_present_request &presented, const pending_present_request &replaced)
+{
+   if (presented.damage_rect_count == 0 || replaced.damage_rect_count == 0)
+   {
+      presented.damage_rect_count = 0;
+      return;
+   }
+
+   if (presented.damage_rect_count + replaced.damage_rect_count <= MAX_PRESENT_DAMAGE_RECTS)
+   {
+      for (uint32_t i = 0; i < replaced.damage_rect_count; ++i)
+      {
+         presented.damage_rects[presented.damage_rect_count++] = replaced.damage_rects[i];
+      }
+      return;
+   }
+
+   int64_t min_x = INT64_MAX, min_y = INT64_MAX, max_x = INT64_MIN, max_y = INT64_MIN;
+   auto extend = [&](const VkRect2D &rect) {
+      min_x = std::min<int64_t>(min_x, rect.offset.x);
+      min_y = std::min<int64_t>(min_y, rect.offset.y);
+      max_x = std::max<int64_t>(max_x, static_cast<int64_t>(rect.offset.x) + rect.extent.width);
+      max_y = std::max<int64_t>(max_y, static_cast<int64_t>(rect.offset.y) + rect.extent.height);
+   };
+   for (uint32_t i = 0; i < presented.damage_rect_count; ++i)
+   {
+      extend(presented.damage_rects[i]);
+   }
+   for (uint32_t i = 0; i < replaced.damage_rect_count; ++i)
+   {
+      extend(replaced.damage_rects[i]);
+   }
+   presented.damage_rects[0] = { { static_cast<int32_t>(min_x), static_cast<int32_t>(min_y) },
+                                 { static_cast<uint32_t>(max_x - min_x), static_cast<uint32_t>(max_y - min_y) } };
+   presented.damage_rect_count = 1;
+}
+
+/* How often the payload of a queued image is polled when there is no descriptor to wait on. */
+static constexpr std::chrono::milliseconds PRESENT_PAYLOAD_POLL_INTERVAL(1);
+
+VkResult swapchain_base::image_poll_present(swapchain_image &image, present_wait &wait)
+{
+   const VkResult result = image_wait_present(image, 0);
+   if (result == VK_TIMEOUT)
+   {
+      wait.add_deadline(std::chrono::steady_clock::now() + PRESENT_PAYLOAD_POLL_INTERVAL);
+      return VK_NOT_READY;
+   }
+   return result;
+}
+
+void swapchain_base::page_flip()
 {
    auto &sc_images = m_swapchain_images;
-   VkResult vk_res = VK_SUCCESS;
-   uint64_t timeout = UINT64_MAX;
-   constexpr uint64_t SEMAPHORE_TIMEOUT = 250000000; /* 250 ms. */
-
-   /* No mutex is needed for the accesses to m_page_flip_thread_run variable as after the variable is
-    * initialized it is only ever changed to false. The while loop will make the thread read the
-    * value repeatedly, and the combination of semaphores and thread joins will force any changes to
-    * the variable to be visible to this thread.
-    */
-   while (m_page_flip_thread_run)
+   present_wait wait;
+
+   while (m_page_flip_run)
    {
-      pending_present_request submit_info{};
-      if (m_present_mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR)
+      wait = present_wait{};
+      const bool engine_ready = poll_presentation_engine(wait);
+
+      /* In continuous mode the application only has to make one presentation request to start the refresh. */
+      const bool continuous = m_present_mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR;
+      std::unique_lock<std::recursive_mutex> image_status_lock(m_image_status_mutex);
+      if (continuous ? !m_started_presenting : m_pending_buffer_pool.size() == 0)
       {
-         /* In continuous mode the application will only make one presentation request,
-          * therefore the page flip semaphore will only be signalled once. */
-         if (!m_first_present)
+         break;
+      }
+      image_status_lock.unlock();
+
+      /* The ancestor notifies us again whenever it frees one of its images. */
+      if (m_first_present && !wait_for_ancestor(0))
+      {
+         break;
+      }
+
+      image_status_lock.lock();
+
+      /* In mailbox mode only the newest frame is shown. The frames it replaces go straight back to the
+       * application once the GPU is done with them, which is no later than with the newest one. */
+      VkResult vk_res = VK_SUCCESS;
+      while (!continuous && m_present_mode == VK_PRESENT_MODE_MAILBOX_KHR && m_pending_buffer_pool.size() > 1)
+      {
+         const pending_present_request replaced = *m_pending_buffer_pool.front();
+         vk_res = image_poll_present(sc_images[replaced.image_index], wait);
+         if (vk_res == VK_NOT_READY)
+         {
+            break;
+         }
+
+         m_pending_buffer_pool.pop_front();
+         if (m_frames_replaced)
          {
-            vk_res = VK_SUCCESS;
+            merge_replaced_damage(m_replaced_damage, replaced);
          }
-         else if ((vk_res = m_page_flip_semaphore.wait(SEMAPHORE_TIMEOUT)) == VK_TIMEOUT)
+         else
          {
-            /* Image is not ready yet. */
-            continue;
+            m_replaced_damage = replaced;
+            m_frames_replaced = true;
          }
-         assert(vk_res == VK_SUCCESS);
 
-         /* For continuous mode there will be only one image in the swapchain.
-          * This image will always be used, and there is no pending state in this case. */
+         if (vk_res == VK_SUCCESS)
+         {
+            unpresent_image(replaced.image_index);
+         }
+         else
+         {
+            set_error_state(vk_res);
+            post_free_image();
+         }
+      }
+      if (vk_res == VK_NOT_READY)
+      {
+         break;
+      }
+
+      /* We want to present the oldest queued for present image from our present queue, which we can find at the
+       * head of m_pending_buffer_pool. For continuous mode there will be only one image in the swapchain. */
+      const uint32_t image_index = continuous ? 0 : m_pending_buffer_pool.front()->image_index;
+      vk_res = image_poll_present(sc_images[image_index], wait);
+      if (vk_res == VK_NOT_READY || (vk_res == VK_SUCCESS && !engine_ready))
+      {
+         break;
+      }
+
+      pending_present_request submit_info{};
+      if (continuous)
+      {
+         /* This image will always be used, and there is no pending state in this case. */
+         while (m_pending_buffer_pool.pop_front().has_value())
+         {
+         }
          submit_info.image_index = 0;
       }
       else
       {
-         /* Waiting for the page_flip_semaphore which will be signalled once there is an
-          * image to display.*/
-         if ((vk_res = m_page_flip_semaphore.wait(SEMAPHORE_TIMEOUT)) == VK_TIMEOUT)
+         submit_info = *m_pending_buffer_pool.pop_front();
+         if (m_frames_replaced)
          {
-            /* Image is not ready yet. */
-            continue;
+            merge_replaced_damage(submit_info, m_replaced_damage);
+            m_frames_replaced = false;
          }
-
-         /* We want to present the oldest queued for present image from our present queue,
-          * which we can find at the sc->pending_buffer_pool.head index. */
-         std::unique_lock<std::recursive_mutex> image_status_lock(m_image_status_mutex);
-
-         auto pending_submission = m_pending_buffer_pool.pop_front();
-         assert(pending_submission.has_value());
-         submit_info = *pending_submission;
       }
 
-      /* We may need to wait for the payload of the present sync of the oldest pending image to be finished. */
-      while ((vk_res = image_wait_present(sc_images[submit_info.image_index], timeout)) == VK_TIMEOUT)
-      {
-         WSI_LOG_WARNING("Timeout waiting for image's present fences, retrying..");
-      }
+      image_status_lock.unlock();
+
       if (vk_res != VK_SUCCESS)
       {
          set_error_state(vk_res);
-         m_free_image_semaphore.post();
+         post_free_image();
+         if (continuous)
+         {
+            /* The same image would fail again, the error state stops the refresh. */
+            return;
+         }
          continue;
       }
 
       call_present(submit_info);
+
+      if (continuous)
+      {
+         /* Refresh again on the next run, which lets other swapchains have the thread in between. A failed
+          * present leaves the swapchain in an error state, retrying it would only spin. */
+         if (!error_has_occured())
+         {
+            m_page_flip_source.notify();
+         }
+         return;
+      }
+   }
+
+   if (m_page_flip_run)
+   {
+      m_page_flip_source.wait(wait);
    }
 }
 
@@ -128,11 +245,7 @@ void swapchain_base::call_present(const pending_present_request &pending_present
     * pending buffers from the ancestor have been presented. */
    if (m_first_present)
    {
-      if (m_ancestor != VK_NULL_HANDLE)
-      {
-         auto *ancestor = reinterpret_cast<swapchain_base *>(m_ancestor);
-         ancestor->wait_for_pending_buffers();
-      }
+      wait_for_ancestor(UINT64_MAX);
 
       sem_post(&m_start_present_semaphore);
 
@@ -158,26 +271,10 @@ bool swapchain_base::has_descendant_started_presenting()
    return desc->m_started_presenting;
 }
 
-VkResult swapchain_base::init_page_flip_thread()
+VkResult swapchain_base::init_page_flip()
 {
-   /* Setup semaphore for signaling pageflip thread */
-   TRY_LOG_CALL(m_page_flip_semaphore.init(0));
-   m_thread_sem_defined = true;
-
-   /* Launch page flipping thread */
-   m_page_flip_thread_run = true;
-   try
-   {
-      m_page_flip_thread = std::thread(&swapchain_base::page_flip_thread, this);
-   }
-   catch (const std::system_error &)
-   {
-      return VK_ERROR_INITIALIZATION_FAILED;
-   }
-   catch (const std::bad_alloc &)
-   {
-      return VK_ERROR_INITIALIZATION_FAILED;
-   }
+   TRY_LOG_CALL(m_page_flip_source.init(&swapchain_base::page_flip_handler, this));
+   m_page_flip_run = true;
    return VK_SUCCESS;
 }
 
@@ -200,15 +297,25 @@ void swapchain_base::unpresent_image(uint32_t presented_index)
    if (m_present_mode != VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR &&
        m_present_mode != VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR)
    {
-      m_free_image_semaphore.post();
+      post_free_image();
+   }
+}
+
+void swapchain_base::post_free_image()
+{
+   m_free_image_semaphore.post();
+
+   if (m_descendant != VK_NULL_HANDLE)
+   {
+      auto *desc = reinterpret_cast<swapchain_base *>(m_descendant);
+      desc->m_page_flip_source.notify();
    }
 }
 
 swapchain_base::swapchain_base(wsi::device_private_data &dev_data, const VkAllocationCallbacks *callbacks)
    : m_device_data(dev_data)
-   , m_page_flip_thread_run(false)
+   , m_page_flip_run(false)
    , m_start_present_semaphore()
-   , m_thread_sem_defined(false)
    , m_first_present(true)
    , m_pending_buffer_pool()
    , m_allocator(dev_data.get_allocator(), VK_SYSTEM_ALLOCATION_SCOPE_OBJECT, callbacks)
@@ -223,6 +330,7 @@ swapchain_base::swapchain_base(wsi::device_private_data &dev_data, const VkAlloc
    , m_image_create_info()
    , m_image_acquire_lock()
    , m_error_state(VK_NOT_READY)
+   , m_ancestor_pending_buffers(-1)
    , m_started_presenting(false)
    , m_extensions(m_allocator)
 {
@@ -260,7 +368,7 @@ VkResult swapchain_base::init(VkDevice device, const VkSwapchainCreateInfoKHR *s
 
    if (use_presentation_thread)
    {
-      TRY_LOG_CALL(init_page_flip_thread());
+      TRY_LOG_CALL(init_page_flip());
    }
 
    VkImageCreateInfo image_create_info = {};
@@ -374,19 +482,11 @@ void swapchain_base::teardown()
    }
 
    /* We are safe to destroy everything. */
-   if (m_thread_sem_defined)
+   if (m_page_flip_run)
    {
-      /* Tell flip thread to end. */
-      m_page_flip_thread_run = false;
-
-      if (m_page_flip_thread.joinable())
-      {
-         m_page_flip_thread.join();
-      }
-      else
-      {
-         WSI_LOG_ERROR("m_page_flip_thread is not joinable");
-      }
+      /* Stop page flipping, waiting for a present in progress on the scheduler. */
+      m_page_flip_run = false;
+      m_page_flip_source.stop();
    }
 
    int res = sem_destroy(&m_start_present_semaphore);
@@ -456,8 +556,8 @@ VkResult swapchain_base::acquire_next_image(uint64_t timeout, VkSemaphore semaph
    image_status_lock.unlock();
 
    /* Try to signal fences/semaphores with a sync FD for optimal performance. */
-   if (m_device_data.disp.get_fn<PFN_vkImportFenceFdKHR>("vkImportFenceFdKHR").has_value() &&
-       m_device_data.disp.get_fn<PFN_vkImportSemaphoreFdKHR>("vkImportSemaphoreFdKHR").has_value())
+   if (m_device_data.disp.get_fn<PFN_vkImportFenceFdKHR>(device_entrypoint::ImportFenceFdKHR).has_value() &&
+       m_device_data.disp.get_fn<PFN_vkImportSemaphoreFdKHR>(device_entrypoint::ImportSemaphoreFdKHR).has_value())
    {
       if (fence != VK_NULL_HANDLE)
       {
@@ -580,24 +680,24 @@ VkResult swapchain_base::notify_presentation_engine(const pending_present_reques
 
    /* If the descendant has started presenting, we should release the image
     * however we do not want to block inside the main thread so we mark it
-    * as free and let the page flip thread take care of it. */
+    * as free and let page flipping take care of it. */
    const bool descendant_started_presenting = has_descendant_started_presenting();
    if (descendant_started_presenting)
    {
       m_swapchain_images[pending_present.image_index].status = swapchain_image::FREE;
-      m_free_image_semaphore.post();
+      post_free_image();
       return VK_ERROR_OUT_OF_DATE_KHR;
    }
 
    m_swapchain_images[pending_present.image_index].status = swapchain_image::PENDING;
    m_started_presenting = true;
 
-   if (m_page_flip_thread_run)
+   if (m_page_flip_run)
    {
       bool buffer_pool_res = m_pending_buffer_pool.push_back(pending_present);
       (void)buffer_pool_res;
       assert(buffer_pool_res);
-      m_page_flip_semaphore.post();
+      m_page_flip_source.notify();
    }
    else
    {
@@ -638,9 +738,9 @@ VkResult swapchain_base::queue_present(VkQueue queue, const VkPresentInfoKHR *pr
       sem_count = present_info->waitSemaphoreCount;
    }
 
-   if (!m_page_flip_thread_run)
+   if (!m_page_flip_run)
    {
-      /* If the page flip thread is not running, we need to wait for any present payload here, before setting a new present payload. */
+      /* If page flipping is not scheduled, we need to wait for any present payload here, before setting a new present payload. */
       constexpr uint64_t WAIT_PRESENT_TIMEOUT = 1000000000; /* 1 second */
       TRY_LOG_CALL(
          image_wait_present(m_swapchain_images[submit_info.pending_present.image_index], WAIT_PRESENT_TIMEOUT));
@@ -702,10 +802,8 @@ void swapchain_base::deprecate(VkSwapchainKHR descendant)
    m_descendant = descendant;
 }
 
-void swapchain_base::wait_for_pending_buffers()
+int swapchain_base::get_pending_buffer_count()
 {
-   std::unique_lock<std::mutex> acquire_lock(m_image_acquire_lock);
-   int wait;
    int acquired_images = 0;
    std::unique_lock<std::recursive_mutex> image_status_lock(m_image_status_mutex);
 
@@ -720,8 +818,13 @@ void swapchain_base::wait_for_pending_buffers()
    /* Waiting for free images waits for both free and pending. One pending image may be presented and acquired by a
     * compositor. The WSI backend may not necessarily know which pending image is presented to change its state. It may
     * be impossible to wait for that one presented image. */
-   wait = static_cast<int>(m_swapchain_images.size()) - acquired_images - 1;
-   image_status_lock.unlock();
+   return static_cast<int>(m_swapchain_images.size()) - acquired_images - 1;
+}
+
+void swapchain_base::wait_for_pending_buffers()
+{
+   std::unique_lock<std::mutex> acquire_lock(m_image_acquire_lock);
+   int wait = get_pending_buffer_count();
 
    while (wait > 0)
    {
@@ -731,6 +834,45 @@ void swapchain_base::wait_for_pending_buffers()
    }
 }
 
+bool swapchain_base::wait_for_ancestor(uint64_t timeout)
+{
+   if (m_ancestor == VK_NULL_HANDLE)
+   {
+      return true;
+   }
+
+   auto *ancestor = reinterpret_cast<swapchain_base *>(m_ancestor);
+   std::unique_lock<std::mutex> acquire_lock(ancestor->m_image_acquire_lock, std::defer_lock);
+   if (timeout != 0)
+   {
+      acquire_lock.lock();
+   }
+   else if (!acquire_lock.try_lock())
+   {
+      /* An acquire is waiting for the same images, they notify us again once freed. */
+      return false;
+   }
+
+   /* Count once, the images taken so far are ours and no longer show up as pending. */
+   if (m_ancestor_pending_buffers < 0)
+   {
+      m_ancestor_pending_buffers = ancestor->get_pending_buffer_count();
+   }
+
+   while (m_ancestor_pending_buffers > 0)
+   {
+      /* Take down one free image semaphore. */
+      const VkResult res = ancestor->wait_for_free_buffer(timeout);
+      if (res == VK_NOT_READY || res == VK_TIMEOUT)
+      {
+         return false;
+      }
+      --m_ancestor_pending_buffers;
+   }
+
+   return true;
+}
+
 void swapchain_base::clear_ancestor()
 {
    m_ancestor = VK_NULL_HANDLE;
@@ -35,6 +35,7 @@
 #include <vulkan/vulkan.h>
 #include <thread>
 #include <array>
+#include <atomic>
 
 #include "layer_utils/custom_allocator.hpp"
 #include "layer_utils/helpers.hpp"
@@ -49,6 +50,7 @@
 #include "extensions/frame_boundary.hpp"
 #include "extensions/wsi_extension.hpp"
 #include "layer_utils/macros.hpp"
+#include "present_scheduler.hpp"
 
 namespace wsi
 {
@@ -75,6 +77,9 @@ struct swapchain_image
    VkSemaphore present_fence_wait{ VK_NULL_HANDLE };
 };
 
+/* Damage rectangles carried per present request. Larger VkPresentRegionKHR lists collapse to their bounding box. */
+static constexpr uint32_t MAX_PRESENT_DAMAGE_RECTS = 16;
+
 struct pending_present_request
 {
    /* The index of the pending image to use for present. */
@@ -85,6 +90,13 @@ struct pending_present_request
     * If 0, no present ID has been assigned to this request.
     */
    uint64_t present_id;
+
+   /**
+    * Regions of the image that changed since the previous present, from VkPresentRegionsKHR.
+    * If 0, the whole image is assumed to have changed.
+    */
+   uint32_t damage_rect_count;
+   std::array<VkRect2D, MAX_PRESENT_DAMAGE_RECTS> damage_rects;
 };
 
 struct swapchain_presentation_parameters
@@ -308,19 +320,16 @@ protected:
    wsi::device_private_data &m_device_data;
 
    /**
-    * @brief Handle to the page flip thread.
-    */
-   std::thread m_page_flip_thread;
-
-   /**
-    * @brief Whether the page flip thread has to continue running or terminate.
+    * @brief Pending presents of the swapchain on the process-wide presentation scheduler.
     */
-   bool m_page_flip_thread_run;
+   present_source m_page_flip_source;
 
    /**
-    * @brief A semaphore to be signalled once a page flip event occurs.
+    * @brief Whether presents are handed to the scheduler rather than made in vkQueuePresentKHR.
+    *
+    * Only ever changes from true to false, once the swapchain is torn down.
     */
-   util::timed_semaphore m_page_flip_semaphore;
+   std::atomic<bool> m_page_flip_run;
 
    /**
     * @brief A semaphore to be signalled once the swapchain has one frame on screen.
@@ -337,14 +346,6 @@ protected:
     */
    std::recursive_mutex m_image_status_mutex;
 
-   /**
-    * @brief Defines if the pthread_t and sem_t members of the class are defined.
-    *
-    * As they are opaque types theer's no known invalid value that we ca initialize to,
-    * and therefore determine if we need to cleanup.
-    */
-   bool m_thread_sem_defined;
-
    /**
     * @brief A flag to track if it is the first present for the chain.
     */
@@ -444,7 +445,7 @@ protected:
     * If an application replaces an old swapchain with a new one, the older swapchain
     * needs to be deprecated. This method releases all the FREE images and sets the
     * descendant of the swapchain. We do not need to care about images in other states
-    * at this point since they will be released by the page flip thread.
+    * at this point since they will be released by page flipping.
     *
     * @param descendant Handle to the descendant swapchain.
     */
@@ -576,7 +577,7 @@ protected:
    /**
     * @brief Waits for the present payload of an image if necessary.
     *
-    * If the page flip thread needs to wait for the image present synchronization payload the WSI implemention can block
+    * If page flipping needs to wait for the image present synchronization payload the WSI implemention can block
     * and wait in this call. Otherwise the function should return successfully without blocking.
     *
     * @param[in] image   The swapchain image for which the function may need to wait until the presentat payload has
@@ -587,6 +588,34 @@ protected:
     */
    virtual VkResult image_wait_present(swapchain_image &image, uint64_t timeout) = 0;
 
+   /**
+    * @brief Checks without blocking whether the present payload of an image has finished.
+    *
+    * The default polls image_wait_present() and asks to be checked again shortly. Implementations that can export
+    * the payload as a file descriptor should wait on that instead.
+    *
+    * @param[in]  image The swapchain image queued for present.
+    * @param[out] wait  Gets what to wait for when the payload has not finished.
+    *
+    * @return VK_SUCCESS if the payload has finished, VK_NOT_READY if not, an error code otherwise.
+    */
+   virtual VkResult image_poll_present(swapchain_image &image, present_wait &wait);
+
+   /**
+    * @brief Lets the presentation engine make progress without blocking, before page_flip() presents an image.
+    *
+    * Backends that hold on to presented images until the engine is done with them give them back here.
+    *
+    * @param[out] wait Gets what to wait for while the engine holds images or is not ready for another frame.
+    *
+    * @return true if present_image() can run now without waiting for the engine.
+    */
+   virtual bool poll_presentation_engine(present_wait &wait)
+   {
+      UNUSED(wait);
+      return true;
+   }
+
    /**
     * @brief Returns true if an error has occurred.
     */
@@ -640,14 +669,15 @@ private:
    util::timed_semaphore m_free_image_semaphore;
 
    /**
-    * @brief Per swapchain thread function that handles page flipping.
+    * @brief Handles page flipping, run by the presentation scheduler whenever m_page_flip_source is notified.
     *
-    * This thread should be running for the lifetime of the swapchain.
-    * The thread simply calls the implementation's present_image() method.
+    * Presents every queued image in order, calling the implementation's present_image() method.
     * There are 3 main cases we cover here:
     *
     * 1. On the first present of the swapchain if the swapchain has
-    *    an ancestor we must wait for it to finish presenting.
+    *    an ancestor we must wait for it to finish presenting. This wait does not
+    *    block: the queue is left alone until the ancestor frees its images, which
+    *    notifies this swapchain again.
     * 2. The normal use case where we do page flipping, in this
     *    case change the currently PRESENTED image with the oldest
     *    PENDING image.
@@ -655,15 +685,32 @@ private:
     *    descendant of the swapchain has started presenting so we
     *    should release the image and continue.
     *
-    * The function always waits on the page_flip_semaphore of the
-    * swapchain. Once it passes that we must wait for the fence of the
-    * oldest pending image to be signalled, this means that the gpu has
-    * finished rendering to it and we can present it. From there on the
-    * logic splits into the above 3 cases and if an image has been
-    * presented then the old one is marked as FREE and the free_image
+    * Before presenting an image its fence must be signalled,
+    * this means that the gpu has finished rendering to it and we can present it.
+    * From there on the logic splits into the above 3 cases and if an image has
+    * been presented then the old one is marked as FREE and the free_image
     * semaphore of the swapchain will be posted.
+    *
+    * Nothing here blocks: while the fence of the next image is pending or the
+    * presentation engine is not ready for it, the function returns and asks the
+    * scheduler to run it again once that changes, see image_poll_present() and
+    * poll_presentation_engine().
+    *
+    * In continuous refresh mode the single image is presented again and again,
+    * the function notifies itself after each present for as long as the swapchain lives.
     **/
-   void page_flip_thread();
+   void page_flip();
+
+   /**
+    * @brief Damage of the mailbox frames replaced since the last present, merged into the next frame shown.
+    */
+   pending_present_request m_replaced_damage{};
+   bool m_frames_replaced = false;
+
+   static void page_flip_handler(void *context)
+   {
+      static_cast<swapchain_base *>(context)->page_flip();
+   }
 
    /**
     * @brief Call the swapchain implementation specific present_image function.
@@ -681,17 +728,41 @@ private:
    bool has_descendant_started_presenting();
 
    /**
-    * @brief Initialize the page flipping thread.
+    * @brief Register the swapchain's page flipping with the presentation scheduler.
     *
     * @return VK_SUCCESS if the initialization was successful or an error code otherwise.
     */
-   VkResult init_page_flip_thread();
+   VkResult init_page_flip();
+
+   /**
+    * @brief Wait for the images the ancestor had pending when this swapchain started presenting.
+    *
+    * @param timeout 0 to only take the images that are already free, UINT64_MAX to block until all of them are.
+    *
+    * @return true once the ancestor has none of those images left, or there is no ancestor.
+    */
+   bool wait_for_ancestor(uint64_t timeout);
+
+   /**
+    * @brief Number of images still to be freed before all the swapchain's presents are done.
+    */
+   int get_pending_buffer_count();
+
+   /**
+    * @brief Post the free image semaphore and wake a descendant waiting for this swapchain's images.
+    */
+   void post_free_image();
+
+   /**
+    * @brief Images of the ancestor wait_for_ancestor() still has to take, -1 until it counted them.
+    */
+   int m_ancestor_pending_buffers;
 
    /**
     * @brief Notify the presentation engine with the next image to be presented.
     *
     * Appends the next image to the ring buffer and notifies the page flipping
-    * thread if it is enabled or directly calls the WSI backend implementation to
+    * source if it is enabled or directly calls the WSI backend implementation to
     * present the image.
     *
     * @param pending_present_request Submission information for the present request.
@@ -94,7 +94,8 @@ VkResult fence_sync::wait_payload(uint64_t timeout)
    return res;
 }
 
-VkResult fence_sync::set_payload(VkQueue queue, const queue_submit_semaphores &semaphores, const void *submission_pnext)
+VkResult fence_sync::set_payload(VkQueue queue, const queue_submit_semaphores &semaphores, const void *submission_pnext,
+                                 VkCommandBuffer command_buffer)
 {
    VkResult result = dev->disp.ResetFences(dev->device, 1, &fence);
    if (result != VK_SUCCESS)
@@ -103,7 +104,7 @@ VkResult fence_sync::set_payload(VkQueue queue, const queue_submit_semaphores &s
    }
    has_payload = false;
 
-   result = sync_queue_submit(*dev, queue, fence, semaphores, submission_pnext);
+   result = sync_queue_submit(*dev, queue, fence, semaphores, submission_pnext, command_buffer);
    if (result == VK_SUCCESS)
    {
       has_payload = true;
@@ -170,13 +171,16 @@ std::optional<util::fd_owner> sync_fd_fence_sync::export_sync_fd()
 }
 
 VkResult sync_queue_submit(const wsi::device_private_data &device, VkQueue queue, VkFence fence,
-                           const queue_submit_semaphores &semaphores, const void *submission_pnext)
+                           const queue_submit_semaphores &semaphores, const void *submission_pnext,
+                           VkCommandBuffer command_buffer)
 {
    /* When the semaphore that comes in is signalled, we know that all work is done. So, we do not
     * want to block any future Vulkan queue work on it. So, we pass in BOTTOM_OF_PIPE bit as the
-    * wait flag.
+    * wait flag. Commands submitted along need the semaphores to block their transfers instead.
     */
-   VkPipelineStageFlags pipeline_stage_flag = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+   const VkPipelineStageFlags wait_stage =
+      command_buffer != VK_NULL_HANDLE ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+   VkPipelineStageFlags pipeline_stage_flag = wait_stage;
    VkPipelineStageFlags *pipeline_stage_flag_data = &pipeline_stage_flag;
 
    util::vector<VkPipelineStageFlags> pipeline_stage_flags_vector{ util::allocator(
@@ -188,8 +192,7 @@ VkResult sync_queue_submit(const wsi::device_private_data &device, VkQueue queue
       {
          return VK_ERROR_OUT_OF_HOST_MEMORY;
       }
-      std::fill(pipeline_stage_flags_vector.begin(), pipeline_stage_flags_vector.end(),
-                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+      std::fill(pipeline_stage_flags_vector.begin(), pipeline_stage_flags_vector.end(), wait_stage);
       pipeline_stage_flag_data = pipeline_stage_flags_vector.data();
    }
 
@@ -198,8 +201,8 @@ VkResult sync_queue_submit(const wsi::device_private_data &device, VkQueue queue
                                 semaphores.wait_semaphores_count,
                                 semaphores.wait_semaphores,
                                 pipeline_stage_flag_data,
-                                0,
-                                nullptr,
+                                command_buffer != VK_NULL_HANDLE ? 1u : 0u,
+                                command_buffer != VK_NULL_HANDLE ? &command_buffer : nullptr,
                                 semaphores.signal_semaphores_count,
                                 semaphores.signal_semaphores };
 
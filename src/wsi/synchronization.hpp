@@ -92,11 +92,12 @@ public:
     * @param     queue  The Vulkan queue that may be used to submit synchronization commands.
     * @param     semaphores The wait and signal semaphores.
     * @param     submission_pnext   Chain of pointers to attach to the payload submission.
+    * @param     command_buffer     Commands to run once the wait semaphores are signalled, or VK_NULL_HANDLE.
     *
     * @return VK_SUCCESS on success or other error code on failing to set the payload.
     */
    VkResult set_payload(VkQueue queue, const queue_submit_semaphores &semaphores,
-                        const void *submission_pnext = nullptr);
+                        const void *submission_pnext = nullptr, VkCommandBuffer command_buffer = VK_NULL_HANDLE);
 
 protected:
    /**
@@ -188,9 +189,12 @@ private:
  *                   of a fence to be signalled.
  * @param semaphores The wait and signal semaphores.
  * @param submission_pnext Chain of pointers to attach to the payload submission.
+ * @param command_buffer   Commands to run once the wait semaphores are signalled, or VK_NULL_HANDLE for an empty
+ *                         submission. The semaphores block its transfer stage.
  *
  * @return VK_SUCCESS on success, an appropiate error code otherwise.
  */
 VkResult sync_queue_submit(const wsi::device_private_data &device, VkQueue queue, VkFence fence,
-                           const queue_submit_semaphores &semaphores, const void *submission_pnext = nullptr);
+                           const queue_submit_semaphores &semaphores, const void *submission_pnext = nullptr,
+                           VkCommandBuffer command_buffer = VK_NULL_HANDLE);
 } /* namespace wsi */
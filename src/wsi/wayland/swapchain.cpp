@@ -159,7 +159,7 @@ VkResult swapchain::init_platform(VkDevice device, const VkSwapchainCreateInfoKH
 
    /*
     * When VK_PRESENT_MODE_MAILBOX_KHR has been chosen by the application we don't
-    * initialize the page flip thread so the present_image function can be called
+    * schedule page flipping so the present_image function can be called
     * during vkQueuePresent.
     */
    use_presentation_thread =
@@ -198,6 +198,17 @@ VkResult add_device_extensions_required_by_layer(VkPhysicalDevice phys_dev,
       }
    }
 
+#if BUILD_WSI_X11
+   /* Lets the X11 SHM presenter import its segments as image memory instead of copying into them. */
+   if (enabled_platforms.contains(VK_ICD_WSI_PLATFORM_XCB) || enabled_platforms.contains(VK_ICD_WSI_PLATFORM_XLIB))
+   {
+      if (available_device_extensions.contains(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME))
+      {
+         TRY_LOG_CALL(extensions_to_enable.add(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME));
+      }
+   }
+#endif
+
    for (const auto &wsi_ext : supported_wsi_extensions)
    {
       /* Skip iterating over platforms not enabled in the instance. */
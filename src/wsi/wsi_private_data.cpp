@@ -31,6 +31,8 @@
 #include "utils/logging.hpp"
 #include "layer_utils/helpers.hpp"
 #include "layer_utils/macros.hpp"
+#include "layer_utils/name_hash.hpp"
+#include "layer_utils/handle_registry.hpp"
 #include <cstdio>
 #include <stdexcept>
 #include <type_traits>
@@ -57,65 +59,88 @@ static util::unordered_map<void *, void *> g_instance_key_mapping{ util::allocat
 static util::unordered_map<void *, void *> g_device_key_mapping{ util::allocator::get_generic() };
 static util::unordered_map<void *, void *> g_queue_key_mapping{ util::allocator::get_generic() };
 
-VkResult instance_dispatch_table::populate(VkInstance instance, PFN_vkGetInstanceProcAddr get_proc)
-{
-   static constexpr entrypoint entrypoints_init[] = {
+/* Lock-free front of the maps above for the lookups made on every call. Handles are added once resolved through
+ * the maps, and removed whenever their mapping changes or the private data is destroyed, all under g_data_lock.
+ */
+static util::handle_registry<mali_wrapper::instance_private_data, 64> g_instance_handles;
+static util::handle_registry<mali_wrapper::device_private_data, 256> g_device_handles;
+
+static constexpr entrypoint instance_entrypoints_init[] = {
 #define DISPATCH_TABLE_ENTRY(name, ext_name, api_version, required) \
    { "vk" #name, ext_name, nullptr, api_version, false, required },
-      INSTANCE_ENTRYPOINTS_LIST(DISPATCH_TABLE_ENTRY)
+   INSTANCE_ENTRYPOINTS_LIST(DISPATCH_TABLE_ENTRY)
 #undef DISPATCH_TABLE_ENTRY
-   };
+};
 
-   static constexpr auto num_entrypoints = std::distance(std::begin(entrypoints_init), std::end(entrypoints_init));
+static constexpr const char *instance_entrypoint_names[] = {
+#define DISPATCH_TABLE_NAME(name, unused1, unused2, unused3) "vk" #name,
+   INSTANCE_ENTRYPOINTS_LIST(DISPATCH_TABLE_NAME)
+#undef DISPATCH_TABLE_NAME
+};
 
-   for (size_t i = 0; i < num_entrypoints; i++)
-   {
-      const entrypoint *entrypoint = &entrypoints_init[i];
-      PFN_vkVoidFunction ret = get_proc(instance, entrypoint->name);
-      if (!ret && entrypoint->required)
-      {
-         return VK_ERROR_INITIALIZATION_FAILED;
-      }
-      struct entrypoint e = *entrypoint;
-      e.fn = ret;
-      e.user_visible = false;
+static constexpr auto instance_entrypoint_hash = util::perfect_name_hash<128>::build(instance_entrypoint_names);
+static_assert(instance_entrypoint_hash.is_valid(), "No collision free hash for the instance entrypoint names");
 
-      if (!m_entrypoints->try_insert(std::make_pair(e.name, e)).has_value())
-      {
-         WSI_LOG_ERROR("Failed to allocate memory for instance dispatch table entry.");
-         return VK_ERROR_OUT_OF_HOST_MEMORY;
-      }
-   }
+static constexpr entrypoint device_entrypoints_init[] = {
+#define DISPATCH_TABLE_ENTRY(name, ext_name, api_version, required) \
+   { "vk" #name, ext_name, nullptr, api_version, false, required },
+   DEVICE_ENTRYPOINTS_LIST(DISPATCH_TABLE_ENTRY)
+#undef DISPATCH_TABLE_ENTRY
+};
 
-   return VK_SUCCESS;
+static constexpr const char *device_entrypoint_names[] = {
+#define DISPATCH_TABLE_NAME(name, unused1, unused2, unused3) "vk" #name,
+   DEVICE_ENTRYPOINTS_LIST(DISPATCH_TABLE_NAME)
+#undef DISPATCH_TABLE_NAME
+};
+
+static constexpr auto device_entrypoint_hash = util::perfect_name_hash<512>::build(device_entrypoint_names);
+static_assert(device_entrypoint_hash.is_valid(), "No collision free hash for the device entrypoint names");
+
+template <>
+size_t dispatch_table<instance_entrypoint>::index_of(const char *fn_name)
+{
+   return instance_entrypoint_hash.find(fn_name);
+}
+
+template <>
+size_t dispatch_table<device_entrypoint>::index_of(const char *fn_name)
+{
+   return device_entrypoint_hash.find(fn_name);
 }
 
-void dispatch_table::set_user_enabled_extensions(const char *const *extension_names, size_t extension_count)
+instance_dispatch_table::instance_dispatch_table()
+   : dispatch_table{ instance_entrypoints_init }
 {
-   for (size_t i = 0; i < extension_count; i++)
+}
+
+VkResult instance_dispatch_table::populate(VkInstance instance, PFN_vkGetInstanceProcAddr get_proc)
+{
+   for (auto &entrypoint : m_entrypoints)
    {
-      for (auto &entrypoint : *m_entrypoints)
+      PFN_vkVoidFunction ret = get_proc(instance, entrypoint.name);
+      if (!ret && entrypoint.required)
       {
-         if (!strcmp(entrypoint.second.ext_name, extension_names[i]))
-         {
-            entrypoint.second.user_visible = true;
-         }
+         return VK_ERROR_INITIALIZATION_FAILED;
       }
+      entrypoint.fn = ret;
+      entrypoint.user_visible = false;
    }
+
+   return VK_SUCCESS;
 }
 
 PFN_vkVoidFunction instance_dispatch_table::get_user_enabled_entrypoint(VkInstance instance, uint32_t api_version,
                                                                         const char *fn_name) const
 {
-   auto item = m_entrypoints->find(fn_name);
-   if (item != m_entrypoints->end())
+   const entrypoint *item = find(fn_name);
+   if (item != nullptr)
    {
       /* An entrypoint is allowed to use if it has been enabled by the user or is included in the core specficiation of the API version.
        * Entrypoints included in API version 1.0 are allowed by default. */
-      if (item->second.user_visible || item->second.api_version <= api_version ||
-          item->second.api_version == VK_API_VERSION_1_0)
+      if (item->user_visible || item->api_version <= api_version || item->api_version == VK_API_VERSION_1_0)
       {
-         return item->second.fn;
+         return item->fn;
       }
       else
       {
@@ -126,33 +151,22 @@ PFN_vkVoidFunction instance_dispatch_table::get_user_enabled_entrypoint(VkInstan
    return GetInstanceProcAddr(instance, fn_name).value_or(nullptr);
 }
 
-VkResult device_dispatch_table::populate(VkDevice dev, PFN_vkGetDeviceProcAddr get_proc_fn)
+device_dispatch_table::device_dispatch_table()
+   : dispatch_table{ device_entrypoints_init }
 {
-   static constexpr entrypoint entrypoints_init[] = {
-#define DISPATCH_TABLE_ENTRY(name, ext_name, api_version, required) \
-   { "vk" #name, ext_name, nullptr, api_version, false, required },
-      DEVICE_ENTRYPOINTS_LIST(DISPATCH_TABLE_ENTRY)
-#undef DISPATCH_TABLE_ENTRY
-   };
-   static constexpr auto num_entrypoints = std::distance(std::begin(entrypoints_init), std::end(entrypoints_init));
+}
 
-   for (size_t i = 0; i < num_entrypoints; i++)
+VkResult device_dispatch_table::populate(VkDevice dev, PFN_vkGetDeviceProcAddr get_proc_fn)
+{
+   for (auto &entrypoint : m_entrypoints)
    {
-      const entrypoint entrypoint = entrypoints_init[i];
       PFN_vkVoidFunction ret = get_proc_fn(dev, entrypoint.name);
       if (!ret && entrypoint.required)
       {
          return VK_ERROR_INITIALIZATION_FAILED;
       }
-      struct entrypoint e = entrypoint;
-      e.fn = ret;
-      e.user_visible = false;
-
-      if (!m_entrypoints->try_insert(std::make_pair(e.name, e)).has_value())
-      {
-         WSI_LOG_ERROR("Failed to allocate memory for device dispatch table entry.");
-         return VK_ERROR_OUT_OF_HOST_MEMORY;
-      }
+      entrypoint.fn = ret;
+      entrypoint.user_visible = false;
    }
 
    return VK_SUCCESS;
@@ -161,15 +175,14 @@ VkResult device_dispatch_table::populate(VkDevice dev, PFN_vkGetDeviceProcAddr g
 PFN_vkVoidFunction device_dispatch_table::get_user_enabled_entrypoint(VkDevice device, uint32_t api_version,
                                                                       const char *fn_name) const
 {
-   auto item = m_entrypoints->find(fn_name);
-   if (item != m_entrypoints->end())
+   const entrypoint *item = find(fn_name);
+   if (item != nullptr)
    {
       /* An entrypoint is allowed to use if it has been enabled by the user or is included in the core specficiation of the API version.
        * Entrypoints included in API version 1.0 are allowed by default. */
-      if (item->second.user_visible || item->second.api_version <= api_version ||
-          item->second.api_version == VK_API_VERSION_1_0)
+      if (item->user_visible || item->api_version <= api_version || item->api_version == VK_API_VERSION_1_0)
       {
-         return item->second.fn;
+         return item->fn;
       }
       else
       {
@@ -238,6 +251,7 @@ void register_queue_key_mapping(VkDevice device, VkQueue queue)
    if (insert.has_value())
    {
       insert->first->second = device_key;
+      g_device_handles.erase(queue);
    }
    else
    {
@@ -271,6 +285,7 @@ VkResult instance_private_data::associate(VkInstance instance, instance_dispatch
                if (!mapping_result.has_value()) {
                   mapping_result->first->second = key;
                }
+               g_instance_handles.erase(instance);
             }
 
             return VK_SUCCESS;
@@ -293,6 +308,7 @@ VkResult instance_private_data::associate(VkInstance instance, instance_dispatch
    {
       WSI_LOG_WARNING("Hash collision when adding new instance (%p)", reinterpret_cast<void *>(instance));
 
+      g_instance_handles.erase_value(it->second);
       destroy(it->second);
       g_instance_data.erase(it);
    }
@@ -310,6 +326,7 @@ VkResult instance_private_data::associate(VkInstance instance, instance_dispatch
    {
       mapping_result->first->second = key;
    }
+   g_instance_handles.insert(instance, instance_data.get());
 
    instance_data.release(); // NOLINT(bugprone-unused-return-value)
    return VK_SUCCESS;
@@ -338,6 +355,7 @@ void instance_private_data::disassociate(VkInstance instance)
 
       instance_data = it->second;
       g_instance_data.erase(it);
+      g_instance_handles.erase_value(instance_data);
    }
 
    destroy(instance_data);
@@ -346,6 +364,12 @@ void instance_private_data::disassociate(VkInstance instance)
 template <typename dispatchable_type>
 static instance_private_data &get_instance_private_data(dispatchable_type dispatchable_object)
 {
+   instance_private_data *cached = g_instance_handles.find(dispatchable_object);
+   if (cached != nullptr)
+   {
+      return *cached;
+   }
+
    scoped_mutex lock(g_data_lock);
    void *lookup_key = get_key(dispatchable_object);
    auto map_it = g_instance_key_mapping.find(static_cast<void *>(dispatchable_object));
@@ -360,6 +384,7 @@ static instance_private_data &get_instance_private_data(dispatchable_type dispat
       throw std::out_of_range("Instance not found in WSI tracking map");
    }
 
+   g_instance_handles.insert(dispatchable_object, it->second);
    return *it->second;
 }
 
@@ -383,6 +408,12 @@ instance_private_data &instance_private_data::get(VkInstance instance)
 
 instance_private_data *instance_private_data::try_get(VkInstance instance)
 {
+   instance_private_data *cached = g_instance_handles.find(instance);
+   if (cached != nullptr)
+   {
+      return cached;
+   }
+
    scoped_mutex lock(g_data_lock);
    void *lookup_key = get_key(instance);
    auto map_it = g_instance_key_mapping.find(static_cast<void *>(instance));
@@ -404,6 +435,8 @@ instance_private_data *instance_private_data::try_get(VkInstance instance)
       }
       return nullptr;
    }
+
+   g_instance_handles.insert(instance, it->second);
    return it->second;
 }
 
@@ -598,6 +631,7 @@ VkResult device_private_data::associate(VkDevice dev, instance_private_data &ins
       if (existing != g_device_data.end())
       {
          WSI_LOG_WARNING("Replacing existing device_private_data for device (%p)", reinterpret_cast<void *>(dev));
+         g_device_handles.erase_value(existing->second);
          destroy(existing->second);
          g_device_data.erase(existing);
       }
@@ -610,6 +644,7 @@ VkResult device_private_data::associate(VkDevice dev, instance_private_data &ins
          if (collision->second != nullptr && collision->second->device == dev)
          {
             WSI_LOG_WARNING("Replacing existing device_private_data for device (%p)", reinterpret_cast<void *>(dev));
+            g_device_handles.erase_value(collision->second);
             destroy(collision->second);
             g_device_data.erase(collision);
          }
@@ -636,6 +671,7 @@ VkResult device_private_data::associate(VkDevice dev, instance_private_data &ins
    {
       mapping_result->first->second = store_key;
    }
+   g_device_handles.insert(dev, device_data.get());
 
    device_data.release();
    return VK_SUCCESS;
@@ -671,6 +707,7 @@ void device_private_data::disassociate(VkDevice dev)
 
       device_data = it->second;
       g_device_data.erase(it);
+      g_device_handles.erase_value(device_data);
 
       if (stored_device_key != nullptr)
       {
@@ -694,6 +731,12 @@ void device_private_data::disassociate(VkDevice dev)
 template <typename dispatchable_type>
 static device_private_data &get_device_private_data(dispatchable_type dispatchable_object)
 {
+   device_private_data *cached = g_device_handles.find(dispatchable_object);
+   if (cached != nullptr)
+   {
+      return *cached;
+   }
+
    scoped_mutex lock(g_data_lock);
 
    void* device_handle = static_cast<void*>(dispatchable_object);
@@ -748,6 +791,7 @@ static device_private_data &get_device_private_data(dispatchable_type dispatchab
    }
 
    // Device lookup logging disabled to reduce noise
+   g_device_handles.insert(device_handle, it->second);
    return *it->second;
 }
 
@@ -758,6 +802,12 @@ device_private_data &device_private_data::get(VkDevice device)
 
 device_private_data *device_private_data::try_get(VkDevice device)
 {
+   device_private_data *cached = g_device_handles.find(device);
+   if (cached != nullptr)
+   {
+      return cached;
+   }
+
    scoped_mutex lock(g_data_lock);
    auto key_it = g_device_key_mapping.find(static_cast<void *>(device));
    void *lookup_key = nullptr;
@@ -775,6 +825,8 @@ device_private_data *device_private_data::try_get(VkDevice device)
    {
       return nullptr;
    }
+
+   g_device_handles.insert(device, it->second);
    return it->second;
 }
 
@@ -43,7 +43,9 @@
 #include "layer_utils/unordered_set.hpp"
 #include "layer_utils/unordered_map.hpp"
 #include "layer_utils/extension_list.hpp"
+#include "layer_utils/macros.hpp"
 
+#include <array>
 #include <memory>
 #include <unordered_set>
 #include <cassert>
@@ -77,27 +79,39 @@ struct entrypoint
 /**
  * @brief Dispatch table base.
  *
- * This struct defines generic get and call function templates for a dispatch table.
+ * Entrypoints are stored in a flat array indexed by the table's entrypoint enum, generated from its entrypoint list,
+ * so calls through the dispatch table are a single indexed load. Lookups by name go through a perfect hash of the
+ * entrypoint names and are meant for the rare queries that only have a string.
+ *
+ * @tparam EntrypointId Enum with one enumerator per entrypoint of the table, followed by count.
  */
+template <typename EntrypointId>
 class dispatch_table
 {
 public:
-   using entrypoint_list = util::unordered_map<std::string, entrypoint>;
+   static constexpr size_t entrypoint_count = static_cast<size_t>(EntrypointId::count);
 
    /**
-    * @brief Construct a new dispatch table object
+    * @brief Get the function object from the entrypoints.
     *
-    * @param allocator Pre-allocated entrypoint storage container
+    * @tparam FunctionType The signature of the requested function.
+    * @param id The entrypoint of the function.
+    * @return the requested function pointer, or std::nullopt.
     */
-   dispatch_table(util::unique_ptr<entrypoint_list> entrypoints)
-      : m_entrypoints(std::move(entrypoints))
+   template <typename FunctionType>
+   std::optional<FunctionType> get_fn(EntrypointId id) const
    {
-      /* This pointer is expected to be valid */
-      assert(m_entrypoints != nullptr);
+      PFN_vkVoidFunction fn = m_entrypoints[static_cast<size_t>(id)].fn;
+      if (fn != nullptr)
+      {
+         return reinterpret_cast<FunctionType>(fn);
+      }
+
+      return std::nullopt;
    }
 
    /**
-    * @brief Get the function object from the entrypoints.
+    * @brief Get the function object from the entrypoints by name.
     *
     * @tparam FunctionType The signature of the requested function.
     * @param fn_name The name of the function.
@@ -106,10 +120,10 @@ public:
    template <typename FunctionType>
    std::optional<FunctionType> get_fn(const char *fn_name) const
    {
-      auto fn = m_entrypoints->find(fn_name);
-      if (fn != m_entrypoints->end() && fn->second.fn != nullptr)
+      const entrypoint *entry = find(fn_name);
+      if (entry != nullptr && entry->fn != nullptr)
       {
-         return reinterpret_cast<FunctionType>(fn->second.fn);
+         return reinterpret_cast<FunctionType>(entry->fn);
       }
 
       return std::nullopt;
@@ -121,31 +135,76 @@ public:
     * @param extension_names Names of the extensions enabled by user.
     * @param extension_count Number of extensions enabled by the user.
     */
-   void set_user_enabled_extensions(const char *const *extension_names, size_t extension_count);
+   void set_user_enabled_extensions(const char *const *extension_names, size_t extension_count)
+   {
+      for (size_t i = 0; i < extension_count; i++)
+      {
+         for (auto &entrypoint : m_entrypoints)
+         {
+            if (!strcmp(entrypoint.ext_name, extension_names[i]))
+            {
+               entrypoint.user_visible = true;
+            }
+         }
+      }
+   }
 
 protected:
+   /**
+    * @brief Construct a dispatch table with no functions resolved yet.
+    *
+    * @param entrypoints_init Description of every entrypoint, in EntrypointId order.
+    */
+   explicit dispatch_table(const entrypoint (&entrypoints_init)[entrypoint_count])
+   {
+      for (size_t i = 0; i < entrypoint_count; i++)
+      {
+         m_entrypoints[i] = entrypoints_init[i];
+      }
+   }
+
+   /**
+    * @brief Find an entrypoint by name.
+    *
+    * @param fn_name The name of the function.
+    * @return the entrypoint, or nullptr if it is not part of the dispatch table.
+    */
+   const entrypoint *find(const char *fn_name) const
+   {
+      const size_t index = index_of(fn_name);
+      return index < entrypoint_count ? &m_entrypoints[index] : nullptr;
+   }
+
+   /**
+    * @brief Index of an entrypoint name, defined alongside the perfect hash of each entrypoint list.
+    *
+    * @return the index, or a value not less than entrypoint_count for names outside the table.
+    */
+   static size_t index_of(const char *fn_name);
+
    /**
     * @brief Call function from the dispatch table entrypoints.
     *
     * @tparam FunctionType The signature of the function to call.
     * @tparam Args Argument types of the function to call.
     *
-    * @param fn_name Name of the function to call.
+    * @param id The entrypoint of the function to call.
     * @param args Arguments to the function to call.
     * @return function return value or std::nullopt if function is not present in entrypoints
     */
    template <
       typename FunctionType, class... Args, typename ReturnType = std::invoke_result_t<FunctionType, Args...>,
       std::enable_if_t<!std::is_void<ReturnType>::value && !std::is_same<ReturnType, VkResult>::value, bool> = true>
-   std::optional<ReturnType> call_fn(const char *fn_name, Args &&...args) const
+   std::optional<ReturnType> call_fn(EntrypointId id, Args &&...args) const
    {
-      auto fn = get_fn<FunctionType>(fn_name);
+      auto fn = get_fn<FunctionType>(id);
       if (fn.has_value())
       {
          return (*fn)(std::forward<Args>(args)...);
       }
 
-      WSI_LOG_WARNING("Call to %s failed, dispatch table does not contain the function.", fn_name);
+      WSI_LOG_WARNING("Call to %s failed, dispatch table does not contain the function.",
+                      m_entrypoints[static_cast<size_t>(id)].name);
 
       return std::nullopt;
    }
@@ -157,20 +216,21 @@ protected:
     * @tparam FunctionType The signature of the function to call.
     * @tparam Args Argument types of the function to call.
     *
-    * @param fn_name Name of the function to call.
+    * @param id The entrypoint of the function to call.
     * @param args Arguments to the function to call.
     */
    template <typename FunctionType, class... Args, typename ReturnType = std::invoke_result_t<FunctionType, Args...>,
              std::enable_if_t<std::is_void<ReturnType>::value, bool> = true>
-   void call_fn(const char *fn_name, Args &&...args) const
+   void call_fn(EntrypointId id, Args &&...args) const
    {
-      auto fn = get_fn<FunctionType>(fn_name);
+      auto fn = get_fn<FunctionType>(id);
       if (fn.has_value())
       {
          return (*fn)(std::forward<Args>(args)...);
       }
 
-      WSI_LOG_WARNING("Call to %s failed, dispatch table does not contain the function.", fn_name);
+      WSI_LOG_WARNING("Call to %s failed, dispatch table does not contain the function.",
+                      m_entrypoints[static_cast<size_t>(id)].name);
    }
 
    /**
@@ -180,27 +240,28 @@ protected:
     * @tparam FunctionType The signature of the function to call.
     * @tparam Args Argument types of the function to call.
     *
-    * @param fn_name Name of the function to call.
+    * @param id The entrypoint of the function to call.
     * @param args Arguments to the function to call.
     * @return function return value or VK_ERROR_EXTENSION_NOT_PRESENT if function is not present in entrypoints
     */
    template <typename FunctionType, class... Args, typename ReturnType = std::invoke_result_t<FunctionType, Args...>,
              std::enable_if_t<std::is_same<ReturnType, VkResult>::value, bool> = true>
-   VkResult call_fn(const char *fn_name, Args &&...args) const
+   VkResult call_fn(EntrypointId id, Args &&...args) const
    {
-      auto fn = get_fn<FunctionType>(fn_name);
+      auto fn = get_fn<FunctionType>(id);
       if (fn.has_value())
       {
          return (*fn)(std::forward<Args>(args)...);
       }
 
-      WSI_LOG_WARNING("Call to %s failed, dispatch table does not contain the function.", fn_name);
+      WSI_LOG_WARNING("Call to %s failed, dispatch table does not contain the function.",
+                      m_entrypoints[static_cast<size_t>(id)].name);
 
       return VK_ERROR_EXTENSION_NOT_PRESENT;
    }
 
-   /** @brief Vector that holds the entrypoints of the dispatch table */
-   util::unique_ptr<entrypoint_list> m_entrypoints;
+   /** @brief The entrypoints of the dispatch table, indexed by EntrypointId */
+   std::array<entrypoint, entrypoint_count> m_entrypoints;
 };
 
 /* Represents the maximum possible Vulkan API version. */
@@ -270,21 +331,31 @@ static constexpr uint32_t API_VERSION_MAX = UINT32_MAX;
    EP(GetPhysicalDeviceExternalBufferPropertiesKHR, VK_KHR_EXTERNAL_MEMORY_CAPABILITIES_EXTENSION_NAME,              \
       VK_API_VERSION_1_1, false)
 
+/**
+ * @brief Entrypoints of the instance dispatch table, in INSTANCE_ENTRYPOINTS_LIST order.
+ */
+enum class instance_entrypoint
+{
+#define DISPATCH_TABLE_ID(name, unused1, unused2, unused3) name,
+   INSTANCE_ENTRYPOINTS_LIST(DISPATCH_TABLE_ID)
+#undef DISPATCH_TABLE_ID
+   count
+};
+
+template <>
+size_t dispatch_table<instance_entrypoint>::index_of(const char *fn_name);
+
 /**
  * @brief Struct representing the instance dispatch table.
  */
-class instance_dispatch_table : public dispatch_table
+class instance_dispatch_table : public dispatch_table<instance_entrypoint>
 {
 public:
    static std::optional<instance_dispatch_table> create(const util::allocator &allocator)
    {
-      auto entrypoints = allocator.make_unique<dispatch_table::entrypoint_list>(allocator);
-      if (entrypoints == nullptr)
-      {
-         return std::nullopt;
-      }
-
-      return instance_dispatch_table{ std::move(entrypoints) };
+      /* The entrypoints are stored inline, nothing to allocate. */
+      UNUSED(allocator);
+      return instance_dispatch_table{};
    }
 
    /**
@@ -314,11 +385,11 @@ public:
     *    disp.GetInstanceProcAddr(instance, fn_name);
     * The result type will be matching the function signature, so there is no need for casting.
     */
-#define DISPATCH_TABLE_SHORTCUT(name, unused1, unused2, unused3)             \
-   template <class... Args>                                                  \
-   auto name(Args &&...args) const                                           \
-   {                                                                         \
-      return call_fn<PFN_vk##name>("vk" #name, std::forward<Args>(args)...); \
+#define DISPATCH_TABLE_SHORTCUT(name, unused1, unused2, unused3)                            \
+   template <class... Args>                                                                 \
+   auto name(Args &&...args) const                                                          \
+   {                                                                                        \
+      return call_fn<PFN_vk##name>(instance_entrypoint::name, std::forward<Args>(args)...); \
    };
 
    INSTANCE_ENTRYPOINTS_LIST(DISPATCH_TABLE_SHORTCUT)
@@ -326,14 +397,9 @@ public:
 
 private:
    /**
-    * @brief Construct instance dispatch table object
-    *
-    * @param table Pre-allocated dispatch table
+    * @brief Construct instance dispatch table object with no functions resolved yet.
     */
-   instance_dispatch_table(util::unique_ptr<dispatch_table::entrypoint_list> table)
-      : dispatch_table{ std::move(table) }
-   {
-   }
+   instance_dispatch_table();
 };
 
 /* List of device entrypoints in the layer's device dispatch table.
@@ -377,6 +443,9 @@ private:
    EP(ResetCommandBuffer, "", VK_API_VERSION_1_0, true)                                                            \
    EP(BeginCommandBuffer, "", VK_API_VERSION_1_0, true)                                                            \
    EP(EndCommandBuffer, "", VK_API_VERSION_1_0, true)                                                              \
+   EP(CmdPipelineBarrier, "", VK_API_VERSION_1_0, true)                                                            \
+   EP(CmdCopyImage, "", VK_API_VERSION_1_0, true)                                                                  \
+   EP(CmdBlitImage, "", VK_API_VERSION_1_0, true)                                                                  \
    EP(CreateImage, "", VK_API_VERSION_1_0, true)                                                                   \
    EP(DestroyImage, "", VK_API_VERSION_1_0, true)                                                                  \
    EP(GetImageMemoryRequirements, "", VK_API_VERSION_1_0, true)                                                    \
@@ -385,6 +454,8 @@ private:
    EP(FreeMemory, "", VK_API_VERSION_1_0, true)                                                                    \
    EP(MapMemory, "", VK_API_VERSION_1_0, true)                                                                     \
    EP(UnmapMemory, "", VK_API_VERSION_1_0, true)                                                                   \
+   EP(FlushMappedMemoryRanges, "", VK_API_VERSION_1_0, true)                                                       \
+   EP(InvalidateMappedMemoryRanges, "", VK_API_VERSION_1_0, true)                                                  \
    EP(GetImageSubresourceLayout, "", VK_API_VERSION_1_0, true)                                                     \
    EP(CreateFence, "", VK_API_VERSION_1_0, true)                                                                   \
    EP(DestroyFence, "", VK_API_VERSION_1_0, true)                                                                  \
@@ -409,6 +480,8 @@ private:
       false) /* VK_KHR_external_memory_fd */                                                                       \
    EP(GetMemoryFdKHR, VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME, API_VERSION_MAX, false)                            \
    EP(GetMemoryFdPropertiesKHR, VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME, API_VERSION_MAX, false)                  \
+   /* VK_EXT_external_memory_host */                                                                               \
+   EP(GetMemoryHostPointerPropertiesEXT, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME, API_VERSION_MAX, false)       \
    /* VK_KHR_bind_memory2 or */ /* 1.1 (without KHR suffix) */                                                     \
    EP(BindImageMemory2KHR, VK_KHR_BIND_MEMORY_2_EXTENSION_NAME, VK_API_VERSION_1_1, false)                         \
    EP(BindBufferMemory2KHR, VK_KHR_BIND_MEMORY_2_EXTENSION_NAME, VK_API_VERSION_1_1,                               \
@@ -434,21 +507,31 @@ private:
    /* Custom entrypoints */                                                                                        \
    DEVICE_ENTRYPOINTS_LIST_EXPANSION(EP)
 
+/**
+ * @brief Entrypoints of the device dispatch table, in DEVICE_ENTRYPOINTS_LIST order.
+ */
+enum class device_entrypoint
+{
+#define DISPATCH_TABLE_ID(name, unused1, unused2, unused3) name,
+   DEVICE_ENTRYPOINTS_LIST(DISPATCH_TABLE_ID)
+#undef DISPATCH_TABLE_ID
+   count
+};
+
+template <>
+size_t dispatch_table<device_entrypoint>::index_of(const char *fn_name);
+
 /**
  * @brief Struct representing the device dispatch table.
  */
-class device_dispatch_table : public dispatch_table
+class device_dispatch_table : public dispatch_table<device_entrypoint>
 {
 public:
    static std::optional<device_dispatch_table> create(const util::allocator &allocator)
    {
-      auto entrypoints = allocator.make_unique<dispatch_table::entrypoint_list>(allocator);
-      if (entrypoints == nullptr)
-      {
-         return std::nullopt;
-      }
-
-      return device_dispatch_table{ std::move(entrypoints) };
+      /* The entrypoints are stored inline, nothing to allocate. */
+      UNUSED(allocator);
+      return device_dispatch_table{};
    }
 
    /**
@@ -478,11 +561,11 @@ public:
     *    disp.GetDeviceProcAddr(instance, fn_name);
     * The result type will be matching the function signature, so there is no need for casting.
     */
-#define DISPATCH_TABLE_SHORTCUT(name, unused1, unused2, unused3)             \
-   template <class... Args>                                                  \
-   auto name(Args &&...args) const                                           \
-   {                                                                         \
-      return call_fn<PFN_vk##name>("vk" #name, std::forward<Args>(args)...); \
+#define DISPATCH_TABLE_SHORTCUT(name, unused1, unused2, unused3)                          \
+   template <class... Args>                                                               \
+   auto name(Args &&...args) const                                                        \
+   {                                                                                      \
+      return call_fn<PFN_vk##name>(device_entrypoint::name, std::forward<Args>(args)...); \
    };
 
    DEVICE_ENTRYPOINTS_LIST(DISPATCH_TABLE_SHORTCUT)
@@ -490,14 +573,9 @@ public:
 
 private:
    /**
-    * @brief Construct instance dispatch table object
-    *
-    * @param table Pre-allocated dispatch table
+    * @brief Construct device dispatch table object with no functions resolved yet.
     */
-   device_dispatch_table(util::unique_ptr<dispatch_table::entrypoint_list> table)
-      : dispatch_table{ std::move(table) }
-   {
-   }
+   device_dispatch_table();
 };
 
 /**
@@ -1021,4 +1099,6 @@ void register_queue_key_mapping(VkDevice device, VkQueue queue);
 namespace wsi {
 using instance_private_data = mali_wrapper::instance_private_data;
 using device_private_data = mali_wrapper::device_private_data;
+using instance_entrypoint = mali_wrapper::instance_entrypoint;
+using device_entrypoint = mali_wrapper::device_entrypoint;
 }
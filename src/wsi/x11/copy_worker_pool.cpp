@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file copy_worker_pool.cpp
+ *
+ * @brief Persistent worker pool used to parallelise per-frame pixel copies.
+ */
+
+#include "copy_worker_pool.hpp"
+#include "utils/logging.hpp"
+
+#include <sched.h>
+#include <algorithm>
+#include <system_error>
+
+namespace wsi
+{
+namespace x11
+{
+
+/* Upper bound on threads taking part in a copy, including the presenting thread. */
+static constexpr uint32_t MAX_COPY_CONCURRENCY = 8u;
+
+/**
+ * @brief Number of CPUs this process may actually run on.
+ *
+ * std::thread::hardware_concurrency() reports every online core, which over-counts when the process is pinned to a
+ * cluster (e.g. the big cores of a big.LITTLE SoC).
+ */
+static uint32_t get_usable_cpu_count()
+{
+   cpu_set_t set;
+   CPU_ZERO(&set);
+   if (sched_getaffinity(0, sizeof(set), &set) == 0)
+   {
+      int count = CPU_COUNT(&set);
+      if (count > 0)
+      {
+         return static_cast<uint32_t>(count);
+      }
+   }
+
+   return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+copy_worker_pool &copy_worker_pool::get()
+{
+   static copy_worker_pool pool;
+   return pool;
+}
+
+copy_worker_pool::copy_worker_pool()
+{
+   const uint32_t worker_count = std::min(get_usable_cpu_count(), MAX_COPY_CONCURRENCY) - 1;
+
+   m_workers.reserve(worker_count);
+   for (uint32_t i = 0; i < worker_count; i++)
+   {
+      try
+      {
+         m_workers.emplace_back(&copy_worker_pool::worker_main, this);
+      }
+      catch (const std::system_error &e)
+      {
+         WSI_LOG_WARNING("Failed to spawn copy worker %u: %s", i, e.what());
+         break;
+      }
+   }
+
+   WSI_LOG_DEBUG("Copy worker pool started with %zu workers", m_workers.size());
+}
+
+copy_worker_pool::~copy_worker_pool()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+   }
+   m_work_cond.notify_all();
+
+   for (auto &worker : m_workers)
+   {
+      worker.join();
+   }
+}
+
+void copy_worker_pool::process_bands()
+{
+   for (;;)
+   {
+      const uint32_t band = m_next_band.fetch_add(1, std::memory_order_relaxed);
+      if (band >= m_band_count)
+      {
+         return;
+      }
+
+      const uint32_t begin_row = band * m_band_rows;
+      const uint32_t end_row = std::min(begin_row + m_band_rows, m_rows);
+      m_function(m_context, begin_row, end_row);
+
+      m_completed_bands.fetch_add(1, std::memory_order_release);
+   }
+}
+
+void copy_worker_pool::worker_main()
+{
+   uint64_t seen_generation = 0;
+
+   std::unique_lock<std::mutex> lock(m_mutex);
+   for (;;)
+   {
+      m_work_cond.wait(lock, [&] { return m_stop || m_generation != seen_generation; });
+      if (m_stop)
+      {
+         return;
+      }
+
+      seen_generation = m_generation;
+      m_active_workers++;
+      lock.unlock();
+
+      process_bands();
+
+      lock.lock();
+      if (--m_active_workers == 0)
+      {
+         m_done_cond.notify_one();
+      }
+   }
+}
+
+bool copy_worker_pool::run(uint32_t rows, uint32_t band_rows, band_function function, void *context)
+{
+   if (m_workers.empty() || rows == 0 || band_rows == 0)
+   {
+      return false;
+   }
+
+   std::unique_lock<std::mutex> dispatch_lock(m_dispatch_mutex, std::try_to_lock);
+   if (!dispatch_lock.owns_lock())
+   {
+      return false;
+   }
+
+   {
+      /* A worker that woke up too late for the previous job may still be draining its (empty) band counter. */
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_done_cond.wait(lock, [&] { return m_active_workers == 0; });
+
+      m_function = function;
+      m_context = context;
+      m_rows = rows;
+      m_band_rows = band_rows;
+      m_band_count = (rows + band_rows - 1) / band_rows;
+      m_next_band.store(0, std::memory_order_relaxed);
+      m_completed_bands.store(0, std::memory_order_relaxed);
+      m_generation++;
+   }
+   m_work_cond.notify_all();
+
+   /* The presenting thread steals bands too rather than sleeping on the barrier. */
+   process_bands();
+
+   /* Barrier: every band must be done and no worker may still be touching the caller's buffers. */
+   std::unique_lock<std::mutex> lock(m_mutex);
+   m_done_cond.wait(lock, [&] {
+      return m_active_workers == 0 && m_completed_bands.load(std::memory_order_acquire) == m_band_count;
+   });
+
+   return true;
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file copy_worker_pool.hpp
+ *
+ * @brief Persistent worker pool used to parallelise per-frame pixel copies.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wsi
+{
+namespace x11
+{
+
+/**
+ * @brief Process-wide pool of pre-spawned copy threads.
+ *
+ * Work is described as a number of rows which the pool splits into fixed size bands. Workers and the calling
+ * thread pull bands from a shared atomic counter until none are left, so a worker that gets descheduled does not
+ * hold up the rest of the frame. The call returns only once every band has been processed.
+ *
+ * Only one job runs at a time. If another presenter is already using the pool the caller is told so and is
+ * expected to do the work inline rather than wait.
+ */
+class copy_worker_pool
+{
+public:
+   /**
+    * @brief Function invoked for each band of rows, [begin_row, end_row).
+    */
+   using band_function = void (*)(void *context, uint32_t begin_row, uint32_t end_row);
+
+   /**
+    * @brief Get the process-wide pool, spawning its threads on first use.
+    */
+   static copy_worker_pool &get();
+
+   ~copy_worker_pool();
+
+   copy_worker_pool(const copy_worker_pool &) = delete;
+   copy_worker_pool &operator=(const copy_worker_pool &) = delete;
+
+   /**
+    * @brief Split @p rows into bands of @p band_rows and process them on the pool and the calling thread.
+    *
+    * @param rows      Total number of rows.
+    * @param band_rows Number of rows per band, must be non-zero.
+    * @param function  Band callback.
+    * @param context   Opaque pointer passed to @p function.
+    *
+    * @return true if the work was completed, false if the pool is unavailable (no workers or busy with another job),
+    *         in which case nothing has been done.
+    */
+   bool run(uint32_t rows, uint32_t band_rows, band_function function, void *context);
+
+   /**
+    * @brief Convenience wrapper around run() for callables.
+    */
+   template <typename F>
+   bool run(uint32_t rows, uint32_t band_rows, F &callable)
+   {
+      return run(rows, band_rows, &invoke<F>, &callable);
+   }
+
+   /**
+    * @brief Number of threads taking part in a job, including the caller.
+    */
+   uint32_t concurrency() const
+   {
+      return static_cast<uint32_t>(m_workers.size()) + 1;
+   }
+
+private:
+   copy_worker_pool();
+
+   template <typename F>
+   static void invoke(void *context, uint32_t begin_row, uint32_t end_row)
+   {
+      (*static_cast<F *>(context))(begin_row, end_row);
+   }
+
+   void worker_main();
+   void process_bands();
+
+   std::vector<std::thread> m_workers;
+
+   /* Serialises callers of run(). */
+   std::mutex m_dispatch_mutex;
+
+   /* Protects the job description and the worker bookkeeping below. */
+   std::mutex m_mutex;
+   std::condition_variable m_work_cond;
+   std::condition_variable m_done_cond;
+   uint64_t m_generation = 0;
+   uint32_t m_active_workers = 0;
+   bool m_stop = false;
+
+   band_function m_function = nullptr;
+   void *m_context = nullptr;
+   uint32_t m_rows = 0;
+   uint32_t m_band_rows = 0;
+   uint32_t m_band_count = 0;
+   std::atomic<uint32_t> m_next_band{ 0 };
+   std::atomic<uint32_t> m_completed_bands{ 0 };
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
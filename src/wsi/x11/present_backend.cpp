@@ -0,0 +1,315 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file present_backend.cpp
+ *
+ * @brief Frame submission and pacing through the X Present extension.
+ */
+
+#include "present_backend.hpp"
+#include "utils/logging.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+namespace wsi
+{
+namespace x11
+{
+
+/* PresentWindowDestroyed from presentproto, xcb does not name the ConfigureNotify pixmap flags. */
+static constexpr uint32_t PRESENT_WINDOW_DESTROYED = 1;
+
+/* Weight of a new sample in the refresh duration average, as 1 / REFRESH_AVERAGE_WEIGHT. */
+static constexpr uint64_t REFRESH_AVERAGE_WEIGHT = 8;
+
+/* A continuously refreshed shared image is shown once per vblank, like a FIFO swapchain. */
+static bool is_fifo(VkPresentModeKHR present_mode)
+{
+   return present_mode == VK_PRESENT_MODE_FIFO_KHR || present_mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR ||
+          present_mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR;
+}
+
+bool present_backend::is_supported(xcb_connection_t *connection)
+{
+   const xcb_query_extension_reply_t *present_ext = xcb_get_extension_data(connection, &xcb_present_id);
+   const xcb_query_extension_reply_t *xfixes_ext = xcb_get_extension_data(connection, &xcb_xfixes_id);
+   if (present_ext == nullptr || !present_ext->present || xfixes_ext == nullptr || !xfixes_ext->present)
+   {
+      return false;
+   }
+
+   xcb_present_query_version_cookie_t present_cookie =
+      xcb_present_query_version(connection, XCB_PRESENT_MAJOR_VERSION, XCB_PRESENT_MINOR_VERSION);
+   /* Regions need XFixes 2.0, and the version must be negotiated before any other XFixes request. */
+   xcb_xfixes_query_version_cookie_t xfixes_cookie = xcb_xfixes_query_version(connection, 2, 0);
+
+   xcb_present_query_version_reply_t *present_version =
+      xcb_present_query_version_reply(connection, present_cookie, nullptr);
+   xcb_xfixes_query_version_reply_t *xfixes_version =
+      xcb_xfixes_query_version_reply(connection, xfixes_cookie, nullptr);
+
+   const bool supported = present_version != nullptr && xfixes_version != nullptr && xfixes_version->major_version >= 2;
+   free(present_version);
+   free(xfixes_version);
+   return supported;
+}
+
+present_backend::~present_backend()
+{
+   if (m_connection == nullptr)
+   {
+      return;
+   }
+
+   for (auto &pixmap : m_pixmap_busy)
+   {
+      xcb_free_pixmap(m_connection, pixmap.first);
+   }
+
+   if (m_update_region != XCB_NONE)
+   {
+      xcb_xfixes_destroy_region(m_connection, m_update_region);
+   }
+
+   if (m_special_event != nullptr)
+   {
+      xcb_present_select_input(m_connection, m_event_id, m_window, 0);
+      xcb_unregister_for_special_event(m_connection, m_special_event);
+   }
+
+   xcb_flush(m_connection);
+}
+
+VkResult present_backend::init(xcb_connection_t *connection, xcb_window_t window)
+{
+   m_connection = connection;
+   m_window = window;
+
+   m_event_id = xcb_generate_id(m_connection);
+   m_special_event = xcb_register_for_special_xge(m_connection, &xcb_present_id, m_event_id, nullptr);
+   if (m_special_event == nullptr)
+   {
+      WSI_LOG_ERROR("Failed to register for Present events");
+      return VK_ERROR_INITIALIZATION_FAILED;
+   }
+
+   xcb_void_cookie_t select_cookie = xcb_present_select_input_checked(
+      m_connection, m_event_id, m_window,
+      XCB_PRESENT_EVENT_MASK_CONFIGURE_NOTIFY | XCB_PRESENT_EVENT_MASK_COMPLETE_NOTIFY |
+         XCB_PRESENT_EVENT_MASK_IDLE_NOTIFY);
+   xcb_generic_error_t *error = xcb_request_check(m_connection, select_cookie);
+   if (error != nullptr)
+   {
+      WSI_LOG_ERROR("Failed to select Present events: error %d", error->error_code);
+      free(error);
+      xcb_unregister_for_special_event(m_connection, m_special_event);
+      m_special_event = nullptr;
+      return VK_ERROR_INITIALIZATION_FAILED;
+   }
+
+   m_update_region = xcb_generate_id(m_connection);
+   xcb_xfixes_create_region(m_connection, m_update_region, 0, nullptr);
+
+   return VK_SUCCESS;
+}
+
+xcb_pixmap_t present_backend::create_pixmap(xcb_shm_seg_t seg, uint32_t offset, uint16_t width, uint16_t height,
+                                            uint8_t depth)
+{
+   xcb_pixmap_t pixmap = xcb_generate_id(m_connection);
+   xcb_shm_create_pixmap(m_connection, pixmap, m_window, width, height, depth, seg, offset);
+   m_pixmap_busy[pixmap] = false;
+   return pixmap;
+}
+
+void present_backend::destroy_pixmap(xcb_pixmap_t pixmap)
+{
+   if (pixmap == XCB_PIXMAP_NONE)
+   {
+      return;
+   }
+
+   /* The server keeps a reference while a present is pending, so the pixels stay valid until it is done. */
+   xcb_free_pixmap(m_connection, pixmap);
+   m_pixmap_busy.erase(pixmap);
+}
+
+bool present_backend::wait_for_event()
+{
+   xcb_generic_event_t *event = xcb_wait_for_special_event(m_connection, m_special_event);
+   if (event == nullptr)
+   {
+      WSI_LOG_ERROR("X connection lost while waiting for Present events");
+      m_window_lost = true;
+      return false;
+   }
+
+   handle_event(event);
+   free(event);
+   return !m_window_lost;
+}
+
+void present_backend::handle_complete(const xcb_present_complete_notify_event_t *event)
+{
+   if (event->kind != XCB_PRESENT_COMPLETE_KIND_PIXMAP)
+   {
+      return;
+   }
+
+   m_completed_serial = event->serial;
+
+   if (m_last_ust != 0 && event->msc > m_last_msc && event->ust > m_last_ust)
+   {
+      const uint64_t frame_ns = (event->ust - m_last_ust) * 1000 / (event->msc - m_last_msc);
+      m_refresh_duration_ns =
+         m_refresh_duration_ns == 0 ?
+            frame_ns :
+            m_refresh_duration_ns + frame_ns / REFRESH_AVERAGE_WEIGHT - m_refresh_duration_ns / REFRESH_AVERAGE_WEIGHT;
+   }
+
+   m_last_msc = event->msc;
+   m_last_ust = event->ust;
+}
+
+void present_backend::handle_event(const xcb_generic_event_t *event)
+{
+   const auto *present_event = reinterpret_cast<const xcb_present_generic_event_t *>(event);
+   switch (present_event->evtype)
+   {
+   case XCB_PRESENT_EVENT_COMPLETE_NOTIFY:
+      handle_complete(reinterpret_cast<const xcb_present_complete_notify_event_t *>(event));
+      break;
+   case XCB_PRESENT_EVENT_IDLE_NOTIFY:
+   {
+      const auto *idle = reinterpret_cast<const xcb_present_idle_notify_event_t *>(event);
+      auto it = m_pixmap_busy.find(idle->pixmap);
+      if (it != m_pixmap_busy.end())
+      {
+         it->second = false;
+      }
+      break;
+   }
+   case XCB_PRESENT_EVENT_CONFIGURE_NOTIFY:
+   {
+      const auto *configure = reinterpret_cast<const xcb_present_configure_notify_event_t *>(event);
+      if (configure->pixmap_flags & PRESENT_WINDOW_DESTROYED)
+      {
+         m_window_lost = true;
+      }
+      break;
+   }
+   default:
+      break;
+   }
+}
+
+bool present_backend::wait_idle(xcb_pixmap_t pixmap)
+{
+   auto it = m_pixmap_busy.find(pixmap);
+   while (!m_window_lost && it != m_pixmap_busy.end() && it->second)
+   {
+      if (!wait_for_event())
+      {
+         return false;
+      }
+   }
+   return !m_window_lost;
+}
+
+bool present_backend::dispatch_events()
+{
+   xcb_generic_event_t *event = nullptr;
+   while (!m_window_lost && (event = xcb_poll_for_special_event(m_connection, m_special_event)) != nullptr)
+   {
+      handle_event(event);
+      free(event);
+   }
+
+   if (xcb_connection_has_error(m_connection))
+   {
+      WSI_LOG_ERROR("X connection lost while polling for Present events");
+      m_window_lost = true;
+   }
+   return !m_window_lost;
+}
+
+bool present_backend::is_idle(xcb_pixmap_t pixmap) const
+{
+   auto it = m_pixmap_busy.find(pixmap);
+   return m_window_lost || it == m_pixmap_busy.end() || !it->second;
+}
+
+bool present_backend::can_present(VkPresentModeKHR present_mode) const
+{
+   return m_window_lost || !is_fifo(present_mode) || m_completed_serial == m_sent_serial;
+}
+
+bool present_backend::present(xcb_pixmap_t pixmap, const VkRect2D *update_rects, uint32_t update_count,
+                              VkOffset2D offset, VkPresentModeKHR present_mode)
+{
+   const bool fifo = is_fifo(present_mode);
+
+   uint64_t target_msc = 0;
+   if (fifo)
+   {
+      while (m_completed_serial != m_sent_serial)
+      {
+         if (!wait_for_event())
+         {
+            return false;
+         }
+      }
+      target_msc = m_last_msc + 1;
+   }
+
+   /* Without ASYNC a frame waits for the vblank; for MAILBOX a newer copy queued for the same MSC replaces it. */
+   uint32_t options = XCB_PRESENT_OPTION_NONE;
+   if (present_mode == VK_PRESENT_MODE_IMMEDIATE_KHR || present_mode == VK_PRESENT_MODE_FIFO_RELAXED_KHR)
+   {
+      options |= XCB_PRESENT_OPTION_ASYNC;
+   }
+
+   std::vector<xcb_rectangle_t> rects(update_count);
+   for (uint32_t i = 0; i < update_count; i++)
+   {
+      rects[i] = { static_cast<int16_t>(update_rects[i].offset.x), static_cast<int16_t>(update_rects[i].offset.y),
+                   static_cast<uint16_t>(update_rects[i].extent.width),
+                   static_cast<uint16_t>(update_rects[i].extent.height) };
+   }
+   xcb_xfixes_set_region(m_connection, m_update_region, update_count, rects.data());
+
+   m_sent_serial++;
+   m_pixmap_busy[pixmap] = true;
+   xcb_present_pixmap(m_connection, m_window, pixmap, m_sent_serial, XCB_NONE, m_update_region,
+                      static_cast<int16_t>(offset.x), static_cast<int16_t>(offset.y), XCB_NONE, XCB_NONE, XCB_NONE,
+                      options, target_msc, 0, 0, 0, nullptr);
+   xcb_flush(m_connection);
+
+   return !m_window_lost;
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
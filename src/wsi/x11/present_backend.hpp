@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file present_backend.hpp
+ *
+ * @brief Frame submission and pacing through the X Present extension.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+#include <xcb/xcb.h>
+#include <xcb/present.h>
+#include <xcb/shm.h>
+#include <xcb/xfixes.h>
+
+namespace wsi
+{
+namespace x11
+{
+
+/**
+ * @brief Presents SHM pixmaps with PresentPixmap and tracks their completion.
+ *
+ * Frames are queued against a target MSC instead of being drawn straight into the window, so FIFO presents are
+ * locked to the vblank of the CRTC showing the window. Completion and idle events arrive on a special event queue of
+ * their own, which keeps them away from whatever the application does with the connection.
+ *
+ * Not thread safe, all calls must come from the thread that presents.
+ */
+class present_backend
+{
+public:
+   present_backend() = default;
+   ~present_backend();
+
+   present_backend(const present_backend &) = delete;
+   present_backend &operator=(const present_backend &) = delete;
+
+   /**
+    * @brief Whether the server has the Present and XFixes versions needed.
+    */
+   static bool is_supported(xcb_connection_t *connection);
+
+   /**
+    * @brief Start receiving Present events for a window.
+    */
+   VkResult init(xcb_connection_t *connection, xcb_window_t window);
+
+   /**
+    * @brief Create a pixmap over an attached SHM segment.
+    *
+    * @param seg    Segment holding the pixels.
+    * @param offset Byte offset of the first pixel in the segment.
+    * @param width  Width in pixels, the server derives the stride from it and the depth's scanline pad.
+    * @param height Height in pixels.
+    * @param depth  Pixmap depth, the window's.
+    */
+   xcb_pixmap_t create_pixmap(xcb_shm_seg_t seg, uint32_t offset, uint16_t width, uint16_t height, uint8_t depth);
+
+   void destroy_pixmap(xcb_pixmap_t pixmap);
+
+   /**
+    * @brief Block until the server no longer reads @p pixmap.
+    *
+    * @return false if the window is gone or the connection broke.
+    */
+   bool wait_idle(xcb_pixmap_t pixmap);
+
+   /**
+    * @brief Handle the events that already arrived, without blocking.
+    *
+    * @return false if the window is gone or the connection broke.
+    */
+   bool dispatch_events();
+
+   /**
+    * @brief Whether the server no longer reads @p pixmap as of the events handled so far, or the window is gone.
+    */
+   bool is_idle(xcb_pixmap_t pixmap) const;
+
+   /**
+    * @brief Whether present() would send a frame of @p present_mode without waiting for an event.
+    */
+   bool can_present(VkPresentModeKHR present_mode) const;
+
+   /**
+    * @brief Queue @p pixmap for presentation.
+    *
+    * FIFO modes first wait for the previous present to complete and target the vblank after it, so at most one frame
+    * is queued in the server and the caller is throttled to the refresh rate. Callers that must not block check
+    * can_present() first.
+    *
+    * @param pixmap       Pixmap to present.
+    * @param update_rects Parts of the pixmap to copy to the window, in pixmap coordinates.
+    * @param update_count Number of @p update_rects, must be non-zero.
+    * @param offset       Position of the pixmap in the window.
+    * @param present_mode Vulkan present mode the frame was queued with.
+    *
+    * @return false if the window is gone or the connection broke.
+    */
+   bool present(xcb_pixmap_t pixmap, const VkRect2D *update_rects, uint32_t update_count, VkOffset2D offset,
+                VkPresentModeKHR present_mode);
+
+   /**
+    * @brief Refresh duration measured from completion timestamps, 0 until two completions were seen.
+    */
+   uint64_t get_refresh_duration_ns() const
+   {
+      return m_refresh_duration_ns;
+   }
+
+private:
+   /**
+    * @brief Wait for and handle one event.
+    */
+   bool wait_for_event();
+   void handle_event(const xcb_generic_event_t *event);
+   void handle_complete(const xcb_present_complete_notify_event_t *event);
+
+   xcb_connection_t *m_connection = nullptr;
+   xcb_window_t m_window = XCB_NONE;
+   uint32_t m_event_id = 0;
+   xcb_special_event_t *m_special_event = nullptr;
+   xcb_xfixes_region_t m_update_region = XCB_NONE;
+
+   /* Serial of the last PresentPixmap sent and of the last one completed. */
+   uint32_t m_sent_serial = 0;
+   uint32_t m_completed_serial = 0;
+
+   /* Last completion timestamp; UST is CLOCK_MONOTONIC in microseconds. */
+   uint64_t m_last_msc = 0;
+   uint64_t m_last_ust = 0;
+   uint64_t m_refresh_duration_ns = 0;
+
+   /* Pixmaps the server may still be reading. */
+   std::unordered_map<xcb_pixmap_t, bool> m_pixmap_busy;
+   bool m_window_lost = false;
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
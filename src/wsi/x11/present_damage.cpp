@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file present_damage.cpp
+ *
+ * @brief Damage tracking used to limit X11 presentation to the changed parts of an image.
+ */
+
+#include "present_damage.hpp"
+#include "copy_worker_pool.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace wsi
+{
+namespace x11
+{
+
+/* Extra area two rectangles may waste when merged, traded against the cost of another put_image request. */
+static constexpr uint64_t MERGE_SLACK_PIXELS = 64 * 64;
+
+static uint64_t rect_area(const VkRect2D &rect)
+{
+   return static_cast<uint64_t>(rect.extent.width) * rect.extent.height;
+}
+
+static VkRect2D rect_union(const VkRect2D &a, const VkRect2D &b)
+{
+   const int32_t x0 = std::min(a.offset.x, b.offset.x);
+   const int32_t y0 = std::min(a.offset.y, b.offset.y);
+   const int32_t x1 = std::max(a.offset.x + static_cast<int32_t>(a.extent.width),
+                               b.offset.x + static_cast<int32_t>(b.extent.width));
+   const int32_t y1 = std::max(a.offset.y + static_cast<int32_t>(a.extent.height),
+                               b.offset.y + static_cast<int32_t>(b.extent.height));
+   return { { x0, y0 }, { static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0) } };
+}
+
+damage_region::damage_region(uint32_t width, uint32_t height)
+   : m_full_rect{ { 0, 0 }, { width, height } }
+{
+}
+
+void damage_region::add(const VkRect2D &rect)
+{
+   if (m_full)
+   {
+      return;
+   }
+
+   const int64_t x0 = std::max<int64_t>(rect.offset.x, 0);
+   const int64_t y0 = std::max<int64_t>(rect.offset.y, 0);
+   const int64_t x1 = std::min<int64_t>(static_cast<int64_t>(rect.offset.x) + rect.extent.width,
+                                        m_full_rect.extent.width);
+   const int64_t y1 = std::min<int64_t>(static_cast<int64_t>(rect.offset.y) + rect.extent.height,
+                                        m_full_rect.extent.height);
+   if (x1 <= x0 || y1 <= y0)
+   {
+      return;
+   }
+
+   const VkRect2D clipped = { { static_cast<int32_t>(x0), static_cast<int32_t>(y0) },
+                              { static_cast<uint32_t>(x1 - x0), static_cast<uint32_t>(y1 - y0) } };
+
+   if (m_count < MAX_RECTS)
+   {
+      m_rects[m_count++] = clipped;
+      return;
+   }
+
+   uint32_t best = 0;
+   uint64_t best_growth = UINT64_MAX;
+   for (uint32_t i = 0; i < m_count; i++)
+   {
+      const uint64_t growth = rect_area(rect_union(m_rects[i], clipped)) - rect_area(m_rects[i]);
+      if (growth < best_growth)
+      {
+         best = i;
+         best_growth = growth;
+      }
+   }
+   m_rects[best] = rect_union(m_rects[best], clipped);
+}
+
+void damage_region::set_full()
+{
+   m_full = true;
+   m_count = 0;
+}
+
+void damage_region::optimize()
+{
+   if (m_full || m_count == 0)
+   {
+      return;
+   }
+
+   bool merged = true;
+   while (merged)
+   {
+      merged = false;
+      for (uint32_t i = 0; i < m_count && !merged; i++)
+      {
+         for (uint32_t j = i + 1; j < m_count; j++)
+         {
+            const VkRect2D combined = rect_union(m_rects[i], m_rects[j]);
+            if (rect_area(combined) <= rect_area(m_rects[i]) + rect_area(m_rects[j]) + MERGE_SLACK_PIXELS)
+            {
+               m_rects[i] = combined;
+               m_rects[j] = m_rects[--m_count];
+               merged = true;
+               break;
+            }
+         }
+      }
+   }
+
+   /* One full-size request beats several that cover most of the image. */
+   uint64_t damaged_area = 0;
+   for (uint32_t i = 0; i < m_count; i++)
+   {
+      damaged_area += rect_area(m_rects[i]);
+   }
+   if (damaged_area * 4 >= rect_area(m_full_rect) * 3)
+   {
+      set_full();
+   }
+}
+
+uint64_t tile_damage_detector::hash_tile(const uint8_t *pixels, size_t stride, uint32_t tile_x, uint32_t tile_y,
+                                         uint32_t bytes_per_pixel) const
+{
+   const uint32_t x0 = tile_x * TILE_SIZE;
+   const uint32_t y0 = tile_y * TILE_SIZE;
+   const uint32_t y1 = std::min(y0 + TILE_SIZE, m_height);
+   const size_t row_bytes = static_cast<size_t>(std::min(x0 + TILE_SIZE, m_width) - x0) * bytes_per_pixel;
+
+   uint64_t hash = 0xcbf29ce484222325ull;
+   for (uint32_t y = y0; y < y1; y++)
+   {
+      const uint8_t *row = pixels + y * stride + static_cast<size_t>(x0) * bytes_per_pixel;
+
+      size_t offset = 0;
+      for (; offset + sizeof(uint64_t) <= row_bytes; offset += sizeof(uint64_t))
+      {
+         uint64_t word;
+         std::memcpy(&word, row + offset, sizeof(word));
+         hash = ((hash << 5 | hash >> 59) ^ word) * 0x9e3779b97f4a7c15ull;
+      }
+      for (; offset < row_bytes; offset++)
+      {
+         hash = (hash ^ row[offset]) * 0x100000001b3ull;
+      }
+   }
+
+   return hash;
+}
+
+void tile_damage_detector::detect(const uint8_t *pixels, size_t stride, uint32_t width, uint32_t height,
+                                  uint32_t bytes_per_pixel, damage_region &damage)
+{
+   const bool same_size = (width == m_width && height == m_height && !m_hashes.empty());
+
+   m_width = width;
+   m_height = height;
+   m_tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+   m_tiles_y = (height + TILE_SIZE - 1) / TILE_SIZE;
+   m_new_hashes.resize(static_cast<size_t>(m_tiles_x) * m_tiles_y);
+
+   auto hash_tile_rows = [&](uint32_t begin_row, uint32_t end_row) {
+      for (uint32_t tile_y = begin_row; tile_y < end_row; tile_y++)
+      {
+         for (uint32_t tile_x = 0; tile_x < m_tiles_x; tile_x++)
+         {
+            m_new_hashes[tile_y * m_tiles_x + tile_x] = hash_tile(pixels, stride, tile_x, tile_y, bytes_per_pixel);
+         }
+      }
+   };
+   if (!copy_worker_pool::get().run(m_tiles_y, 1, hash_tile_rows))
+   {
+      hash_tile_rows(0, m_tiles_y);
+   }
+
+   if (!same_size)
+   {
+      damage.set_full();
+   }
+   else
+   {
+      /* Horizontal runs of changed tiles; optimize() later joins runs from neighbouring tile rows. */
+      for (uint32_t tile_y = 0; tile_y < m_tiles_y; tile_y++)
+      {
+         const uint64_t *old_row = &m_hashes[tile_y * m_tiles_x];
+         const uint64_t *new_row = &m_new_hashes[tile_y * m_tiles_x];
+
+         uint32_t tile_x = 0;
+         while (tile_x < m_tiles_x)
+         {
+            if (old_row[tile_x] == new_row[tile_x])
+            {
+               tile_x++;
+               continue;
+            }
+
+            const uint32_t run_start = tile_x;
+            while (tile_x < m_tiles_x && old_row[tile_x] != new_row[tile_x])
+            {
+               tile_x++;
+            }
+
+            damage.add({ { static_cast<int32_t>(run_start * TILE_SIZE), static_cast<int32_t>(tile_y * TILE_SIZE) },
+                         { (tile_x - run_start) * TILE_SIZE, TILE_SIZE } });
+         }
+      }
+   }
+
+   std::swap(m_hashes, m_new_hashes);
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file present_damage.hpp
+ *
+ * @brief Damage tracking used to limit X11 presentation to the changed parts of an image.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+namespace wsi
+{
+namespace x11
+{
+
+/**
+ * @brief Bounded set of rectangles of an image that changed since the previous present.
+ *
+ * Rectangles are clipped to the image on insertion. Once the set is full, further rectangles are folded into the
+ * existing rectangle whose bounding box grows the least, so the number of put_image requests stays bounded.
+ */
+class damage_region
+{
+public:
+   static constexpr uint32_t MAX_RECTS = 16;
+
+   damage_region(uint32_t width, uint32_t height);
+
+   /**
+    * @brief Add a changed rectangle. Rectangles outside the image are ignored.
+    */
+   void add(const VkRect2D &rect);
+
+   /**
+    * @brief Mark the whole image as changed.
+    */
+   void set_full();
+
+   /**
+    * @brief Merge touching rectangles and promote to full damage when most of the image is covered anyway.
+    */
+   void optimize();
+
+   bool is_full() const
+   {
+      return m_full;
+   }
+
+   /**
+    * @brief True when nothing changed and presentation can be skipped entirely.
+    */
+   bool is_empty() const
+   {
+      return !m_full && m_count == 0;
+   }
+
+   uint32_t count() const
+   {
+      return m_full ? 1 : m_count;
+   }
+
+   const VkRect2D &rect(uint32_t index) const
+   {
+      return m_full ? m_full_rect : m_rects[index];
+   }
+
+private:
+   VkRect2D m_full_rect;
+   std::array<VkRect2D, MAX_RECTS> m_rects;
+   uint32_t m_count = 0;
+   bool m_full = false;
+};
+
+/**
+ * @brief Finds changed regions by hashing fixed size tiles and comparing them with the previous frame.
+ *
+ * This costs a read of every pixel, so it only pays off when the copy and put_image it saves are more expensive,
+ * e.g. mostly static content from applications that do not provide VK_KHR_incremental_present regions.
+ */
+class tile_damage_detector
+{
+public:
+   static constexpr uint32_t TILE_SIZE = 64;
+
+   /**
+    * @brief Compare @p pixels against the previous frame and add the tiles that differ to @p damage.
+    *
+    * The first frame, or a frame of a different size, is reported as full damage.
+    */
+   void detect(const uint8_t *pixels, size_t stride, uint32_t width, uint32_t height, uint32_t bytes_per_pixel,
+               damage_region &damage);
+
+   /**
+    * @brief Forget the previous frame, so the next detection reports full damage.
+    */
+   void reset()
+   {
+      m_hashes.clear();
+   }
+
+private:
+   uint64_t hash_tile(const uint8_t *pixels, size_t stride, uint32_t tile_x, uint32_t tile_y,
+                      uint32_t bytes_per_pixel) const;
+
+   uint32_t m_width = 0;
+   uint32_t m_height = 0;
+   uint32_t m_tiles_x = 0;
+   uint32_t m_tiles_y = 0;
+   std::vector<uint64_t> m_hashes;
+   std::vector<uint64_t> m_new_hashes;
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
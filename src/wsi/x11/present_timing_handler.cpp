@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file present_timing_handler.cpp
+ *
+ * @brief Contains the functionality to implement features for present timing extension.
+ */
+
+#include "present_timing_handler.hpp"
+#include <cstdint>
+
+#if VULKAN_WSI_LAYER_EXPERIMENTAL
+
+/* Refresh duration changes smaller than this are measurement jitter, not a mode change. */
+static constexpr uint64_t REFRESH_DURATION_TOLERANCE_NS = 50000;
+
+wsi_ext_present_timing_x11::wsi_ext_present_timing_x11(const util::allocator &allocator)
+   : wsi::wsi_ext_present_timing(allocator)
+{
+}
+
+util::unique_ptr<wsi_ext_present_timing_x11> wsi_ext_present_timing_x11::create(const util::allocator &allocator)
+{
+   /* Present completions only feed the refresh duration, the later stages are not reported per present. */
+   std::array<util::unique_ptr<wsi::vulkan_time_domain>, 1> time_domains_array = {
+      allocator.make_unique<wsi::vulkan_time_domain>(VK_PRESENT_STAGE_QUEUE_OPERATIONS_END_BIT_EXT,
+                                                     VK_TIME_DOMAIN_DEVICE_KHR)
+   };
+
+   return wsi_ext_present_timing::create<wsi_ext_present_timing_x11>(allocator, time_domains_array);
+}
+
+void wsi_ext_present_timing_x11::set_refresh_duration(uint64_t refresh_duration_ns)
+{
+   const uint64_t current = m_refresh_duration_ns.load(std::memory_order_relaxed);
+   const uint64_t difference =
+      refresh_duration_ns > current ? refresh_duration_ns - current : current - refresh_duration_ns;
+   if (difference > REFRESH_DURATION_TOLERANCE_NS)
+   {
+      m_refresh_duration_ns.store(refresh_duration_ns, std::memory_order_relaxed);
+      m_timing_properties_counter.fetch_add(1, std::memory_order_release);
+   }
+}
+
+VkResult wsi_ext_present_timing_x11::get_swapchain_timing_properties(
+   uint64_t &timing_properties_counter, VkSwapchainTimingPropertiesEXT &timing_properties)
+{
+   timing_properties_counter = m_timing_properties_counter.load(std::memory_order_acquire);
+   timing_properties.refreshDuration = m_refresh_duration_ns.load(std::memory_order_relaxed);
+   timing_properties.variableRefreshDelay = UINT64_MAX;
+
+   return VK_SUCCESS;
+}
+
+#endif
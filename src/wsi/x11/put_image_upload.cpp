@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file put_image_upload.cpp
+ *
+ * @brief Frame upload over the X11 socket for servers MIT-SHM segments cannot be shared with.
+ */
+
+#include "put_image_upload.hpp"
+#include "utils/logging.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+namespace wsi
+{
+namespace x11
+{
+
+/* PutImage header, including the extra length word of a BIG-REQUESTS request. */
+static constexpr size_t PUT_IMAGE_HEADER_BYTES = 28;
+
+/* Smaller requests than the server would take, so it draws the first rows while the rest is still on the wire. */
+static constexpr size_t MAX_PUT_IMAGE_CHUNK_BYTES = 1024 * 1024;
+
+void put_image_uploader::init(xcb_connection_t *connection, xcb_window_t window, xcb_gcontext_t gc)
+{
+   m_connection = connection;
+   m_window = window;
+   m_gc = gc;
+
+   /* In 4 byte units, this enables BIG-REQUESTS when the server has it. */
+   const size_t max_request_bytes = static_cast<size_t>(xcb_get_maximum_request_length(m_connection)) * 4;
+   m_max_chunk_bytes = std::min(max_request_bytes, MAX_PUT_IMAGE_CHUNK_BYTES) - PUT_IMAGE_HEADER_BYTES;
+
+   WSI_LOG_INFO("MIT-SHM unavailable, uploading frames over the X connection in requests of up to %zu bytes",
+                m_max_chunk_bytes);
+}
+
+char *put_image_uploader::map_frame(size_t stride, uint32_t height)
+{
+   try
+   {
+      m_frame.resize(stride * height);
+   }
+   catch (const std::bad_alloc &)
+   {
+      return nullptr;
+   }
+
+   m_frame_stride = stride;
+   return m_frame.data();
+}
+
+void put_image_uploader::upload(const VkRect2D *rects, uint32_t rect_count, VkOffset2D offset, uint8_t depth,
+                                uint32_t bytes_per_pixel, uint32_t scanline_pad)
+{
+   for (uint32_t i = 0; i < rect_count; i++)
+   {
+      const VkRect2D &rect = rects[i];
+      const size_t row_bytes = static_cast<size_t>(rect.extent.width) * bytes_per_pixel;
+      const size_t packed_stride = (rect.extent.width * bytes_per_pixel * 8 + scanline_pad - 1) / scanline_pad *
+                                   (scanline_pad / 8);
+
+      /* Full width rectangles are already laid out as the request wants them. */
+      const bool contiguous = rect.offset.x == 0 && packed_stride == m_frame_stride;
+      const uint32_t chunk_rows = static_cast<uint32_t>(
+         std::clamp<size_t>(m_max_chunk_bytes / packed_stride, 1, rect.extent.height));
+
+      if (!contiguous)
+      {
+         m_packed.resize(packed_stride * chunk_rows);
+      }
+
+      for (uint32_t row = 0; row < rect.extent.height; row += chunk_rows)
+      {
+         const uint32_t rows = std::min(chunk_rows, rect.extent.height - row);
+         const char *src = m_frame.data() + (rect.offset.y + row) * m_frame_stride + rect.offset.x * bytes_per_pixel;
+
+         const uint8_t *data = reinterpret_cast<const uint8_t *>(src);
+         if (!contiguous)
+         {
+            for (uint32_t r = 0; r < rows; r++)
+            {
+               std::memcpy(m_packed.data() + r * packed_stride, src + r * m_frame_stride, row_bytes);
+            }
+            data = reinterpret_cast<const uint8_t *>(m_packed.data());
+         }
+
+         /* libxcb has written or buffered the data once this returns, so the chunk memory can be reused. */
+         xcb_put_image(m_connection, XCB_IMAGE_FORMAT_Z_PIXMAP, m_window, m_gc, rect.extent.width, rows,
+                       rect.offset.x + offset.x, rect.offset.y + row + offset.y, 0, depth,
+                       static_cast<uint32_t>(packed_stride * rows), data);
+      }
+   }
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file put_image_upload.hpp
+ *
+ * @brief Frame upload over the X11 socket for servers MIT-SHM segments cannot be shared with.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include <xcb/xcb.h>
+
+namespace wsi
+{
+namespace x11
+{
+
+/**
+ * @brief Stages frames in process memory and sends the changed rectangles with PutImage requests.
+ *
+ * Used when the server cannot attach our shared memory: remote displays, X forwarded over SSH or a server in another
+ * IPC namespace. Rectangles are split into row chunks that fit the connection's maximum request length and written
+ * back to back without waiting for replies, so the transfer is bound by the link rather than by round trips.
+ *
+ * Not thread safe, all calls must come from the thread that presents.
+ */
+class put_image_uploader
+{
+public:
+   void init(xcb_connection_t *connection, xcb_window_t window, xcb_gcontext_t gc);
+
+   /**
+    * @brief Memory to stage a frame of @p height rows of @p stride bytes in, kept across frames.
+    *
+    * @return The frame, nullptr if it could not be allocated.
+    */
+   char *map_frame(size_t stride, uint32_t height);
+
+   /**
+    * @brief Send parts of the staged frame to the window.
+    *
+    * @param rects           Rectangles to send, in frame coordinates.
+    * @param rect_count      Number of @p rects.
+    * @param offset          Position of the frame in the window.
+    * @param depth           Depth of the window.
+    * @param bytes_per_pixel Bytes per pixel of the staged frame.
+    * @param scanline_pad    Scanline pad of the depth's pixmap format, in bits.
+    */
+   void upload(const VkRect2D *rects, uint32_t rect_count, VkOffset2D offset, uint8_t depth, uint32_t bytes_per_pixel,
+               uint32_t scanline_pad);
+
+private:
+   xcb_connection_t *m_connection = nullptr;
+   xcb_window_t m_window = XCB_NONE;
+   xcb_gcontext_t m_gc = XCB_NONE;
+
+   /* Largest PutImage payload sent at once, in bytes. */
+   size_t m_max_chunk_bytes = 0;
+
+   std::vector<char> m_frame;
+   size_t m_frame_stride = 0;
+
+   /* Rows of a rectangle narrower than the frame, packed as the request expects them. */
+   std::vector<char> m_packed;
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file randr_outputs.cpp
+ *
+ * @brief Model of the RandR CRTCs of an X11 screen, used to pace presentation at the refresh rate of the window's
+ *        output.
+ */
+
+#include "randr_outputs.hpp"
+#include "utils/logging.hpp"
+
+#include <xcb/xcbext.h>
+#include <algorithm>
+#include <cstdlib>
+
+namespace wsi
+{
+namespace x11
+{
+
+/* RRGetScreenResourcesCurrent, which does not probe the outputs, needs RandR 1.3. */
+static constexpr uint32_t RANDR_MAJOR_VERSION = 1;
+static constexpr uint32_t RANDR_MINOR_VERSION = 3;
+static constexpr std::chrono::seconds RESOURCES_POLL_INTERVAL{ 1 };
+
+static double get_mode_refresh_hz(const xcb_randr_mode_info_t &mode)
+{
+   double vtotal = mode.vtotal;
+   if (mode.mode_flags & XCB_RANDR_MODE_FLAG_DOUBLE_SCAN)
+   {
+      vtotal *= 2.0;
+   }
+   if (mode.mode_flags & XCB_RANDR_MODE_FLAG_INTERLACE)
+   {
+      vtotal /= 2.0;
+   }
+
+   if (mode.htotal == 0 || vtotal == 0.0)
+   {
+      return 0.0;
+   }
+   return static_cast<double>(mode.dot_clock) / (static_cast<double>(mode.htotal) * vtotal);
+}
+
+randr_output_model::randr_output_model(xcb_connection_t *connection)
+   : m_connection(connection)
+   , m_root(xcb_setup_roots_iterator(xcb_get_setup(connection)).data->root)
+{
+}
+
+randr_output_model::~randr_output_model()
+{
+   if (m_resources_pending)
+   {
+      xcb_discard_reply(m_connection, m_resources_cookie.sequence);
+   }
+   for (size_t i = m_crtc_replies; i < m_crtc_cookies.size(); i++)
+   {
+      xcb_discard_reply(m_connection, m_crtc_cookies[i].sequence);
+   }
+}
+
+void randr_output_model::enable_change_notify()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_change_notify = true;
+}
+
+void randr_output_model::handle_event(const xcb_generic_event_t *event)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if (!m_change_notify || !m_available)
+   {
+      return;
+   }
+
+   /* A mode or placement change of any CRTC, or a new screen layout, may move the window to another refresh rate. */
+   const uint8_t type = event->response_type & ~0x80;
+   if (type == m_first_event + XCB_RANDR_SCREEN_CHANGE_NOTIFY ||
+       (type == m_first_event + XCB_RANDR_NOTIFY &&
+        reinterpret_cast<const xcb_randr_notify_event_t *>(event)->subCode == XCB_RANDR_NOTIFY_CRTC_CHANGE))
+   {
+      m_changed = true;
+   }
+}
+
+void randr_output_model::populate()
+{
+   m_initialized = true;
+
+   const xcb_query_extension_reply_t *randr_ext = xcb_get_extension_data(m_connection, &xcb_randr_id);
+   if (randr_ext == nullptr || !randr_ext->present)
+   {
+      WSI_LOG_WARNING("RandR extension not available, refresh rate unknown");
+      return;
+   }
+
+   auto version_cookie = xcb_randr_query_version(m_connection, RANDR_MAJOR_VERSION, RANDR_MINOR_VERSION);
+   auto resources_cookie = xcb_randr_get_screen_resources_current(m_connection, m_root);
+
+   xcb_randr_query_version_reply_t *version = xcb_randr_query_version_reply(m_connection, version_cookie, nullptr);
+   const bool version_ok =
+      version != nullptr && (version->major_version > RANDR_MAJOR_VERSION ||
+                             (version->major_version == RANDR_MAJOR_VERSION &&
+                              version->minor_version >= RANDR_MINOR_VERSION));
+   free(version);
+
+   xcb_randr_get_screen_resources_current_reply_t *resources =
+      xcb_randr_get_screen_resources_current_reply(m_connection, resources_cookie, nullptr);
+   if (!version_ok || resources == nullptr)
+   {
+      WSI_LOG_WARNING("RandR 1.3 not available, refresh rate unknown");
+      free(resources);
+      return;
+   }
+
+   /* Selected before the CRTCs are read, so that no change goes unnoticed in between. */
+   if (m_change_notify)
+   {
+      m_first_event = randr_ext->first_event;
+      xcb_randr_select_input(m_connection, m_root,
+                             XCB_RANDR_NOTIFY_MASK_SCREEN_CHANGE | XCB_RANDR_NOTIFY_MASK_CRTC_CHANGE);
+   }
+
+   request_crtcs(resources);
+   free(resources);
+   collect_crtcs(true);
+   m_available = true;
+   m_last_query = std::chrono::steady_clock::now();
+}
+
+void randr_output_model::request_crtcs(const xcb_randr_get_screen_resources_current_reply_t *resources)
+{
+   m_timestamp = resources->timestamp;
+   m_config_timestamp = resources->config_timestamp;
+
+   const xcb_randr_mode_info_t *modes = xcb_randr_get_screen_resources_current_modes(resources);
+   const int mode_count = xcb_randr_get_screen_resources_current_modes_length(resources);
+   m_mode_refresh.clear();
+   for (int i = 0; i < mode_count; i++)
+   {
+      m_mode_refresh[modes[i].id] = get_mode_refresh_hz(modes[i]);
+   }
+
+   /* Send every query before waiting, so a multi-monitor layout costs a single round trip. */
+   const xcb_randr_crtc_t *crtcs = xcb_randr_get_screen_resources_current_crtcs(resources);
+   const int crtc_count = xcb_randr_get_screen_resources_current_crtcs_length(resources);
+   m_crtc_cookies.clear();
+   m_crtc_cookies.reserve(crtc_count);
+   m_crtc_replies = 0;
+   m_pending_crtcs.clear();
+   for (int i = 0; i < crtc_count; i++)
+   {
+      m_crtc_cookies.push_back(xcb_randr_get_crtc_info(m_connection, crtcs[i], resources->config_timestamp));
+   }
+}
+
+bool randr_output_model::collect_crtcs(bool wait)
+{
+   for (; m_crtc_replies < m_crtc_cookies.size(); m_crtc_replies++)
+   {
+      xcb_randr_get_crtc_info_reply_t *info = nullptr;
+      if (wait)
+      {
+         info = xcb_randr_get_crtc_info_reply(m_connection, m_crtc_cookies[m_crtc_replies], nullptr);
+      }
+      else
+      {
+         void *reply = nullptr;
+         xcb_generic_error_t *error = nullptr;
+         if (!xcb_poll_for_reply(m_connection, m_crtc_cookies[m_crtc_replies].sequence, &reply, &error))
+         {
+            return false;
+         }
+         free(error);
+         info = static_cast<xcb_randr_get_crtc_info_reply_t *>(reply);
+      }
+      if (info == nullptr)
+      {
+         continue;
+      }
+
+      auto mode = m_mode_refresh.find(info->mode);
+      if (info->mode != XCB_NONE && info->num_outputs > 0 && mode != m_mode_refresh.end())
+      {
+         randr_crtc crtc;
+         crtc.x = info->x;
+         crtc.y = info->y;
+         crtc.width = info->width;
+         crtc.height = info->height;
+         crtc.refresh_hz = mode->second;
+         m_pending_crtcs.push_back(crtc);
+         WSI_LOG_INFO("CRTC %ux%u+%d+%d at %.2f Hz", crtc.width, crtc.height, crtc.x, crtc.y, crtc.refresh_hz);
+      }
+      free(info);
+   }
+
+   /* Presentation keeps pacing at the old rates until the whole new layout is known. */
+   m_crtcs.swap(m_pending_crtcs);
+   m_pending_crtcs.clear();
+   m_crtc_cookies.clear();
+   m_crtc_replies = 0;
+   return true;
+}
+
+void randr_output_model::poll()
+{
+   if (!collect_crtcs(false))
+   {
+      return;
+   }
+
+   if (m_resources_pending)
+   {
+      void *reply = nullptr;
+      xcb_generic_error_t *error = nullptr;
+      if (!xcb_poll_for_reply(m_connection, m_resources_cookie.sequence, &reply, &error))
+      {
+         return;
+      }
+      m_resources_pending = false;
+      free(error);
+
+      auto *resources = static_cast<xcb_randr_get_screen_resources_current_reply_t *>(reply);
+      if (resources != nullptr &&
+          (resources->timestamp != m_timestamp || resources->config_timestamp != m_config_timestamp))
+      {
+         /* Collected by a later call, like the resources. */
+         WSI_LOG_INFO("RandR configuration changed, reloading CRTCs");
+         request_crtcs(resources);
+      }
+      free(reply);
+   }
+
+   const auto now = std::chrono::steady_clock::now();
+   const bool query = m_change_notify ? m_changed : now - m_last_query >= RESOURCES_POLL_INTERVAL;
+   if (query && !m_resources_pending && m_crtc_cookies.empty())
+   {
+      /* Picked up by a later call, sent by the presenter's next flush. */
+      m_resources_cookie = xcb_randr_get_screen_resources_current(m_connection, m_root);
+      m_resources_pending = true;
+      m_changed = false;
+      m_last_query = now;
+   }
+}
+
+double randr_output_model::get_refresh_rate(int32_t x, int32_t y, uint32_t width, uint32_t height)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if (!m_initialized)
+   {
+      populate();
+   }
+   if (!m_available)
+   {
+      return 0.0;
+   }
+   poll();
+
+   if (m_crtcs.empty())
+   {
+      return 0.0;
+   }
+
+   const randr_crtc *best = &m_crtcs.front();
+   int64_t best_area = 0;
+   for (const auto &crtc : m_crtcs)
+   {
+      const int64_t left = std::max<int64_t>(x, crtc.x);
+      const int64_t top = std::max<int64_t>(y, crtc.y);
+      const int64_t right = std::min<int64_t>(int64_t{ x } + width, int64_t{ crtc.x } + crtc.width);
+      const int64_t bottom = std::min<int64_t>(int64_t{ y } + height, int64_t{ crtc.y } + crtc.height);
+      const int64_t area = right > left && bottom > top ? (right - left) * (bottom - top) : 0;
+      if (area > best_area)
+      {
+         best = &crtc;
+         best_area = area;
+      }
+   }
+   return best->refresh_hz;
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
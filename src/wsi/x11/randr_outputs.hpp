@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file randr_outputs.hpp
+ *
+ * @brief Model of the RandR CRTCs of an X11 screen, used to pace presentation at the refresh rate of the window's
+ *        output.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <xcb/xcb.h>
+#include <xcb/randr.h>
+
+namespace wsi
+{
+namespace x11
+{
+
+/**
+ * @brief Active CRTC, in root window coordinates.
+ */
+struct randr_crtc
+{
+   int16_t x = 0;
+   int16_t y = 0;
+   uint16_t width = 0;
+   uint16_t height = 0;
+   double refresh_hz = 0.0;
+};
+
+/**
+ * @brief CRTC layout of the first screen of a connection, queried over that connection.
+ *
+ * Populated on first use. After that the screen resources are re-requested without waiting for the reply, and the
+ * CRTCs are only queried again, also without waiting, when the resource timestamps show a configuration change. On a
+ * connection of our own the resources are re-requested when the server sends a screen or CRTC change notification,
+ * otherwise at most once a second since selecting the notifications would replace the application's RandR mask.
+ *
+ * Owned by the surface, whose connection must stay valid for its whole lifetime. Thread safe.
+ */
+class randr_output_model
+{
+public:
+   explicit randr_output_model(xcb_connection_t *connection);
+   ~randr_output_model();
+
+   randr_output_model(const randr_output_model &) = delete;
+   randr_output_model &operator=(const randr_output_model &) = delete;
+
+   /**
+    * @brief Refresh rate of the CRTC showing the largest part of a rectangle.
+    *
+    * @param x, y          Position of the rectangle in root window coordinates.
+    * @param width, height Size of the rectangle.
+    *
+    * @return The refresh rate in Hz. A rectangle on no CRTC gets the first CRTC's rate, and 0 means RandR is not
+    *         available.
+    */
+   double get_refresh_rate(int32_t x, int32_t y, uint32_t width, uint32_t height);
+
+   /**
+    * @brief Follow configuration changes through RandR notifications instead of polling.
+    *
+    * Only for a connection the application does not use, whose events are then fed to handle_event(). Must be called
+    * before the first get_refresh_rate().
+    */
+   void enable_change_notify();
+
+   /**
+    * @brief Note a RandR change notification read off the connection, other events are ignored.
+    */
+   void handle_event(const xcb_generic_event_t *event);
+
+private:
+   void populate();
+   void poll();
+
+   /**
+    * @brief Send the CRTC queries for a set of screen resources, collected by collect_crtcs().
+    */
+   void request_crtcs(const xcb_randr_get_screen_resources_current_reply_t *resources);
+
+   /**
+    * @brief Collect the replies of request_crtcs(), replacing the CRTCs once all of them arrived.
+    *
+    * @param wait Block for the replies instead of taking the ones already received.
+    *
+    * @return true once no query is outstanding any more.
+    */
+   bool collect_crtcs(bool wait);
+
+   xcb_connection_t *m_connection;
+   xcb_window_t m_root;
+
+   std::mutex m_mutex;
+   bool m_initialized = false;
+   bool m_available = false;
+   std::vector<randr_crtc> m_crtcs;
+
+   /* Timestamps of the resources the CRTCs were loaded from. */
+   xcb_timestamp_t m_timestamp = 0;
+   xcb_timestamp_t m_config_timestamp = 0;
+
+   xcb_randr_get_screen_resources_current_cookie_t m_resources_cookie = {};
+   bool m_resources_pending = false;
+   std::chrono::steady_clock::time_point m_last_query;
+
+   /* CRTC queries in flight, with the refresh rate of each mode of their resources and the CRTCs received so far. */
+   std::vector<xcb_randr_get_crtc_info_cookie_t> m_crtc_cookies;
+   size_t m_crtc_replies = 0;
+   std::unordered_map<uint32_t, double> m_mode_refresh;
+   std::vector<randr_crtc> m_pending_crtcs;
+
+   /* Change notifications are selected, and one arrived since the resources were last requested. */
+   bool m_change_notify = false;
+   bool m_changed = false;
+   uint8_t m_first_event = 0;
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
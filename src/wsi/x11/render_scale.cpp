@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file render_scale.cpp
+ *
+ * @brief Scaling of presented frames by the X server through RENDER picture transforms.
+ */
+
+#include "render_scale.hpp"
+#include "present_backend.hpp"
+#include "utils/logging.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace wsi
+{
+namespace x11
+{
+
+/* Pad repeat, which keeps bilinear filtering from blending the frame's edges with transparent black, is 0.10. */
+static constexpr uint32_t RENDER_MAJOR_VERSION = 0;
+static constexpr uint32_t RENDER_MINOR_VERSION = 10;
+
+static xcb_render_fixed_t to_fixed(double value)
+{
+   return static_cast<xcb_render_fixed_t>(value * 65536.0 + 0.5);
+}
+
+/**
+ * @brief Find the picture format of a visual, as xcb_render_util_find_visual_format does.
+ */
+static xcb_render_pictformat_t find_visual_format(const xcb_render_query_pict_formats_reply_t *formats,
+                                                  xcb_visualid_t visual)
+{
+   for (auto screen = xcb_render_query_pict_formats_screens_iterator(formats); screen.rem;
+        xcb_render_pictscreen_next(&screen))
+   {
+      for (auto depth = xcb_render_pictscreen_depths_iterator(screen.data); depth.rem;
+           xcb_render_pictdepth_next(&depth))
+      {
+         for (auto pict_visual = xcb_render_pictdepth_visuals_iterator(depth.data); pict_visual.rem;
+              xcb_render_pictvisual_next(&pict_visual))
+         {
+            if (pict_visual.data->visual == visual)
+            {
+               return pict_visual.data->format;
+            }
+         }
+      }
+   }
+   return XCB_NONE;
+}
+
+bool render_scaler::is_supported(xcb_connection_t *connection)
+{
+   const xcb_query_extension_reply_t *render_ext = xcb_get_extension_data(connection, &xcb_render_id);
+   if (render_ext == nullptr || !render_ext->present)
+   {
+      return false;
+   }
+
+   xcb_render_query_version_reply_t *version = xcb_render_query_version_reply(
+      connection, xcb_render_query_version(connection, RENDER_MAJOR_VERSION, RENDER_MINOR_VERSION), nullptr);
+   const bool supported = version != nullptr && (version->major_version > RENDER_MAJOR_VERSION ||
+                                                 version->minor_version >= RENDER_MINOR_VERSION);
+   free(version);
+   return supported;
+}
+
+render_scaler::~render_scaler()
+{
+   if (m_connection == nullptr)
+   {
+      return;
+   }
+
+   for (auto &t : m_targets)
+   {
+      if (t.pixmap != XCB_PIXMAP_NONE)
+      {
+         destroy_target(t);
+      }
+   }
+   if (m_window_picture != XCB_NONE)
+   {
+      xcb_render_free_picture(m_connection, m_window_picture);
+   }
+}
+
+bool render_scaler::init(xcb_connection_t *connection, xcb_window_t window, present_backend *backend)
+{
+   xcb_get_window_attributes_cookie_t attributes_cookie = xcb_get_window_attributes(connection, window);
+   xcb_get_geometry_cookie_t geometry_cookie = xcb_get_geometry(connection, window);
+   xcb_render_query_pict_formats_cookie_t formats_cookie = xcb_render_query_pict_formats(connection);
+
+   xcb_get_window_attributes_reply_t *attributes = xcb_get_window_attributes_reply(connection, attributes_cookie,
+                                                                                   nullptr);
+   xcb_get_geometry_reply_t *geometry = xcb_get_geometry_reply(connection, geometry_cookie, nullptr);
+   xcb_render_query_pict_formats_reply_t *formats = xcb_render_query_pict_formats_reply(connection, formats_cookie,
+                                                                                         nullptr);
+
+   if (attributes != nullptr && geometry != nullptr && formats != nullptr)
+   {
+      m_format = find_visual_format(formats, attributes->visual);
+      m_depth = geometry->depth;
+   }
+   free(attributes);
+   free(geometry);
+   free(formats);
+
+   if (m_format == XCB_NONE)
+   {
+      WSI_LOG_WARNING("No RENDER picture format for the window's visual");
+      return false;
+   }
+
+   m_connection = connection;
+   m_window = window;
+   m_backend = backend;
+
+   if (m_backend == nullptr)
+   {
+      m_window_picture = xcb_generate_id(m_connection);
+      xcb_render_create_picture(m_connection, m_window_picture, m_window, m_format, 0, nullptr);
+   }
+   return true;
+}
+
+void render_scaler::destroy_target(target &t)
+{
+   if (t.picture != XCB_NONE)
+   {
+      xcb_render_free_picture(m_connection, t.picture);
+      t.picture = XCB_NONE;
+   }
+
+   /* Freeing is safe while a present of the pixmap is pending, see present_backend::destroy_pixmap. */
+   m_backend->destroy_pixmap(t.pixmap);
+   t.pixmap = XCB_PIXMAP_NONE;
+}
+
+void render_scaler::ensure_target(target &t, uint16_t width, uint16_t height)
+{
+   if (t.pixmap != XCB_PIXMAP_NONE && t.width == width && t.height == height)
+   {
+      return;
+   }
+
+   destroy_target(t);
+   t.pixmap = xcb_generate_id(m_connection);
+   xcb_create_pixmap(m_connection, m_depth, t.pixmap, m_window, width, height);
+   t.picture = xcb_generate_id(m_connection);
+   xcb_render_create_picture(m_connection, t.picture, t.pixmap, m_format, 0, nullptr);
+   t.width = width;
+   t.height = height;
+}
+
+bool render_scaler::is_next_target_idle() const
+{
+   return m_backend == nullptr || m_backend->is_idle(m_targets[m_next_target].pixmap);
+}
+
+bool render_scaler::present(xcb_pixmap_t source, VkExtent2D source_extent, const VkRect2D &placement,
+                            util::scale_filter filter, VkPresentModeKHR present_mode)
+{
+   const uint16_t width = static_cast<uint16_t>(placement.extent.width);
+   const uint16_t height = static_cast<uint16_t>(placement.extent.height);
+   if (width == 0 || height == 0)
+   {
+      return true;
+   }
+
+   target *t = nullptr;
+   if (m_backend != nullptr)
+   {
+      t = &m_targets[m_next_target];
+      m_next_target = (m_next_target + 1) % TARGET_COUNT;
+      if (!m_backend->wait_idle(t->pixmap))
+      {
+         return false;
+      }
+      ensure_target(*t, width, height);
+   }
+
+   const uint32_t repeat = XCB_RENDER_REPEAT_PAD;
+   xcb_render_picture_t source_picture = xcb_generate_id(m_connection);
+   xcb_render_create_picture(m_connection, source_picture, source, m_format, XCB_RENDER_CP_REPEAT, &repeat);
+
+   /* The transform maps destination pixels to source pixels. */
+   const xcb_render_transform_t transform = {
+      to_fixed(static_cast<double>(source_extent.width) / width), 0, 0,
+      0, to_fixed(static_cast<double>(source_extent.height) / height), 0,
+      0, 0, to_fixed(1.0),
+   };
+   xcb_render_set_picture_transform(m_connection, source_picture, transform);
+
+   const char *filter_name = filter == util::scale_filter::nearest ? "nearest" : "bilinear";
+   xcb_render_set_picture_filter(m_connection, source_picture, static_cast<uint16_t>(std::strlen(filter_name)),
+                                 filter_name, 0, nullptr);
+
+   if (t == nullptr)
+   {
+      xcb_render_composite(m_connection, XCB_RENDER_PICT_OP_SRC, source_picture, XCB_RENDER_PICTURE_NONE,
+                           m_window_picture, 0, 0, 0, 0, static_cast<int16_t>(placement.offset.x),
+                           static_cast<int16_t>(placement.offset.y), width, height);
+      xcb_render_free_picture(m_connection, source_picture);
+      return !xcb_connection_has_error(m_connection);
+   }
+
+   xcb_render_composite(m_connection, XCB_RENDER_PICT_OP_SRC, source_picture, XCB_RENDER_PICTURE_NONE, t->picture, 0,
+                        0, 0, 0, 0, 0, width, height);
+   xcb_render_free_picture(m_connection, source_picture);
+
+   const VkRect2D update = { { 0, 0 }, placement.extent };
+   return m_backend->present(t->pixmap, &update, 1, placement.offset, present_mode);
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
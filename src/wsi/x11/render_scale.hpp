@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file render_scale.hpp
+ *
+ * @brief Scaling of presented frames by the X server through RENDER picture transforms.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include <xcb/xcb.h>
+#include <xcb/render.h>
+
+#include "pixel_scale.hpp"
+
+namespace wsi
+{
+namespace x11
+{
+
+class present_backend;
+
+/**
+ * @brief Composites pixmaps at swapchain resolution into a window of another size.
+ *
+ * The source picture gets a scaling transform and filter, so the server scales while compositing and the CPU only
+ * stages frames at the resolution they were rendered at. Without the Present extension frames are composited straight
+ * into the window. With it they are composited into a ring of window sized pixmaps that are then presented, so they
+ * keep their target MSC.
+ *
+ * Not thread safe, all calls must come from the thread that presents.
+ */
+class render_scaler
+{
+public:
+   render_scaler() = default;
+   ~render_scaler();
+
+   render_scaler(const render_scaler &) = delete;
+   render_scaler &operator=(const render_scaler &) = delete;
+
+   /**
+    * @brief Whether the server has RENDER 0.10, the first version with filters, transforms and pad repeat.
+    */
+   static bool is_supported(xcb_connection_t *connection);
+
+   /**
+    * @brief Set up compositing into a window.
+    *
+    * @param backend Present extension backend presenting the scaled frames, or nullptr to composite into the window.
+    *
+    * @return false if the window's visual has no picture format.
+    */
+   bool init(xcb_connection_t *connection, xcb_window_t window, present_backend *backend);
+
+   /**
+    * @brief Scale a pixmap into the window.
+    *
+    * @param source        Pixmap holding the frame, of the window's depth.
+    * @param source_extent Size of the frame in @p source.
+    * @param placement     Where the scaled frame goes in the window.
+    * @param filter        Filter sampling the source.
+    * @param present_mode  Present mode of the frame when presenting through the Present extension.
+    *
+    * @return false if the window is gone or the connection broke.
+    */
+   bool present(xcb_pixmap_t source, VkExtent2D source_extent, const VkRect2D &placement, util::scale_filter filter,
+                VkPresentModeKHR present_mode);
+
+   /**
+    * @brief Whether present() would get its target pixmap without waiting for the server to release it.
+    */
+   bool is_next_target_idle() const;
+
+private:
+   /**
+    * @brief Window sized pixmap the frame is scaled into before being presented.
+    */
+   struct target
+   {
+      xcb_pixmap_t pixmap = XCB_PIXMAP_NONE;
+      xcb_render_picture_t picture = XCB_NONE;
+      uint16_t width = 0;
+      uint16_t height = 0;
+   };
+
+   static constexpr uint32_t TARGET_COUNT = 3;
+
+   void destroy_target(target &t);
+   void ensure_target(target &t, uint16_t width, uint16_t height);
+
+   xcb_connection_t *m_connection = nullptr;
+   xcb_window_t m_window = XCB_NONE;
+   present_backend *m_backend = nullptr;
+   xcb_render_pictformat_t m_format = XCB_NONE;
+   uint8_t m_depth = 0;
+
+   /* Picture of the window itself, only used without the Present extension. */
+   xcb_render_picture_t m_window_picture = XCB_NONE;
+
+   target m_targets[TARGET_COUNT];
+   uint32_t m_next_target = 0;
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
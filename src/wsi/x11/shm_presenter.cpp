@@ -29,26 +29,23 @@
  */
 
 #include "shm_presenter.hpp"
+#include "copy_worker_pool.hpp"
+#include "present_damage.hpp"
 #include "surface.hpp"
 #include "swapchain.hpp"
 #include "utils/logging.hpp"
+#include "pixel_copy.hpp"
 
-#include <sys/shm.h>
-#include <sys/ipc.h>
 #include <unistd.h>
+#include <cstdlib>
 #include <cstring>
 #include <algorithm>
 #include <thread>
-#include <future>
 #include <vector>
 #include <chrono>
 #include <cmath>
-#ifdef ENABLE_ARM_NEON
-#include <arm_neon.h>
-#endif
-#include <X11/Xlib.h>
-#include <X11/extensions/Xrandr.h>
 #include <xcb/sync.h>
+#include <xcb/xcbext.h>
 
 namespace wsi
 {
@@ -56,794 +53,969 @@ namespace x11
 {
 
 static constexpr uint32_t THREADING_PIXEL_THRESHOLD = 400 * 400;
-static constexpr uint32_t MAX_WORKER_THREADS = 8u;
-static constexpr uint32_t SIMD_VECTOR_SIZE = 4;
-static constexpr uint32_t LOOP_UNROLL_BOUNDARY = 3;
-static constexpr int SHM_PERMISSIONS = 0666;
+static constexpr uint32_t BANDS_PER_THREAD = 4u;
+static constexpr uint32_t MIN_BAND_ROWS = 16u;
 static constexpr uint32_t GC_COLOR_MASK = XCB_GC_BACKGROUND | XCB_GC_FOREGROUND;
 
-shm_presenter::shm_presenter()
-   : m_sync_pending(false)
-   , m_frame_interval(std::chrono::microseconds(16667))
-   , m_refresh_rate_hz(60.0)
+/* Rates outside these bounds are taken as bogus mode timings. */
+static constexpr double MIN_REFRESH_RATE_HZ = 24.0;
+static constexpr double MAX_REFRESH_RATE_HZ = 500.0;
+static constexpr double DEFAULT_REFRESH_RATE_HZ = 60.0;
+static constexpr long DEFAULT_HIDDEN_FPS = 10;
+/* Smaller differences are rounding of the same mode, not a move to another output. */
+static constexpr double REFRESH_RATE_CHANGE_HZ = 0.5;
+/* How often the server's events are checked when waiting for them, with and without a private connection. */
+static constexpr std::chrono::milliseconds EVENT_POLL_INTERVAL(1);
+static constexpr std::chrono::milliseconds PRIVATE_EVENT_POLL_INTERVAL(4);
+
+/**
+ * @brief Where a rectangle of a @p width x @p height image ends up once the image is rotated.
+ */
+static VkRect2D rotate_rect(const VkRect2D &rect, util::pixel_rotation rotation, uint32_t width, uint32_t height)
 {
+   const int32_t right_gap = static_cast<int32_t>(width) - rect.offset.x - static_cast<int32_t>(rect.extent.width);
+   const int32_t bottom_gap = static_cast<int32_t>(height) - rect.offset.y - static_cast<int32_t>(rect.extent.height);
+   const VkExtent2D swapped = { rect.extent.height, rect.extent.width };
+
+   switch (rotation)
+   {
+   case util::pixel_rotation::rotate_90:
+      return { { bottom_gap, rect.offset.x }, swapped };
+   case util::pixel_rotation::rotate_180:
+      return { { right_gap, bottom_gap }, rect.extent };
+   case util::pixel_rotation::rotate_270:
+      return { { rect.offset.y, right_gap }, swapped };
+   case util::pixel_rotation::none:
+   default:
+      return rect;
+   }
 }
 
-shm_presenter::~shm_presenter()
+/**
+ * @brief Run @p band over @p rows rows, spread over the copy worker pool when the job is big enough.
+ */
+template <typename F>
+static void run_in_bands(uint32_t rows, uint32_t pixels, F &band)
 {
-   if (m_sync_pending)
+   if (pixels > THREADING_PIXEL_THRESHOLD)
    {
-      ensure_sync_completion();
+      copy_worker_pool &pool = copy_worker_pool::get();
+
+      /* Several bands per thread so a descheduled worker's rows get picked up by the others. */
+      const uint32_t band_rows = std::max(rows / (pool.concurrency() * BANDS_PER_THREAD), MIN_BAND_ROWS);
+      if (pool.run(rows, band_rows, band))
+      {
+         return;
+      }
    }
-   cleanup_fence_sync();
+
+   band(0, rows);
 }
 
-bool shm_presenter::is_aligned(const void *ptr, size_t alignment)
+/**
+ * @brief Offset of an image of @p image_size in a window of @p window_size along one axis.
+ */
+static int32_t gravity_offset(VkPresentGravityFlagsEXT gravity, uint32_t window_size, uint32_t image_size)
 {
-   return (reinterpret_cast<uintptr_t>(ptr) & (alignment - 1)) == 0;
+   const int32_t free_space = static_cast<int32_t>(window_size) - static_cast<int32_t>(image_size);
+   if (gravity & VK_PRESENT_GRAVITY_MAX_BIT_EXT)
+   {
+      return free_space;
+   }
+   else if (gravity & VK_PRESENT_GRAVITY_CENTERED_BIT_EXT)
+   {
+      return free_space / 2;
+   }
+   return 0;
 }
 
-#ifdef ENABLE_ARM_NEON
-bool shm_presenter::are_pointers_neon_aligned(const void *src, void *dst)
+shm_presenter::shm_presenter()
+   : m_frame_interval(std::chrono::microseconds(16667))
+   , m_refresh_rate_hz(DEFAULT_REFRESH_RATE_HZ)
 {
-   constexpr size_t NEON_ALIGNMENT = 16;
-   return is_aligned(src, NEON_ALIGNMENT) && is_aligned(dst, NEON_ALIGNMENT);
 }
-#endif
 
-double shm_presenter::get_window_refresh_rate()
+shm_presenter::~shm_presenter()
 {
-   double detected_refresh_rate = 60.0;
-   bool found_refresh_rate = false;
-
-   Display *display = XOpenDisplay(nullptr);
-   if (!display)
+   if (m_geometry_pending)
    {
-      WSI_LOG_WARNING("Failed to open X11 display, using 60Hz default");
-      return detected_refresh_rate;
+      xcb_discard_reply(m_connection, m_geometry_cookie.sequence);
    }
-
-   Window root = DefaultRootWindow(display);
-
-   int event_base, error_base;
-   if (XRRQueryExtension(display, &event_base, &error_base))
+   if (m_position_pending)
    {
-      XRRScreenResources *resources = XRRGetScreenResources(display, root);
-      if (resources)
-      {
-         int active_crtc_count = 0;
-         for (int i = 0; i < resources->ncrtc; i++)
-         {
-            XRRCrtcInfo *crtc_info = XRRGetCrtcInfo(display, resources, resources->crtcs[i]);
-            if (crtc_info && crtc_info->mode != None && crtc_info->noutput > 0)
-            {
-               active_crtc_count++;
-            }
-            if (crtc_info)
-               XRRFreeCrtcInfo(crtc_info);
-         }
-
-         bool single_screen = (active_crtc_count == 1);
-
-         int window_x = 0, window_y = 0;
-
-         if (!single_screen)
-         {
-            xcb_screen_t *screen = xcb_setup_roots_iterator(xcb_get_setup(m_connection)).data;
-            xcb_window_t root_window = screen->root;
-
-            xcb_translate_coordinates_cookie_t translate_cookie =
-               xcb_translate_coordinates(m_connection, m_window, root_window, 0, 0);
-            xcb_translate_coordinates_reply_t *translate_reply =
-               xcb_translate_coordinates_reply(m_connection, translate_cookie, nullptr);
-
-            if (translate_reply)
-            {
-               window_x = translate_reply->dst_x;
-               window_y = translate_reply->dst_y;
-               free(translate_reply);
-            }
-         }
-
-         for (int i = 0; i < resources->ncrtc; i++)
-         {
-            XRRCrtcInfo *crtc_info = XRRGetCrtcInfo(display, resources, resources->crtcs[i]);
-            if (crtc_info && crtc_info->mode != None && crtc_info->noutput > 0)
-            {
-               bool window_on_crtc = false;
-
-               if (single_screen)
-               {
-                  window_on_crtc = true;
-               }
-               else
-               {
-                  window_on_crtc = (window_x >= crtc_info->x && window_x < crtc_info->x + (int)crtc_info->width &&
-                                    window_y >= crtc_info->y && window_y < crtc_info->y + (int)crtc_info->height);
-               }
-
-               for (int j = 0; j < resources->nmode; j++)
-               {
-                  XRRModeInfo *mode = &resources->modes[j];
-                  if (mode->id == crtc_info->mode)
-                  {
-                     double refresh = (double)mode->dotClock / ((double)mode->hTotal * (double)mode->vTotal);
-
-                     if (window_on_crtc)
-                     {
-                        detected_refresh_rate = refresh;
-                        found_refresh_rate = true;
-                        break;
-                     }
-                     else if (!found_refresh_rate)
-                     {
-                        detected_refresh_rate = refresh;
-                        found_refresh_rate = true;
-                     }
-                     break;
-                  }
-               }
-
-               if (crtc_info)
-                  XRRFreeCrtcInfo(crtc_info);
-               if (found_refresh_rate && window_on_crtc)
-                  break;
-            }
-         }
+      xcb_discard_reply(m_connection, m_position_cookie.sequence);
+   }
+}
 
-         XRRFreeScreenResources(resources);
-      }
-      else
+void shm_presenter::update_refresh_rate(uint32_t width, uint32_t height)
+{
+   if (m_position_pending)
+   {
+      xcb_translate_coordinates_reply_t *position =
+         xcb_translate_coordinates_reply(m_connection, m_position_cookie, nullptr);
+      if (position != nullptr)
       {
-         WSI_LOG_WARNING("Failed to get XRandR screen resources");
+         m_window_x = position->dst_x;
+         m_window_y = position->dst_y;
+         free(position);
       }
+      m_position_pending = false;
    }
-   else
+
+   /* Like the window size, the position of the next present is collected without waiting for it. */
+   m_position_cookie = xcb_translate_coordinates(m_connection, m_window, m_root, 0, 0);
+   m_position_pending = true;
+
+   double refresh_rate = m_wsi_surface->get_output_model().get_refresh_rate(m_window_x, m_window_y, width, height);
+   if (refresh_rate < MIN_REFRESH_RATE_HZ || refresh_rate > MAX_REFRESH_RATE_HZ)
    {
-      WSI_LOG_WARNING("XRandR extension not available");
+      refresh_rate = DEFAULT_REFRESH_RATE_HZ;
    }
 
-   XCloseDisplay(display);
-
-   if (!found_refresh_rate)
+   if (std::abs(refresh_rate - m_refresh_rate_hz) >= REFRESH_RATE_CHANGE_HZ)
    {
-      WSI_LOG_WARNING("Could not detect refresh rate, using 60Hz default");
+      WSI_LOG_INFO("Pacing presentation at %.2f Hz", refresh_rate);
+      m_refresh_rate_hz = refresh_rate;
+      m_frame_interval = std::chrono::microseconds(static_cast<long>(1000000.0 / refresh_rate));
    }
+}
 
-   // Reasonable bounds for display refresh rates
-   if (detected_refresh_rate < 30.0 || detected_refresh_rate > 240.0)
+void shm_presenter::copy_pixels_threaded(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
+                                         uint32_t dst_width, uint32_t height)
+{
+   if (!src_pixels || !dst_pixels || dst_width == 0 || height == 0)
    {
-      WSI_LOG_WARNING("Detected refresh rate %.2f Hz seems invalid, using 60Hz", detected_refresh_rate);
-      detected_refresh_rate = 60.0;
+      return;
    }
 
-   return detected_refresh_rate;
+   auto copy_band = [&](uint32_t begin_row, uint32_t end_row) {
+      copy_pixels_optimized_single_thread(src_pixels + (begin_row * src_stride_pixels),
+                                          dst_pixels + (begin_row * dst_width), src_stride_pixels, dst_width,
+                                          end_row - begin_row);
+   };
+
+   run_in_bands(height, dst_width * height, copy_band);
 }
 
-void shm_presenter::detect_refresh_rate()
+void shm_presenter::copy_pixels_optimized_single_thread(const uint32_t *src_pixels, uint32_t *dst_pixels,
+                                                        uint32_t src_stride_pixels, uint32_t dst_width, uint32_t height)
 {
-   double detected_refresh_rate = get_window_refresh_rate();
+   /* Nobody on this side reads the SHM segment back, only the X server. */
+   util::copy_pixel_rows(dst_pixels, dst_width * sizeof(uint32_t), src_pixels, src_stride_pixels * sizeof(uint32_t),
+                         dst_width * sizeof(uint32_t), height, util::copy_destination::write_only);
+}
 
-   m_refresh_rate_hz = detected_refresh_rate;
-   auto interval_us = static_cast<long>(1000000.0 / detected_refresh_rate);
-   m_frame_interval = std::chrono::microseconds(interval_us);
+void shm_presenter::copy_pixels_optimized(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
+                                          uint32_t dst_width, uint32_t height)
+{
+   copy_pixels_threaded(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
 }
 
-void shm_presenter::precompute_scaling_lut(uint32_t gpu_width, uint32_t display_width)
+void shm_presenter::collect_damage(const x11_image_data *image_data, const char *src_base, size_t src_stride,
+                                   const VkRect2D *damage_rects, uint32_t damage_rect_count, damage_region &damage)
 {
-   if (m_last_gpu_width == gpu_width && m_last_display_width == display_width)
+   if (damage_rect_count > 0 && !m_force_full_damage)
    {
-      return;
+      for (uint32_t i = 0; i < damage_rect_count; i++)
+      {
+         damage.add(damage_rects[i]);
+      }
+      /* Hashes of skipped frames are stale. */
+      m_tile_detector.reset();
+   }
+   else if (m_tile_damage_enabled)
+   {
+      m_tile_detector.detect(reinterpret_cast<const uint8_t *>(src_base), src_stride, image_data->width,
+                             image_data->height, sizeof(uint32_t), damage);
+   }
+   else
+   {
+      damage.set_full();
    }
 
-   m_scaling_lut.reserve(display_width);
-   m_scaling_lut.resize(display_width);
-
-   for (uint32_t dst_x = 0; dst_x < display_width; dst_x++)
+   if (m_force_full_damage)
    {
-      uint32_t src_x = (dst_x * gpu_width) / display_width;
-      if (src_x >= gpu_width)
-         src_x = gpu_width - 1;
-      m_scaling_lut[dst_x] = src_x;
+      /* Nothing of ours is in the window yet. */
+      damage.set_full();
+      m_force_full_damage = false;
    }
 
-   m_last_gpu_width = gpu_width;
-   m_last_display_width = display_width;
+   damage.optimize();
 }
 
-#ifdef ENABLE_ARM_NEON
-void shm_presenter::copy_pixels_simd(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
-                                     uint32_t dst_width, uint32_t height)
+void shm_presenter::transfer_rect(const char *src_base, size_t src_stride, char *dst_base, size_t dst_stride,
+                                  const VkRect2D &rect)
 {
-   if (m_scaling_lut.empty() || m_scaling_lut[dst_width - 1] == dst_width - 1)
-   {
-      for (uint32_t row = 0; row < height; row++)
+   const size_t dst_bytes_per_pixel = m_pixel_converter.get_dst_bytes_per_pixel();
+   const size_t row_bytes = rect.extent.width * sizeof(uint32_t);
+   const char *src = src_base + rect.offset.y * src_stride + rect.offset.x * sizeof(uint32_t);
+   char *dst = dst_base + rect.offset.y * dst_stride + rect.offset.x * dst_bytes_per_pixel;
+
+   const util::copy_destination destination = row_bytes * rect.extent.height >= util::STREAMING_COPY_MIN_BYTES ?
+                                                 util::copy_destination::write_only :
+                                                 util::copy_destination::cached;
+
+   auto copy_band = [&](uint32_t begin_row, uint32_t end_row) {
+      if (m_pixel_converter.is_copy())
       {
-         const uint32_t *src_row = src_pixels + (row * src_stride_pixels);
-         uint32_t *dst_row = dst_pixels + (row * dst_width);
+         util::copy_pixel_rows(dst + begin_row * dst_stride, dst_stride, src + begin_row * src_stride, src_stride,
+                               row_bytes, end_row - begin_row, destination);
+      }
+      else
+      {
+         m_pixel_converter.convert_rows(dst + begin_row * dst_stride, dst_stride, src + begin_row * src_stride,
+                                        src_stride, rect.extent.width, end_row - begin_row, rect.offset.x,
+                                        rect.offset.y + begin_row);
+      }
+   };
 
-         uint32_t x = 0;
-         bool use_aligned_simd = are_pointers_neon_aligned(&src_row[0], &dst_row[0]);
+   run_in_bands(rect.extent.height, rect.extent.width * rect.extent.height, copy_band);
+}
 
-         if (use_aligned_simd)
-         {
-            for (; x + LOOP_UNROLL_BOUNDARY < dst_width; x += SIMD_VECTOR_SIZE)
-            {
-               uint32x4_t pixels = vld1q_u32(&src_row[x]);
-               vst1q_u32(&dst_row[x], pixels);
-            }
-         }
-         else
-         {
-            for (; x + LOOP_UNROLL_BOUNDARY < dst_width; x += SIMD_VECTOR_SIZE)
-            {
-               uint8x16_t bytes = vld1q_u8(reinterpret_cast<const uint8_t *>(&src_row[x]));
-               vst1q_u8(reinterpret_cast<uint8_t *>(&dst_row[x]), bytes);
-            }
-         }
+void shm_presenter::transfer_rotated_rect(const x11_image_data *image_data, const char *src_base, size_t src_stride,
+                                          char *dst_base, size_t dst_stride, const VkRect2D &rect)
+{
+   const size_t dst_bytes_per_pixel = m_pixel_converter.get_dst_bytes_per_pixel();
+   char *dst = dst_base + rect.offset.y * dst_stride + rect.offset.x * dst_bytes_per_pixel;
 
-         for (; x < dst_width; x++)
-         {
-            dst_row[x] = src_row[x];
-         }
+   auto rotate_band = [&](uint32_t begin_row, uint32_t end_row) {
+      const uint32_t rows = end_row - begin_row;
+      if (m_pixel_converter.is_copy())
+      {
+         util::rotate_pixels(dst + begin_row * dst_stride, dst_stride, src_base, src_stride, image_data->width,
+                             image_data->height, m_rotation, rect.offset.x, rect.offset.y + begin_row,
+                             rect.extent.width, rows);
+         return;
       }
-   }
-   else
+
+      /* The conversion kernels walk rows, so the band is rotated into scratch memory first. */
+      thread_local std::vector<uint32_t> rotated_band;
+      const size_t rotated_stride = rect.extent.width * sizeof(uint32_t);
+      rotated_band.resize(static_cast<size_t>(rect.extent.width) * rows);
+      util::rotate_pixels(rotated_band.data(), rotated_stride, src_base, src_stride, image_data->width,
+                          image_data->height, m_rotation, rect.offset.x, rect.offset.y + begin_row, rect.extent.width,
+                          rows);
+      m_pixel_converter.convert_rows(dst + begin_row * dst_stride, dst_stride, rotated_band.data(), rotated_stride,
+                                     rect.extent.width, rows, rect.offset.x, rect.offset.y + begin_row);
+   };
+
+   run_in_bands(rect.extent.height, rect.extent.width * rect.extent.height, rotate_band);
+}
+
+void shm_presenter::cache_x11_formats()
+{
+   const xcb_setup_t *setup = xcb_get_setup(m_connection);
+   xcb_format_iterator_t format_iter = xcb_setup_pixmap_formats_iterator(setup);
+
+   for (; format_iter.rem; xcb_format_next(&format_iter))
    {
-      copy_pixels_scalar(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
+      xcb_format_t *format = format_iter.data;
+      m_depth_to_bpp_cache[format->depth] = format->bits_per_pixel;
+      m_depth_to_scanline_pad_cache[format->depth] = format->scanline_pad;
    }
 }
-#endif
 
-void shm_presenter::copy_pixels_scalar(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
-                                       uint32_t dst_width, uint32_t height)
+uint8_t shm_presenter::get_bits_per_pixel_for_depth(int depth)
 {
-   uint32_t src_width = src_stride_pixels;
+   auto it = m_depth_to_bpp_cache.find(depth);
+   if (it != m_depth_to_bpp_cache.end())
+   {
+      return it->second;
+   }
 
-   if (src_width == dst_width &&
-       (m_scaling_lut.empty() || (dst_width > 0 && m_scaling_lut[dst_width - 1] == dst_width - 1)))
+   return (depth == 24) ? 32 : depth;
+}
+
+uint8_t shm_presenter::get_scanline_pad_for_depth(int depth)
+{
+   auto it = m_depth_to_scanline_pad_cache.find(depth);
+   if (it != m_depth_to_scanline_pad_cache.end() && it->second >= 8)
    {
-      size_t copy_size = dst_width * sizeof(uint32_t);
-      for (uint32_t row = 0; row < height; row++)
-      {
-         const uint32_t *src_row = src_pixels + (row * src_stride_pixels);
-         uint32_t *dst_row = dst_pixels + (row * dst_width);
+      return it->second;
+   }
 
-         if (row + 1 < height)
-         {
-            __builtin_prefetch(src_row + src_stride_pixels, 0, 3);
-         }
+   return 32;
+}
 
-         memcpy(dst_row, src_row, copy_size);
-      }
+void shm_presenter::configure_pixel_format(VkFormat image_format)
+{
+   const bool rgba_source = image_format == VK_FORMAT_R8G8B8A8_UNORM || image_format == VK_FORMAT_R8G8B8A8_SRGB;
+   const util::pixel_layout src_layout = rgba_source ? util::PIXEL_LAYOUT_RGBA8888 : util::PIXEL_LAYOUT_BGRA8888;
+
+   /* Plain copy unless the window's visual says otherwise. */
+   m_pixel_converter.configure(src_layout, src_layout, false);
+
+   uint32_t width, height;
+   int depth = 0;
+   xcb_visualtype_t visual;
+   if (!m_wsi_surface->get_size_and_depth(&width, &height, &depth) || !m_wsi_surface->get_visual(&visual))
+   {
+      WSI_LOG_WARNING("Could not query the window visual, presenting without pixel conversion");
       return;
    }
 
-   for (uint32_t row = 0; row < height; row++)
+   if (xcb_get_setup(m_connection)->image_byte_order != XCB_IMAGE_ORDER_LSB_FIRST)
    {
-      const uint32_t *src_row = src_pixels + (row * src_stride_pixels);
-      uint32_t *dst_row = dst_pixels + (row * dst_width);
+      WSI_LOG_WARNING("MSB first X server image byte order is not supported, colours will be wrong");
+      return;
+   }
 
-      if (row + 1 < height)
-      {
-         __builtin_prefetch(src_row + src_stride_pixels, 0, 3);
-      }
+   const char *dither_env = std::getenv("MALI_WRAPPER_X11_DITHER");
+   const bool dither = dither_env == nullptr || std::strcmp(dither_env, "0") != 0;
 
-      uint32_t dst_x = 0;
-      for (; dst_x + LOOP_UNROLL_BOUNDARY < dst_width; dst_x += SIMD_VECTOR_SIZE)
-      {
-         dst_row[dst_x] = src_row[m_scaling_lut[dst_x]];
-         dst_row[dst_x + 1] = src_row[m_scaling_lut[dst_x + 1]];
-         dst_row[dst_x + 2] = src_row[m_scaling_lut[dst_x + 2]];
-         dst_row[dst_x + 3] = src_row[m_scaling_lut[dst_x + 3]];
-      }
+   util::pixel_layout dst_layout;
+   if (!util::pixel_layout::from_masks(get_bits_per_pixel_for_depth(depth), visual.red_mask, visual.green_mask,
+                                       visual.blue_mask, &dst_layout) ||
+       !m_pixel_converter.configure(src_layout, dst_layout, dither))
+   {
+      WSI_LOG_WARNING("Unsupported X visual (depth %d, masks 0x%x 0x%x 0x%x), presenting without pixel conversion",
+                      depth, visual.red_mask, visual.green_mask, visual.blue_mask);
+      return;
+   }
 
-      for (; dst_x < dst_width; dst_x++)
-      {
-         dst_row[dst_x] = src_row[m_scaling_lut[dst_x]];
-      }
+   if (!m_pixel_converter.is_copy())
+   {
+      WSI_LOG_INFO("Converting presented images for depth %d visual (masks 0x%x 0x%x 0x%x)", depth, visual.red_mask,
+                   visual.green_mask, visual.blue_mask);
    }
 }
 
-void shm_presenter::copy_pixels_threaded(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
-                                         uint32_t dst_width, uint32_t height)
+VkResult shm_presenter::init(xcb_connection_t *connection, xcb_window_t window, surface *wsi_surface,
+                             VkFormat image_format)
 {
-   if (!src_pixels || !dst_pixels || dst_width == 0 || height == 0)
+   m_connection = connection;
+   m_window = window;
+   m_wsi_surface = wsi_surface;
+   m_root = xcb_setup_roots_iterator(xcb_get_setup(m_connection)).data->root;
+
+   /* Pace the first frames at the rate of the output under the window's origin. */
+   m_position_cookie = xcb_translate_coordinates(m_connection, m_window, m_root, 0, 0);
+   m_position_pending = true;
+   update_refresh_rate(1, 1);
+
+   /* Over the socket every byte counts, so changed tiles are detected unless turned off explicitly. */
+   m_socket_upload = !m_wsi_surface->has_shm();
+   const char *tile_damage_env = std::getenv("MALI_WRAPPER_X11_TILE_DAMAGE");
+   m_tile_damage_enabled = tile_damage_env != nullptr ? std::strcmp(tile_damage_env, "0") != 0 : m_socket_upload;
+
+   const char *hidden_fps_env = std::getenv("MALI_WRAPPER_X11_HIDDEN_FPS");
+   long hidden_fps = hidden_fps_env != nullptr ? std::strtol(hidden_fps_env, nullptr, 10) : DEFAULT_HIDDEN_FPS;
+   hidden_fps = std::clamp(hidden_fps, 1L, 1000L);
+   m_hidden_frame_interval = std::chrono::microseconds(1000000 / hidden_fps);
+
+   cache_x11_formats();
+   configure_pixel_format(image_format);
+
+   VkResult result = create_graphics_context();
+   if (result != VK_SUCCESS)
    {
-      return;
+      WSI_LOG_ERROR("Failed to create graphics context for SHM presentation");
+      return result;
    }
 
-   const uint32_t total_pixels = dst_width * height;
+   if (m_socket_upload)
+   {
+      m_uploader.init(m_connection, m_window, m_gc);
+      return VK_SUCCESS;
+   }
 
-   if (total_pixels > THREADING_PIXEL_THRESHOLD)
+   const char *present_env = std::getenv("MALI_WRAPPER_X11_PRESENT");
+   if ((present_env == nullptr || std::strcmp(present_env, "0") != 0) && present_backend::is_supported(m_connection))
    {
-      const uint32_t num_threads = std::min(std::thread::hardware_concurrency(), MAX_WORKER_THREADS);
-      if (num_threads > 1)
+      m_present_backend = std::make_unique<present_backend>();
+      if (m_present_backend->init(m_connection, m_window) != VK_SUCCESS)
       {
-         const uint32_t rows_per_thread = height / num_threads;
-         std::vector<std::future<void>> futures;
-         futures.reserve(num_threads);
+         WSI_LOG_WARNING("Present extension unusable, falling back to timed SHM puts");
+         m_present_backend.reset();
+      }
+   }
 
-         try
-         {
-            for (uint32_t t = 0; t < num_threads; t++)
-            {
-               uint32_t start_row = t * rows_per_thread;
-               uint32_t end_row = (t == num_threads - 1) ? height : (t + 1) * rows_per_thread;
-
-               if (start_row >= height)
-                  break;
-               if (end_row > height)
-                  end_row = height;
-
-               futures.emplace_back(std::async(std::launch::async, [=]() {
-                  try
-                  {
-                     const uint32_t *thread_src = src_pixels + (start_row * src_stride_pixels);
-                     uint32_t *thread_dst = dst_pixels + (start_row * dst_width);
-                     uint32_t thread_height = end_row - start_row;
-
-                     if (thread_height > 0)
-                     {
-#ifdef ENABLE_ARM_NEON
-                        copy_pixels_simd(thread_src, thread_dst, src_stride_pixels, dst_width, thread_height);
-#else
-                        copy_pixels_scalar(thread_src, thread_dst, src_stride_pixels, dst_width, thread_height);
-#endif
-                     }
-                  }
-                  catch (const std::exception &e)
-                  {
-                     WSI_LOG_ERROR("Thread pixel copy failed with exception: %s", e.what());
-                     m_thread_error_occurred.store(true, std::memory_order_release);
-                  }
-                  catch (...)
-                  {
-                     WSI_LOG_ERROR("Thread pixel copy failed with unknown exception");
-                     m_thread_error_occurred.store(true, std::memory_order_release);
-                  }
-               }));
-            }
-
-            for (auto &future : futures)
-            {
-               if (future.valid())
-               {
-                  future.wait();
-               }
-            }
-
-            if (m_thread_error_occurred.load(std::memory_order_acquire))
-            {
-               std::lock_guard<std::mutex> lock(m_error_recovery_mutex);
-               WSI_LOG_ERROR("Thread errors detected, falling back to single-threaded processing");
-               m_thread_error_occurred.store(false, std::memory_order_release);
-               copy_pixels_optimized_single_thread(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
-            }
-         }
-         catch (...)
+   const char *scale_env = std::getenv("MALI_WRAPPER_X11_SERVER_SCALING");
+   if (scale_env != nullptr && std::strcmp(scale_env, "0") != 0)
+   {
+      if (render_scaler::is_supported(m_connection))
+      {
+         m_render_scaler = std::make_unique<render_scaler>();
+         if (!m_render_scaler->init(m_connection, m_window, m_present_backend.get()))
          {
-            std::lock_guard<std::mutex> lock(m_error_recovery_mutex);
-            WSI_LOG_ERROR("Threading setup failed, falling back to single-threaded processing");
-            copy_pixels_optimized_single_thread(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
+            m_render_scaler.reset();
          }
-         return;
+      }
+      if (m_render_scaler == nullptr)
+      {
+         WSI_LOG_WARNING("RENDER scaling unavailable, scaling frames on the CPU");
       }
    }
 
-   copy_pixels_optimized_single_thread(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
-}
+   m_staging.init(m_connection, m_window, m_present_backend.get(), &m_wsi_surface->get_shm_pool(),
+                  m_render_scaler != nullptr);
 
-void shm_presenter::copy_pixels_optimized_single_thread(const uint32_t *src_pixels, uint32_t *dst_pixels,
-                                                        uint32_t src_stride_pixels, uint32_t dst_width, uint32_t height)
-{
-#ifdef ENABLE_ARM_NEON
-   copy_pixels_simd(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
-#else
-   copy_pixels_scalar(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
-#endif
+   return VK_SUCCESS;
 }
 
-void shm_presenter::copy_pixels_optimized(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
-                                          uint32_t dst_width, uint32_t height)
+uint64_t shm_presenter::get_refresh_duration_ns() const
 {
-   if (src_stride_pixels == dst_width && m_scaling_lut.empty())
+   if (m_throttled)
    {
-      const size_t copy_size = dst_width * height * sizeof(uint32_t);
-      std::memcpy(dst_pixels, src_pixels, copy_size);
-      return;
+      return static_cast<uint64_t>(m_hidden_frame_interval.count()) * 1000;
    }
-
-   copy_pixels_threaded(src_pixels, dst_pixels, src_stride_pixels, dst_width, height);
-}
-
-void shm_presenter::start_async_sync()
-{
-   if (m_sync_pending)
+   if (m_present_backend != nullptr && m_present_backend->get_refresh_duration_ns() != 0)
    {
-      return;
+      return m_present_backend->get_refresh_duration_ns();
    }
-
-   m_pending_sync_cookie = xcb_get_geometry(m_connection, m_window);
-   m_sync_pending = true;
+   return static_cast<uint64_t>(m_frame_interval.count()) * 1000;
 }
 
-bool shm_presenter::check_pending_sync()
+VkResult shm_presenter::create_image_resources(x11_image_data *image_data, uint32_t width, uint32_t height, int depth)
 {
-   if (!m_sync_pending)
+   image_data->width = width;
+   image_data->height = height;
+   image_data->depth = depth;
+
+   if (image_data->zero_copy)
    {
-      return true;
+      /* The segment already backs the image, so its layout is whatever the driver chose. */
+      const auto &layout = image_data->external_mem.get_host_layout();
+      image_data->stride = layout.rowPitch;
+      if (m_present_backend != nullptr)
+      {
+         image_data->shm_pixmap = m_present_backend->create_pixmap(
+            image_data->shm_seg, static_cast<uint32_t>(layout.offset),
+            static_cast<uint16_t>(image_data->stride / sizeof(uint32_t)), height, depth);
+      }
+      return VK_SUCCESS;
    }
 
-   xcb_generic_error_t *error = nullptr;
-   xcb_get_geometry_reply_t *sync_reply = xcb_get_geometry_reply(m_connection, m_pending_sync_cookie, &error);
+   /* Rows are padded to the scanline pad of the depth's pixmap format. */
+   const VkExtent2D extent = get_display_extent(image_data);
+   const uint32_t bits_per_pixel = get_bits_per_pixel_for_depth(depth);
+   const uint32_t scanline_pad = get_scanline_pad_for_depth(depth);
+   image_data->stride = (extent.width * bits_per_pixel + scanline_pad - 1) / scanline_pad * (scanline_pad / 8);
 
-   if (sync_reply)
-   {
-      free(sync_reply);
-      m_sync_pending = false;
-      return true;
-   }
-   else if (error)
+   /* Frames are copied into the presenter's staging ring rather than memory of the image's own. */
+   if (!m_socket_upload && !m_staging.reserve(static_cast<size_t>(image_data->stride) * extent.height, extent.width,
+                                              extent.height, depth))
    {
-      free(error);
-      m_sync_pending = false;
-      return false;
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
    }
 
-   return false;
+   return VK_SUCCESS;
 }
 
-void shm_presenter::ensure_sync_completion()
+VkResult shm_presenter::create_zero_copy_segment(x11_image_data *image_data, size_t size, size_t alignment)
 {
-   if (!m_sync_pending)
+   /* Left unsynced, the first present covers the segments of every image with one round trip. */
+   shm_segment segment;
+   if (!m_wsi_surface->get_shm_pool().acquire(size, alignment, segment))
    {
-      return;
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
    }
 
-   xcb_generic_error_t *error = nullptr;
-   xcb_get_geometry_reply_t *sync_reply = xcb_get_geometry_reply(m_connection, m_pending_sync_cookie, &error);
+   image_data->shm_seg = segment.seg;
+   image_data->shm_addr = segment.addr;
+   image_data->shm_size = segment.size;
 
-   if (sync_reply)
-   {
-      free(sync_reply);
-   }
-   else if (error)
+   return VK_SUCCESS;
+}
+
+void shm_presenter::set_pre_transform(VkSurfaceTransformFlagBitsKHR pre_transform)
+{
+   /* The image was rotated clockwise by pre_transform, the window gets it rotated back. */
+   switch (pre_transform)
    {
-      free(error);
+   case VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR:
+      m_rotation = util::pixel_rotation::rotate_270;
+      break;
+   case VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR:
+      m_rotation = util::pixel_rotation::rotate_180;
+      break;
+   case VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR:
+      m_rotation = util::pixel_rotation::rotate_90;
+      break;
+   default:
+      m_rotation = util::pixel_rotation::none;
+      break;
    }
-
-   m_sync_pending = false;
 }
 
-bool shm_presenter::init_fence_sync()
+VkExtent2D shm_presenter::get_display_extent(const x11_image_data *image_data) const
 {
-   if (m_fence_available)
+   if (util::rotation_swaps_extent(m_rotation))
    {
-      return true;
+      return { image_data->height, image_data->width };
    }
+   return { image_data->width, image_data->height };
+}
+
+void shm_presenter::set_present_scaling(VkPresentScalingFlagsEXT scaling_behavior, VkPresentGravityFlagsEXT gravity_x,
+                                        VkPresentGravityFlagsEXT gravity_y)
+{
+   m_scaling_behavior = scaling_behavior;
+   m_gravity_x = gravity_x;
+   m_gravity_y = gravity_y;
 
-   const xcb_query_extension_reply_t *sync_ext = xcb_get_extension_data(m_connection, &xcb_sync_id);
-   if (!sync_ext || !sync_ext->present)
+   const char *filter_env = std::getenv("MALI_WRAPPER_X11_SCALE_FILTER");
+   m_scale_filter = filter_env != nullptr && std::strcmp(filter_env, "nearest") == 0 ? util::scale_filter::nearest :
+                                                                                      util::scale_filter::bilinear;
+
+   int depth;
+   if (!m_wsi_surface->get_size_and_depth(&m_window_width, &m_window_height, &depth))
    {
-      WSI_LOG_WARNING("XSync extension not available, falling back to geometry-based sync");
-      return false;
+      WSI_LOG_WARNING("Could not query the window size, scaling starts with the next present");
    }
+}
 
-   m_presentation_fence = xcb_generate_id(m_connection);
-   xcb_void_cookie_t fence_cookie = xcb_sync_create_fence_checked(m_connection, m_window, m_presentation_fence, 0);
-
-   xcb_generic_error_t *fence_error = xcb_request_check(m_connection, fence_cookie);
-   if (fence_error)
+void shm_presenter::update_window_size()
+{
+   if (m_geometry_pending)
    {
-      WSI_LOG_WARNING("Failed to create XSync fence: error %d, falling back to geometry-based sync",
-                      fence_error->error_code);
-      free(fence_error);
-      if (m_presentation_fence != XCB_NONE)
+      xcb_get_geometry_reply_t *geometry = xcb_get_geometry_reply(m_connection, m_geometry_cookie, nullptr);
+      if (geometry != nullptr)
       {
-         m_presentation_fence = XCB_NONE;
+         m_window_width = geometry->width;
+         m_window_height = geometry->height;
+         free(geometry);
       }
-      return false;
+      m_geometry_pending = false;
    }
 
-   int fence_flush_result = xcb_flush(m_connection);
-   if (fence_flush_result <= 0)
+   /* Collected by the next present, so resizes take effect a frame late instead of costing a round trip each time. */
+   m_geometry_cookie = xcb_get_geometry(m_connection, m_window);
+   m_geometry_pending = true;
+}
+
+VkRect2D shm_presenter::compute_placement(uint32_t image_width, uint32_t image_height) const
+{
+   if (m_window_width == 0 || m_window_height == 0)
    {
-      WSI_LOG_ERROR("SHM presenter xcb_flush failed: result=%d", fence_flush_result);
+      return { { 0, 0 }, { image_width, image_height } };
    }
 
-   xcb_get_input_focus_cookie_t sync_cookie = xcb_get_input_focus(m_connection);
-   xcb_get_input_focus_reply_t *sync_reply = xcb_get_input_focus_reply(m_connection, sync_cookie, nullptr);
-
-   if (sync_reply)
+   uint32_t width = image_width;
+   uint32_t height = image_height;
+   if (m_scaling_behavior & VK_PRESENT_SCALING_STRETCH_BIT_EXT)
    {
-      free(sync_reply);
-      m_fence_available = true;
-      return true;
+      width = m_window_width;
+      height = m_window_height;
    }
-   else
+   else if (m_scaling_behavior & VK_PRESENT_SCALING_ASPECT_RATIO_STRETCH_BIT_EXT)
    {
-      WSI_LOG_WARNING("Failed to synchronize XSync fence setup, falling back to geometry-based sync");
-      if (m_presentation_fence != XCB_NONE)
+      if (static_cast<uint64_t>(m_window_width) * image_height <= static_cast<uint64_t>(m_window_height) * image_width)
       {
-         xcb_sync_destroy_fence(m_connection, m_presentation_fence);
-         m_presentation_fence = XCB_NONE;
+         width = m_window_width;
+         height = std::max<uint32_t>(1, static_cast<uint64_t>(m_window_width) * image_height / image_width);
+      }
+      else
+      {
+         height = m_window_height;
+         width = std::max<uint32_t>(1, static_cast<uint64_t>(m_window_height) * image_width / image_height);
       }
-      return false;
    }
+
+   const VkOffset2D offset = { gravity_offset(m_gravity_x, m_window_width, width),
+                               gravity_offset(m_gravity_y, m_window_height, height) };
+   return { offset, { width, height } };
 }
 
-void shm_presenter::cleanup_fence_sync()
+void shm_presenter::fill_borders(const VkRect2D &placement)
 {
-   if (m_presentation_fence != XCB_NONE)
+   const int32_t window_width = static_cast<int32_t>(m_window_width);
+   const int32_t window_height = static_cast<int32_t>(m_window_height);
+   const int32_t left = std::max(placement.offset.x, 0);
+   const int32_t top = std::max(placement.offset.y, 0);
+   const int32_t right = std::min(placement.offset.x + static_cast<int32_t>(placement.extent.width), window_width);
+   const int32_t bottom = std::min(placement.offset.y + static_cast<int32_t>(placement.extent.height), window_height);
+
+   xcb_rectangle_t borders[4];
+   uint32_t border_count = 0;
+   auto add_border = [&](int32_t x, int32_t y, int32_t width, int32_t height) {
+      if (width > 0 && height > 0)
+      {
+         borders[border_count++] = { static_cast<int16_t>(x), static_cast<int16_t>(y), static_cast<uint16_t>(width),
+                                     static_cast<uint16_t>(height) };
+      }
+   };
+   add_border(0, 0, window_width, top);
+   add_border(0, bottom, window_width, window_height - bottom);
+   add_border(0, top, left, bottom - top);
+   add_border(right, top, window_width - right, bottom - top);
+
+   /* The GC foreground is pixel 0, black on TrueColor visuals. */
+   if (border_count > 0)
    {
-      xcb_sync_destroy_fence(m_connection, m_presentation_fence);
-      m_presentation_fence = XCB_NONE;
+      xcb_poly_fill_rectangle(m_connection, m_window, m_gc, border_count, borders);
    }
-   m_fence_available = false;
 }
 
-void shm_presenter::wait_for_presentation_fence()
+VkResult shm_presenter::present_scaled_on_server(x11_image_data *image_data, const char *src_base,
+                                                 size_t source_stride, VkExtent2D source_extent,
+                                                 const VkRect2D &placement)
 {
-   if (!m_fence_available || m_presentation_fence == XCB_NONE)
+   const uint32_t scanline_pad = get_scanline_pad_for_depth(image_data->depth);
+   const uint32_t bits_per_pixel = m_pixel_converter.get_dst_bytes_per_pixel() * 8;
+   const size_t dst_stride =
+      (source_extent.width * bits_per_pixel + scanline_pad - 1) / scanline_pad * (scanline_pad / 8);
+
+   staging_slot *slot = m_staging.acquire(dst_stride * source_extent.height, source_extent.width,
+                                          source_extent.height, image_data->depth);
+   if (slot == nullptr)
    {
-      return;
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
    }
 
-   xcb_sync_await_fence(m_connection, 1, &m_presentation_fence);
-   int flush_result = xcb_flush(m_connection);
-   if (flush_result <= 0)
+   char *dst_base = static_cast<char *>(slot->segment.addr);
+   const VkRect2D frame = { { 0, 0 }, source_extent };
+   if (m_rotation != util::pixel_rotation::none)
    {
-      WSI_LOG_ERROR("SHM presenter xcb_flush failed: result=%d", flush_result);
+      transfer_rotated_rect(image_data, src_base, source_stride, dst_base, dst_stride, frame);
    }
-   xcb_sync_reset_fence(m_connection, m_presentation_fence);
-   int flush_result2 = xcb_flush(m_connection);
-   if (flush_result2 <= 0)
+   else
    {
-      WSI_LOG_ERROR("SHM presenter xcb_flush failed: result=%d", flush_result2);
+      transfer_rect(src_base, source_stride, dst_base, dst_stride, frame);
    }
+
+   const bool presented =
+      m_render_scaler->present(slot->pixmap, source_extent, placement, m_scale_filter, m_present_mode);
+   m_staging.release(*slot);
+   return presented ? VK_SUCCESS : VK_ERROR_SURFACE_LOST_KHR;
 }
 
-void shm_presenter::trigger_presentation_fence()
+VkResult shm_presenter::present_scaled(x11_image_data *image_data, const char *src_base, size_t source_stride,
+                                       VkExtent2D source_extent, const VkRect2D &placement)
 {
-   if (!m_fence_available || m_presentation_fence == XCB_NONE)
+   if (m_render_scaler != nullptr)
    {
-      return;
+      return present_scaled_on_server(image_data, src_base, source_stride, source_extent, placement);
    }
 
-   xcb_sync_trigger_fence(m_connection, m_presentation_fence);
-   int trigger_flush_result = xcb_flush(m_connection);
-   if (trigger_flush_result <= 0)
+   const uint32_t dst_width = placement.extent.width;
+   const uint32_t dst_height = placement.extent.height;
+   if (!m_scaler.configure(source_extent.width, source_extent.height, dst_width, dst_height, m_scale_filter))
    {
-      WSI_LOG_ERROR("SHM presenter xcb_flush failed: result=%d", trigger_flush_result);
+      /*
+       * Only an empty image or placement gets here. The window has no pixel to show the frame in, so it completes
+       * like a frame of a hidden window and the caller sends the next one whole.
+       */
+      WSI_LOG_WARNING("Skipping frame scaled from %ux%u to an empty %ux%u placement", source_extent.width,
+                      source_extent.height, dst_width, dst_height);
+      return VK_SUCCESS;
    }
-}
 
-void shm_presenter::cache_x11_formats()
-{
-   const xcb_setup_t *setup = xcb_get_setup(m_connection);
-   xcb_format_iterator_t format_iter = xcb_setup_pixmap_formats_iterator(setup);
+   const uint32_t bits_per_pixel = m_pixel_converter.get_dst_bytes_per_pixel() * 8;
+   const uint32_t scanline_pad = get_scanline_pad_for_depth(image_data->depth);
+   const size_t dst_stride = (dst_width * bits_per_pixel + scanline_pad - 1) / scanline_pad * (scanline_pad / 8);
 
-   for (; format_iter.rem; xcb_format_next(&format_iter))
+   staging_slot *slot = nullptr;
+   char *dst_base = nullptr;
+   if (m_socket_upload)
    {
-      xcb_format_t *format = format_iter.data;
-      m_depth_to_bpp_cache[format->depth] = format->bits_per_pixel;
+      dst_base = m_uploader.map_frame(dst_stride, dst_height);
    }
-}
-
-uint8_t shm_presenter::get_bits_per_pixel_for_depth(int depth)
-{
-   auto it = m_depth_to_bpp_cache.find(depth);
-   if (it != m_depth_to_bpp_cache.end())
+   else if ((slot = m_staging.acquire(dst_stride * dst_height, dst_width, dst_height, image_data->depth)) != nullptr)
    {
-      return it->second;
+      dst_base = static_cast<char *>(slot->segment.addr);
+   }
+   if (dst_base == nullptr)
+   {
+      return VK_ERROR_OUT_OF_HOST_MEMORY;
    }
 
-   return (depth == 24) ? 32 : depth;
-}
-
-VkResult shm_presenter::init(xcb_connection_t *connection, xcb_window_t window, surface *wsi_surface)
-{
-   m_connection = connection;
-   m_window = window;
-   m_wsi_surface = wsi_surface;
+   auto scale_band = [&](uint32_t begin_row, uint32_t end_row) {
+      if (m_pixel_converter.is_copy())
+      {
+         m_scaler.scale_rows(dst_base + begin_row * dst_stride, dst_stride, src_base, source_stride, begin_row,
+                             end_row);
+         return;
+      }
 
-   detect_refresh_rate();
+      thread_local std::vector<uint32_t> scaled_row;
+      scaled_row.resize(dst_width);
+      for (uint32_t row = begin_row; row < end_row; row++)
+      {
+         m_scaler.scale_rows(scaled_row.data(), 0, src_base, source_stride, row, row + 1);
+         m_pixel_converter.convert_rows(dst_base + row * dst_stride, dst_stride, scaled_row.data(), 0, dst_width, 1, 0,
+                                        row);
+      }
+   };
 
-   cache_x11_formats();
+   run_in_bands(dst_height, dst_width * dst_height, scale_band);
 
-   VkResult result = create_graphics_context();
-   if (result != VK_SUCCESS)
+   if (m_socket_upload)
    {
-      WSI_LOG_ERROR("Failed to create graphics context for SHM presentation");
-      return result;
+      const VkRect2D update = { { 0, 0 }, placement.extent };
+      m_uploader.upload(&update, 1, placement.offset, image_data->depth, m_pixel_converter.get_dst_bytes_per_pixel(),
+                        scanline_pad);
+      return VK_SUCCESS;
    }
 
-   init_fence_sync();
+   if (m_present_backend != nullptr)
+   {
+      const VkRect2D update = { { 0, 0 }, placement.extent };
+      return m_present_backend->present(slot->pixmap, &update, 1, placement.offset, m_present_mode) ?
+                VK_SUCCESS :
+                VK_ERROR_SURFACE_LOST_KHR;
+   }
 
+   xcb_shm_put_image(m_connection, m_window, m_gc, dst_width, dst_height, 0, 0, dst_width, dst_height,
+                     placement.offset.x, placement.offset.y, image_data->depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 0,
+                     slot->segment.seg, 0);
+   m_staging.release(*slot);
    return VK_SUCCESS;
 }
 
-VkResult shm_presenter::create_image_resources(x11_image_data *image_data, uint32_t width, uint32_t height, int depth)
+VkResult shm_presenter::present_unscaled(x11_image_data *image_data, const char *src_base, size_t source_stride,
+                                         const VkRect2D *damage_rects, uint32_t damage_rect_count, VkOffset2D offset)
 {
-   image_data->width = width;
-   image_data->height = height;
-   image_data->depth = depth;
-
-   uint8_t bits_per_pixel = (depth == 24) ? 32 : depth;
-   image_data->stride = width * (bits_per_pixel / 8);
-
-   size_t shm_size = image_data->stride * height;
-   image_data->shm_size = shm_size;
+   const VkExtent2D extent = get_display_extent(image_data);
+   damage_region damage(extent.width, extent.height);
+   if (m_rotation == util::pixel_rotation::none)
+   {
+      collect_damage(image_data, src_base, source_stride, damage_rects, damage_rect_count, damage);
+   }
+   else
+   {
+      /* Regions and tile hashes are in image coordinates, the window gets the rotated image. */
+      damage_region image_damage(image_data->width, image_data->height);
+      collect_damage(image_data, src_base, source_stride, damage_rects, damage_rect_count, image_damage);
+      if (image_damage.is_full())
+      {
+         damage.set_full();
+      }
+      for (uint32_t i = 0; !image_damage.is_full() && i < image_damage.count(); i++)
+      {
+         damage.add(rotate_rect(image_damage.rect(i), m_rotation, image_data->width, image_data->height));
+      }
+      damage.optimize();
+   }
+   if (damage.is_empty())
+   {
+      return VK_SUCCESS;
+   }
 
-   image_data->shm_id = shmget(IPC_PRIVATE, shm_size, IPC_CREAT | SHM_PERMISSIONS);
-   if (image_data->shm_id < 0)
+   /* What the server is told changed, the copy below may cover more. */
+   std::vector<VkRect2D> update(damage.count());
+   for (uint32_t i = 0; i < damage.count(); i++)
    {
-      WSI_LOG_ERROR("Failed to create shared memory segment of size %zu", shm_size);
-      return VK_ERROR_OUT_OF_HOST_MEMORY;
+      update[i] = damage.rect(i);
    }
 
-   image_data->shm_addr = shmat(image_data->shm_id, nullptr, 0);
-   if (image_data->shm_addr == (void *)-1)
+   if (m_present_backend != nullptr && m_present_mode == VK_PRESENT_MODE_MAILBOX_KHR)
    {
-      WSI_LOG_ERROR("Failed to attach shared memory segment");
-      shmctl(image_data->shm_id, IPC_RMID, nullptr);
-      image_data->shm_id = -1;
-      return VK_ERROR_OUT_OF_HOST_MEMORY;
+      /* The server may replace a queued frame by this one, so the update cannot be relative to the previous one. */
+      update.assign(1, VkRect2D{ { 0, 0 }, extent });
    }
 
-   image_data->shm_seg = xcb_generate_id(m_connection);
-   xcb_shm_attach(m_connection, image_data->shm_seg, image_data->shm_id, 0);
+   const size_t dest_stride = image_data->stride;
+   uint16_t total_width = extent.width;
+   uint32_t shm_offset = 0;
+   xcb_shm_seg_t active_seg = image_data->shm_seg;
+   xcb_pixmap_t active_pixmap = image_data->shm_pixmap;
+   staging_slot *slot = nullptr;
 
-   image_data->shm_id_alt = shmget(IPC_PRIVATE, shm_size, IPC_CREAT | SHM_PERMISSIONS);
-   if (image_data->shm_id_alt < 0)
+   if (image_data->zero_copy)
    {
-      WSI_LOG_ERROR("Failed to create alternate shared memory segment");
+      /* The GPU rendered straight into the segment; describe its layout to the server instead of repacking it. */
+      total_width = static_cast<uint16_t>(source_stride / sizeof(uint32_t));
+      shm_offset = static_cast<uint32_t>(image_data->external_mem.get_host_layout().offset);
    }
    else
    {
-      image_data->shm_addr_alt = shmat(image_data->shm_id_alt, nullptr, 0);
-      if (image_data->shm_addr_alt == (void *)-1)
+      char *dst_base = nullptr;
+      if (m_socket_upload)
       {
-         WSI_LOG_ERROR("Failed to attach alternate shared memory segment");
-         shmctl(image_data->shm_id_alt, IPC_RMID, nullptr);
-         image_data->shm_id_alt = -1;
-         image_data->shm_addr_alt = nullptr;
+         dst_base = m_uploader.map_frame(dest_stride, extent.height);
+      }
+      else if ((slot = m_staging.acquire(dest_stride * extent.height, extent.width, extent.height,
+                                         image_data->depth)) != nullptr)
+      {
+         active_seg = slot->segment.seg;
+         active_pixmap = slot->pixmap;
+         dst_base = static_cast<char *>(slot->segment.addr);
+
+         /* Present takes the whole pixmap as the new frame, while the slot still holds the frame it carried a
+          * full ring earlier, so it also gets what changed in between. */
+         if (m_present_backend != nullptr)
+         {
+            damage = m_staging.take_damage(*slot, damage);
+         }
+      }
+      if (dst_base == nullptr)
+      {
+         return VK_ERROR_OUT_OF_HOST_MEMORY;
+      }
+
+      if (m_rotation != util::pixel_rotation::none)
+      {
+         for (uint32_t i = 0; i < damage.count(); i++)
+         {
+            transfer_rotated_rect(image_data, src_base, source_stride, dst_base, dest_stride, damage.rect(i));
+         }
+      }
+      else if (damage.is_full() && m_pixel_converter.is_copy())
+      {
+         const uint32_t *src_pixels = (const uint32_t *)src_base;
+         uint32_t *dst_pixels = (uint32_t *)dst_base;
+         uint32_t src_stride_pixels = source_stride / sizeof(uint32_t);
+
+         copy_pixels_optimized(src_pixels, dst_pixels, src_stride_pixels, image_data->width, image_data->height);
       }
       else
       {
-         image_data->shm_seg_alt = xcb_generate_id(m_connection);
-         xcb_shm_attach(m_connection, image_data->shm_seg_alt, image_data->shm_id_alt, 0);
+         for (uint32_t i = 0; i < damage.count(); i++)
+         {
+            transfer_rect(src_base, source_stride, dst_base, dest_stride, damage.rect(i));
+         }
       }
    }
 
-   int create_resources_flush_result = xcb_flush(m_connection);
-   if (create_resources_flush_result <= 0)
+   if (m_socket_upload)
    {
-      WSI_LOG_ERROR("SHM presenter xcb_flush failed: result=%d", create_resources_flush_result);
+      /* The frame is copied out of the image, which can go back to the application right away. */
+      m_uploader.upload(update.data(), static_cast<uint32_t>(update.size()), offset, image_data->depth,
+                        m_pixel_converter.get_dst_bytes_per_pixel(), get_scanline_pad_for_depth(image_data->depth));
+      return VK_SUCCESS;
    }
 
-   xcb_get_input_focus_cookie_t sync_cookie = xcb_get_input_focus(m_connection);
-   xcb_get_input_focus_reply_t *sync_reply = xcb_get_input_focus_reply(m_connection, sync_cookie, nullptr);
-   if (sync_reply)
+   if (m_present_backend != nullptr)
    {
-      free(sync_reply);
+      /* A zero-copy image is read until its idle event, see is_image_released(). */
+      const bool presented = m_present_backend->present(active_pixmap, update.data(),
+                                                        static_cast<uint32_t>(update.size()), offset, m_present_mode);
+      return presented ? VK_SUCCESS : VK_ERROR_SURFACE_LOST_KHR;
    }
 
-   shmctl(image_data->shm_id, IPC_RMID, nullptr);
-   if (image_data->shm_id_alt >= 0)
+   for (uint32_t i = 0; i < damage.count(); i++)
    {
-      shmctl(image_data->shm_id_alt, IPC_RMID, nullptr);
+      const VkRect2D &rect = damage.rect(i);
+      xcb_shm_put_image(m_connection, m_window, m_gc, total_width, extent.height, rect.offset.x, rect.offset.y,
+                        rect.extent.width, rect.extent.height, rect.offset.x + offset.x, rect.offset.y + offset.y,
+                        image_data->depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 0, active_seg, shm_offset);
    }
 
+   if (slot != nullptr)
+   {
+      m_staging.release(*slot);
+   }
+   else
+   {
+      /* Requests are processed in order, so once this reply arrives the server has finished with the puts above. */
+      if (image_data->read_pending)
+      {
+         xcb_discard_reply(m_connection, image_data->read_cookie.sequence);
+      }
+      image_data->read_cookie = xcb_get_input_focus(m_connection);
+      image_data->read_pending = true;
+   }
    return VK_SUCCESS;
 }
 
-
-
-
-VkResult shm_presenter::present_image(x11_image_data *image_data, uint32_t /*serial*/)
+VkResult shm_presenter::present_frame(x11_image_data *image_data, const VkRect2D *damage_rects,
+                                      uint32_t damage_rect_count)
 {
-
-   if (m_fence_available && !m_first_frame)
+   if (!image_data->zero_copy && !image_data->external_mem.is_host_visible())
    {
-      wait_for_presentation_fence();
+      WSI_LOG_ERROR("GPU memory not available for SHM presentation");
+      return VK_ERROR_DEVICE_LOST;
    }
-   else if (!m_fence_available)
+
+   void *mapped_memory = nullptr;
+   if (image_data->external_mem.map_host_memory(&mapped_memory) != VK_SUCCESS || mapped_memory == nullptr)
    {
-      if (m_sync_pending)
-      {
-         ensure_sync_completion();
-      }
+      return VK_ERROR_UNKNOWN;
    }
-   m_first_frame = false;
 
-   int present_flush_result = xcb_flush(m_connection);
-   if (present_flush_result <= 0)
+   if (image_data->external_mem.invalidate_host_memory() != VK_SUCCESS)
    {
-      WSI_LOG_ERROR("SHM presenter xcb_flush failed: result=%d", present_flush_result);
+      WSI_LOG_ERROR("Failed to invalidate image memory before reading it");
+      return VK_ERROR_UNKNOWN;
    }
 
-   image_data->use_alt_buffer = !image_data->use_alt_buffer;
-   xcb_shm_seg_t active_seg =
-      image_data->use_alt_buffer && image_data->shm_seg_alt != XCB_NONE ? image_data->shm_seg_alt : image_data->shm_seg;
-   void *active_addr = image_data->use_alt_buffer && image_data->shm_addr_alt != nullptr ? image_data->shm_addr_alt :
-                                                                                           image_data->shm_addr;
+   const auto &vulkan_layout = image_data->external_mem.get_host_layout();
+   size_t source_stride = vulkan_layout.rowPitch;
+   char *src_base = (char *)mapped_memory + vulkan_layout.offset;
 
-   if (active_addr && image_data->shm_size > 0)
+   const VkExtent2D extent = get_display_extent(image_data);
+   VkRect2D placement = { { 0, 0 }, extent };
+   if (m_scaling_behavior != 0)
    {
-      if (image_data->external_mem.is_host_visible())
+      update_window_size();
+      placement = compute_placement(extent.width, extent.height);
+      if (std::memcmp(&placement, &m_last_placement, sizeof(placement)) != 0)
       {
-         void *mapped_memory = nullptr;
-         if (image_data->external_mem.map_host_memory(&mapped_memory) == VK_SUCCESS && mapped_memory != nullptr)
-         {
-            const auto &vulkan_layout = image_data->external_mem.get_host_layout();
-            size_t source_stride = vulkan_layout.rowPitch;
-            size_t dest_stride = image_data->stride;
-            size_t source_offset = vulkan_layout.offset;
-
-            size_t bytes_per_pixel = dest_stride / image_data->width;
-            size_t gpu_pixels_per_row = image_data->width;
-            size_t display_pixels_per_row = image_data->width;
-
-            char *src_base = (char *)mapped_memory + source_offset;
-
-            if (gpu_pixels_per_row != display_pixels_per_row)
-            {
-               precompute_scaling_lut(gpu_pixels_per_row, display_pixels_per_row);
-            }
-            else
-            {
-               m_scaling_lut.clear();
-            }
-
-            char *dst_base = (char *)active_addr;
-
-            if (bytes_per_pixel == 4)
-            {
-               uint32_t *src_pixels = (uint32_t *)src_base;
-               uint32_t *dst_pixels = (uint32_t *)dst_base;
-               uint32_t src_stride_pixels = source_stride / bytes_per_pixel;
-
-               copy_pixels_optimized(src_pixels, dst_pixels, src_stride_pixels, display_pixels_per_row,
-                                     image_data->height);
-            }
-            else
-            {
-               for (uint32_t row = 0; row < image_data->height; row++)
-               {
-                  char *src_row = src_base + (row * source_stride);
-                  char *dst_row = dst_base + (row * dest_stride);
-                  size_t copy_size = std::min(source_stride, dest_stride);
-                  std::memcpy(dst_row, src_row, copy_size);
-               }
-            }
-         }
-         else
-         {
-            return VK_ERROR_UNKNOWN;
-         }
+         fill_borders(placement);
+         m_last_placement = placement;
+         m_force_full_damage = true;
       }
-      else
+   }
+
+   VkResult result = VK_SUCCESS;
+   if (placement.extent.width != extent.width || placement.extent.height != extent.height)
+   {
+      if (m_rotation != util::pixel_rotation::none && m_render_scaler == nullptr)
       {
-         WSI_LOG_ERROR("GPU memory not available for SHM presentation");
-         return VK_ERROR_DEVICE_LOST;
+         /* The scaler samples rows of its source, so a rotated frame is scaled from an upright copy. */
+         const size_t rotated_stride = extent.width * sizeof(uint32_t);
+         m_rotated_frame.resize(static_cast<size_t>(extent.width) * extent.height);
+         auto rotate_band = [&](uint32_t begin_row, uint32_t end_row) {
+            util::rotate_pixels(m_rotated_frame.data() + static_cast<size_t>(begin_row) * extent.width,
+                                rotated_stride, src_base, source_stride, image_data->width, image_data->height,
+                                m_rotation, 0, begin_row, extent.width, end_row - begin_row);
+         };
+         run_in_bands(extent.height, extent.width * extent.height, rotate_band);
+
+         src_base = reinterpret_cast<char *>(m_rotated_frame.data());
+         source_stride = rotated_stride;
       }
+      result = present_scaled(image_data, src_base, source_stride, extent, placement);
+      /* Whatever the window showed unscaled is gone. */
+      m_force_full_damage = true;
    }
    else
    {
-      return VK_ERROR_UNKNOWN;
+      result = present_unscaled(image_data, src_base, source_stride, damage_rects, damage_rect_count,
+                                placement.offset);
+   }
+
+   if (m_present_backend == nullptr)
+   {
+      update_refresh_rate(m_window_width != 0 ? m_window_width : extent.width,
+                          m_window_height != 0 ? m_window_height : extent.height);
    }
 
-   xcb_shm_put_image(m_connection, m_window, m_gc, image_data->width, image_data->height, 0, 0, image_data->width,
-                     image_data->height, 0, 0, image_data->depth, XCB_IMAGE_FORMAT_Z_PIXMAP, 0, active_seg, 0);
+   return result;
+}
 
-   auto current_time = std::chrono::steady_clock::now();
-   auto time_since_last = std::chrono::duration_cast<std::chrono::microseconds>(current_time - m_last_frame_time);
+VkResult shm_presenter::present_image(x11_image_data *image_data, uint32_t /*serial*/, const VkRect2D *damage_rects,
+                                      uint32_t damage_rect_count, VkPresentModeKHR present_mode)
+{
+   m_present_mode = present_mode;
+   m_wsi_surface->process_present_events();
+   m_wsi_surface->get_shm_pool().sync();
+
+   /* Frames of a window nobody can see are not copied, only paced at a lower rate. */
+   m_throttled = !m_wsi_surface->is_window_visible();
+   VkResult result = VK_SUCCESS;
+   if (m_throttled)
+   {
+      /* The window content is stale by the time it shows again. */
+      m_force_full_damage = true;
+   }
+   else
+   {
+      result = present_frame(image_data, damage_rects, damage_rect_count);
+      if (m_present_backend != nullptr)
+      {
+         /* Paced by the target MSC, see present_backend::present. */
+         return result;
+      }
+   }
 
-   if (m_last_frame_time.time_since_epoch().count() > 0 && time_since_last < m_frame_interval)
+   /* Page flipping waits for the due time in poll_ready(), so this only sleeps for callers that did not. */
+   const auto target_time = get_frame_due_time(m_throttled, m_present_mode);
+   auto current_time = std::chrono::steady_clock::now();
+   if (current_time < target_time)
    {
-      auto sleep_time = m_frame_interval - time_since_last;
+      auto sleep_time = std::chrono::duration_cast<std::chrono::microseconds>(target_time - current_time);
 
       if (sleep_time > std::chrono::microseconds(500))
       {
@@ -851,7 +1023,6 @@ VkResult shm_presenter::present_image(x11_image_data *image_data, uint32_t /*ser
          std::this_thread::sleep_for(conservative_sleep);
       }
 
-      auto target_time = m_last_frame_time + m_frame_interval;
       while (std::chrono::steady_clock::now() < target_time)
       {
          std::this_thread::sleep_for(std::chrono::microseconds(10));
@@ -860,82 +1031,134 @@ VkResult shm_presenter::present_image(x11_image_data *image_data, uint32_t /*ser
    }
    m_last_frame_time = current_time;
 
-   if (m_fence_available)
-   {
-      trigger_presentation_fence();
-   }
-   else
-   {
-      start_async_sync();
-   }
-
    int final_flush_result = xcb_flush(m_connection);
    if (final_flush_result <= 0)
    {
       WSI_LOG_ERROR("SHM presenter xcb_flush failed: result=%d", final_flush_result);
    }
 
-   return VK_SUCCESS;
+   return result;
 }
-void shm_presenter::destroy_image_resources(x11_image_data *image_data)
+std::chrono::steady_clock::time_point shm_presenter::get_frame_due_time(bool hidden,
+                                                                       VkPresentModeKHR present_mode) const
 {
-   if (image_data->shm_seg != XCB_NONE)
+   /* Demand refresh presents from vkQueuePresentKHR and is paced by the application alone. */
+   if (present_mode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR || m_last_frame_time.time_since_epoch().count() == 0)
    {
-      xcb_generic_error_t *error = xcb_request_check(m_connection, 
-          xcb_shm_detach_checked(m_connection, image_data->shm_seg));
-      if (error)
-      {
-         WSI_LOG_ERROR("SHM detach failed: error_code=%d, sequence=%d", 
-                      error->error_code, error->sequence);
-         free(error);
-      }
-      
-      image_data->shm_seg = XCB_NONE;
+      return std::chrono::steady_clock::time_point::min();
    }
+   return m_last_frame_time + (hidden ? m_hidden_frame_interval : m_frame_interval);
+}
 
-   if (image_data->shm_seg_alt != XCB_NONE)
+bool shm_presenter::poll_ready(VkPresentModeKHR present_mode, present_wait &wait)
+{
+   m_wsi_surface->process_present_events();
+
+   /* Polling the ring may read events off the connection, so the Present events are handled after it. */
+   const bool slot_ready = m_socket_upload || m_staging.is_next_slot_ready();
+   if (m_present_backend != nullptr && !m_present_backend->dispatch_events())
    {
-      xcb_generic_error_t *error = xcb_request_check(m_connection, 
-          xcb_shm_detach_checked(m_connection, image_data->shm_seg_alt));
-      if (error)
-      {
-         WSI_LOG_ERROR("SHM alt detach failed: error_code=%d, sequence=%d", 
-                      error->error_code, error->sequence);
-         free(error);
-      }
-      
-      image_data->shm_seg_alt = XCB_NONE;
+      /* present_image() fails right away. */
+      return true;
    }
 
-   if (image_data->shm_addr && image_data->shm_addr != (void *)-1)
+   const bool hidden = !m_wsi_surface->is_window_visible();
+   if (hidden || m_present_backend == nullptr)
    {
-      int detach_result = shmdt(image_data->shm_addr);
-      if (detach_result != 0)
+      const auto due_time = get_frame_due_time(hidden, present_mode);
+      if (std::chrono::steady_clock::now() < due_time)
+      {
+         wait.add_deadline(due_time);
+         return false;
+      }
+      if (hidden)
       {
-         WSI_LOG_ERROR("Failed to detach shared memory: errno=%d", errno);
+         /* Nothing is sent to the server for a hidden window. */
+         return true;
       }
-      image_data->shm_addr = nullptr;
    }
 
-   if (image_data->shm_addr_alt && image_data->shm_addr_alt != (void *)-1)
+   const bool ready = slot_ready && (m_present_backend == nullptr || m_present_backend->can_present(present_mode)) &&
+                      (m_render_scaler == nullptr || m_render_scaler->is_next_target_idle());
+   if (!ready)
    {
-      int detach_result = shmdt(image_data->shm_addr_alt);
-      if (detach_result != 0)
-      {
-         WSI_LOG_ERROR("Failed to detach alternate shared memory: errno=%d", errno);
-      }
-      image_data->shm_addr_alt = nullptr;
+      wait_for_events(wait);
+   }
+   return ready;
+}
+
+bool shm_presenter::is_image_released(x11_image_data *image_data)
+{
+   if (!image_data->zero_copy)
+   {
+      return true;
+   }
+
+   if (m_present_backend != nullptr)
+   {
+      return m_present_backend->is_idle(image_data->shm_pixmap);
+   }
+
+   if (!image_data->read_pending)
+   {
+      return true;
+   }
+
+   void *reply = nullptr;
+   xcb_generic_error_t *error = nullptr;
+   if (!xcb_poll_for_reply(m_connection, image_data->read_cookie.sequence, &reply, &error))
+   {
+      return false;
+   }
+   free(reply);
+   free(error);
+   image_data->read_pending = false;
+   return true;
+}
+
+void shm_presenter::wait_for_events(present_wait &wait)
+{
+   const auto now = std::chrono::steady_clock::now();
+   if (!m_wsi_surface->has_private_connection())
+   {
+      /* The application reads its own connection, its descriptor says nothing about our events. */
+      wait.add_deadline(now + EVENT_POLL_INTERVAL);
+      return;
+   }
+
+   /* Events may also be read off the connection into xcb's queues by another swapchain of the surface, which leaves
+    * the descriptor quiet, so they are checked now and then regardless. */
+   wait.add_fd(xcb_get_file_descriptor(m_connection));
+   wait.add_deadline(now + PRIVATE_EVENT_POLL_INTERVAL);
+}
+
+void shm_presenter::destroy_image_resources(x11_image_data *image_data)
+{
+   if (image_data->read_pending)
+   {
+      /* The segment may be reused right away, so the server must be done with it. */
+      free(xcb_get_input_focus_reply(m_connection, image_data->read_cookie, nullptr));
+      image_data->read_pending = false;
+   }
+
+   if (m_present_backend != nullptr)
+   {
+      m_present_backend->destroy_pixmap(image_data->shm_pixmap);
    }
+   image_data->shm_pixmap = XCB_PIXMAP_NONE;
 
-   image_data->shm_id = -1;
-   image_data->shm_id_alt = -1;
+   /* The segment goes back attached to the surface's pool, for this or the next swapchain to reuse. */
+   shm_segment segment{ image_data->shm_seg, image_data->shm_addr, image_data->shm_size };
+   m_wsi_surface->get_shm_pool().release(segment);
+   image_data->shm_seg = XCB_NONE;
+   image_data->shm_addr = nullptr;
    image_data->shm_size = 0;
-   image_data->use_alt_buffer = false;
 }
 
-bool shm_presenter::is_available(xcb_connection_t * /*connection*/, surface *wsi_surface)
+bool shm_presenter::is_available(xcb_connection_t *connection, surface * /*wsi_surface*/)
 {
-   return wsi_surface->has_shm();
+   /* Servers without usable MIT-SHM get frames through PutImage requests. */
+   return !xcb_connection_has_error(connection);
 }
 
 VkResult shm_presenter::create_graphics_context()
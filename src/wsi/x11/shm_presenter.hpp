@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <vulkan/vulkan.h>
@@ -39,10 +40,18 @@
 #include <cstdint>
 #include <unordered_map>
 #include <chrono>
-#include <atomic>
-#include <mutex>
 #include <xcb/sync.h>
 
+#include "present_backend.hpp"
+#include "present_damage.hpp"
+#include "shm_staging.hpp"
+#include "pixel_convert.hpp"
+#include "pixel_scale.hpp"
+#include "pixel_rotate.hpp"
+#include "put_image_upload.hpp"
+#include "render_scale.hpp"
+#include "wsi/present_scheduler.hpp"
+
 namespace wsi
 {
 namespace x11
@@ -58,14 +67,114 @@ public:
 
    shm_presenter();
 
-   VkResult init(xcb_connection_t *connection, xcb_window_t window, surface *wsi_surface);
+   /**
+    * @brief Set up presentation to a window.
+    *
+    * @param image_format Format of the images that will be presented, picks the conversion to the window's visual.
+    */
+   VkResult init(xcb_connection_t *connection, xcb_window_t window, surface *wsi_surface, VkFormat image_format);
+
+   /**
+    * @brief Whether the window's visual differs from the image layout, which rules out sharing memory with the server.
+    */
+   bool needs_pixel_conversion() const
+   {
+      return !m_pixel_converter.is_copy();
+   }
+
+   /**
+    * @brief Rotate presented images back from the swapchain's pre-transform while copying them.
+    *
+    * @param pre_transform Rotation the application applied to the image content, identity or a ROTATE bit.
+    */
+   void set_pre_transform(VkSurfaceTransformFlagBitsKHR pre_transform);
+
+   /**
+    * @brief Whether presented images are rotated, which rules out sharing memory with the server.
+    */
+   bool needs_rotation() const
+   {
+      return m_rotation != util::pixel_rotation::none;
+   }
 
    VkResult create_image_resources(x11_image_data *image_data, uint32_t width, uint32_t height, int depth);
 
-   VkResult present_image(x11_image_data *image_data, uint32_t serial);
+   /**
+    * @brief Create a single SHM segment meant to be imported as the image's own memory.
+    *
+    * Images backed by such a segment are presented without any CPU copy, see x11_image_data::zero_copy.
+    *
+    * @param image_data Image to create the segment for.
+    * @param size       Segment size in bytes.
+    * @param alignment  Alignment the segment address must satisfy to be importable.
+    */
+   VkResult create_zero_copy_segment(x11_image_data *image_data, size_t size, size_t alignment);
+
+   /**
+    * @brief Present an image to the window.
+    *
+    * @param image_data        Image to present.
+    * @param serial            Present serial.
+    * @param damage_rects      Regions changed since the previous present, from VK_KHR_incremental_present.
+    * @param damage_rect_count Number of @p damage_rects, 0 if unknown (whole image, or tile detection if enabled).
+    * @param present_mode      Present mode of the frame, picks the target MSC when the Present extension is used.
+    */
+   VkResult present_image(x11_image_data *image_data, uint32_t serial, const VkRect2D *damage_rects,
+                          uint32_t damage_rect_count, VkPresentModeKHR present_mode);
+
+   /**
+    * @brief Handle the server's events and check, without blocking, whether present_image() would have to wait.
+    *
+    * @param present_mode Present mode of the next frame.
+    * @param[out] wait    Gets what present_image() would wait for: the server's events, or the time the next frame
+    *                     is due when frames are paced by a timer.
+    *
+    * @return true if present_image() can run now.
+    */
+   bool poll_ready(VkPresentModeKHR present_mode, present_wait &wait);
+
+   /**
+    * @brief Whether the server is done reading an image given to present_image(), as of the last poll_ready().
+    *
+    * Only zero-copy images are still read after present_image() returned.
+    */
+   bool is_image_released(x11_image_data *image_data);
+
+   /**
+    * @brief Add waiting for the server's next events to @p wait.
+    */
+   void wait_for_events(present_wait &wait);
+
+   /**
+    * @brief Whether the window was hidden at the last present, in which case frames are paced but not copied.
+    */
+   bool is_throttled() const
+   {
+      return m_throttled;
+   }
+
+   /**
+    * @brief Refresh duration of the window's output, measured from Present completions when available.
+    *
+    * While throttled this is the reduced interval hidden windows are paced at.
+    */
+   uint64_t get_refresh_duration_ns() const;
+
+   /**
+    * @brief Set how images are placed in a window whose size differs from theirs, see VK_EXT_swapchain_maintenance1.
+    *
+    * @param scaling_behavior VkPresentScalingFlagBitsEXT, 0 keeps presenting unscaled at the top left corner.
+    * @param gravity_x        Horizontal VkPresentGravityFlagBitsEXT, 0 behaves as MIN.
+    * @param gravity_y        Vertical VkPresentGravityFlagBitsEXT, 0 behaves as MIN.
+    */
+   void set_present_scaling(VkPresentScalingFlagsEXT scaling_behavior, VkPresentGravityFlagsEXT gravity_x,
+                            VkPresentGravityFlagsEXT gravity_y);
 
    void destroy_image_resources(x11_image_data *image_data);
 
+   /**
+    * @brief Whether frames can be presented, through shared memory or over the connection when that is unavailable.
+    */
    bool is_available(xcb_connection_t *connection, surface *wsi_surface);
 
 private:
@@ -74,61 +183,104 @@ private:
    surface *m_wsi_surface = nullptr;
    xcb_gcontext_t m_gc = XCB_NONE;
 
-   std::vector<uint32_t> m_scaling_lut;
-   uint32_t m_last_gpu_width = 0;
-   uint32_t m_last_display_width = 0;
+   std::unordered_map<int, uint8_t> m_depth_to_bpp_cache;
+   std::unordered_map<int, uint8_t> m_depth_to_scanline_pad_cache;
 
-   xcb_get_geometry_cookie_t m_pending_sync_cookie;
-   bool m_sync_pending = false;
+   util::pixel_converter m_pixel_converter;
 
-   xcb_sync_fence_t m_presentation_fence = XCB_NONE;
-   bool m_fence_available = false;
-   bool m_first_frame = true;
+   /* Opt-in change detection for presents without VK_KHR_incremental_present regions. */
+   bool m_tile_damage_enabled = false;
+   tile_damage_detector m_tile_detector;
+   bool m_force_full_damage = true;
 
-   std::unordered_map<int, uint8_t> m_depth_to_bpp_cache;
+   /* Presentation scaling, see set_present_scaling. */
+   VkPresentScalingFlagsEXT m_scaling_behavior = 0;
+   VkPresentGravityFlagsEXT m_gravity_x = 0;
+   VkPresentGravityFlagsEXT m_gravity_y = 0;
+   util::scale_filter m_scale_filter = util::scale_filter::bilinear;
+   util::pixel_scaler m_scaler;
+   VkRect2D m_last_placement = {};
+   uint32_t m_window_width = 0;
+   uint32_t m_window_height = 0;
+   xcb_get_geometry_cookie_t m_geometry_cookie;
+   bool m_geometry_pending = false;
+
+   /* Window origin in root coordinates, to find the output it is on. */
+   xcb_window_t m_root = XCB_NONE;
+   int32_t m_window_x = 0;
+   int32_t m_window_y = 0;
+   xcb_translate_coordinates_cookie_t m_position_cookie;
+   bool m_position_pending = false;
+
+   /* Rotation undoing the pre-transform, with an upright copy of the frame for when it is also scaled. */
+   util::pixel_rotation m_rotation = util::pixel_rotation::none;
+   std::vector<uint32_t> m_rotated_frame;
+
+   /* Frames go through PresentPixmap when the server supports it, otherwise through timed SHM puts. */
+   std::unique_ptr<present_backend> m_present_backend;
+   VkPresentModeKHR m_present_mode = VK_PRESENT_MODE_FIFO_KHR;
+
+   /* Opt-in scaling by the server, declared after the backend presenting its pixmaps. */
+   std::unique_ptr<render_scaler> m_render_scaler;
+
+   /* Where copied frames are staged for the server, declared after the backend that owns its pixmaps. */
+   shm_staging_ring m_staging;
+
+   /* Without MIT-SHM frames are staged in process memory and sent over the connection instead. */
+   bool m_socket_upload = false;
+   put_image_uploader m_uploader;
 
    std::chrono::steady_clock::time_point m_last_frame_time;
    std::chrono::microseconds m_frame_interval;
    double m_refresh_rate_hz;
 
-   std::atomic<bool> m_thread_error_occurred{ false };
-   std::mutex m_error_recovery_mutex;
+   /* Pacing of frames presented while the window is hidden, see surface::is_window_visible. */
+   std::atomic<bool> m_throttled{ false };
+   std::chrono::microseconds m_hidden_frame_interval{ 100000 };
 
 
    VkResult create_graphics_context();
 
-   void precompute_scaling_lut(uint32_t gpu_width, uint32_t display_width);
    void copy_pixels_optimized(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
                               uint32_t dst_width, uint32_t height);
    void copy_pixels_threaded(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
                              uint32_t dst_width, uint32_t height);
    void copy_pixels_optimized_single_thread(const uint32_t *src_pixels, uint32_t *dst_pixels,
                                             uint32_t src_stride_pixels, uint32_t dst_width, uint32_t height);
-#ifdef ENABLE_ARM_NEON
-   void copy_pixels_simd(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
-                         uint32_t dst_width, uint32_t height);
-#endif
-   void copy_pixels_scalar(const uint32_t *src_pixels, uint32_t *dst_pixels, uint32_t src_stride_pixels,
-                           uint32_t dst_width, uint32_t height);
-
-   void start_async_sync();
-   bool check_pending_sync();
-   void ensure_sync_completion();
-
-   bool init_fence_sync();
-   void cleanup_fence_sync();
-   void wait_for_presentation_fence();
-   void trigger_presentation_fence();
+
+   void collect_damage(const x11_image_data *image_data, const char *src_base, size_t src_stride,
+                       const VkRect2D *damage_rects, uint32_t damage_rect_count, damage_region &damage);
+   void transfer_rect(const char *src_base, size_t src_stride, char *dst_base, size_t dst_stride,
+                      const VkRect2D &rect);
+   void transfer_rotated_rect(const x11_image_data *image_data, const char *src_base, size_t src_stride,
+                              char *dst_base, size_t dst_stride, const VkRect2D &rect);
+   VkExtent2D get_display_extent(const x11_image_data *image_data) const;
+   VkResult present_frame(x11_image_data *image_data, const VkRect2D *damage_rects, uint32_t damage_rect_count);
+   VkResult present_unscaled(x11_image_data *image_data, const char *src_base, size_t source_stride,
+                             const VkRect2D *damage_rects, uint32_t damage_rect_count, VkOffset2D offset);
+
+   void update_window_size();
+   VkRect2D compute_placement(uint32_t image_width, uint32_t image_height) const;
+   void fill_borders(const VkRect2D &placement);
+   VkResult present_scaled(x11_image_data *image_data, const char *src_base, size_t source_stride,
+                           VkExtent2D source_extent, const VkRect2D &placement);
+   VkResult present_scaled_on_server(x11_image_data *image_data, const char *src_base, size_t source_stride,
+                                     VkExtent2D source_extent, const VkRect2D &placement);
 
    void cache_x11_formats();
    uint8_t get_bits_per_pixel_for_depth(int depth);
+   uint8_t get_scanline_pad_for_depth(int depth);
+   void configure_pixel_format(VkFormat image_format);
+
+   /**
+    * @brief Retarget pacing to the refresh rate of the output showing most of the window.
+    */
+   void update_refresh_rate(uint32_t width, uint32_t height);
 
-   bool is_aligned(const void *ptr, size_t alignment);
-#ifdef ENABLE_ARM_NEON
-   bool are_pointers_neon_aligned(const void *src, void *dst);
-#endif
-   void detect_refresh_rate();
-   double get_window_refresh_rate();
+   /**
+    * @brief When the next frame paced by a timer is due, for a hidden window or without the Present extension.
+    */
+   std::chrono::steady_clock::time_point get_frame_due_time(bool hidden, VkPresentModeKHR present_mode) const;
 
 };
 
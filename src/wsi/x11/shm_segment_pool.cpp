@@ -0,0 +1,367 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file shm_segment_pool.cpp
+ *
+ * @brief Pool of MIT-SHM segments attached to an X11 connection, reused across swapchains of a surface.
+ */
+
+#include "shm_segment_pool.hpp"
+#include "utils/logging.hpp"
+
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace wsi
+{
+namespace x11
+{
+
+static constexpr size_t DEFAULT_MAX_FREE_MB = 256;
+static constexpr int SHM_PERMISSIONS = 0666;
+static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/* Eight classes per power of two keep the rounding under 12.5% while letting a slowly growing window reuse. */
+static constexpr unsigned SIZE_CLASSES_PER_POW2_SHIFT = 3;
+
+static size_t get_max_free_bytes()
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_SHM_POOL_MB");
+   const long mb = env != nullptr ? std::strtol(env, nullptr, 10) : static_cast<long>(DEFAULT_MAX_FREE_MB);
+   return mb > 0 ? static_cast<size_t>(mb) * 1024 * 1024 : 0;
+}
+
+static size_t round_to_size_class(size_t size)
+{
+   size_t pow2 = 1;
+   while (pow2 <= size / 2)
+   {
+      pow2 <<= 1;
+   }
+
+   const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+   size_t granule = pow2 >> SIZE_CLASSES_PER_POW2_SHIFT;
+   if (granule < page)
+   {
+      granule = page;
+   }
+   return (size + granule - 1) / granule * granule;
+}
+
+shm_segment_pool::shm_segment_pool(xcb_connection_t *connection)
+   : m_connection(connection)
+   , m_max_free_bytes(get_max_free_bytes())
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_SHM_HUGEPAGES");
+   if (env != nullptr && std::strcmp(env, "0") == 0)
+   {
+      m_huge_pages = huge_pages::none;
+   }
+   else if (env != nullptr && std::strcmp(env, "hugetlb") == 0)
+   {
+      m_huge_pages = huge_pages::hugetlb;
+   }
+}
+
+void shm_segment_pool::enable_attach_fd()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_attach_fd = true;
+}
+
+shm_segment_pool::~shm_segment_pool()
+{
+   sync();
+   for (auto &segment : m_free)
+   {
+      destroy(segment);
+   }
+}
+
+bool shm_segment_pool::acquire(size_t size, size_t alignment, shm_segment &segment)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      /* Best fit, but not so much larger than needed that a small swapchain pins a large segment. */
+      auto best = m_free.end();
+      for (auto it = m_free.begin(); it != m_free.end(); ++it)
+      {
+         const bool fits = it->size >= size && it->size <= size + size / 2 &&
+                           reinterpret_cast<uintptr_t>(it->addr) % alignment == 0;
+         if (fits && (best == m_free.end() || it->size < best->size))
+         {
+            best = it;
+         }
+      }
+
+      if (best != m_free.end())
+      {
+         segment = *best;
+         m_free_bytes -= best->size;
+         m_free.erase(best);
+         return true;
+      }
+   }
+
+   bool attach_fd;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      attach_fd = m_attach_fd;
+   }
+
+   const size_t class_size = round_to_size_class(size);
+   if (attach_fd && create_memfd_segment(class_size, segment))
+   {
+      if (reinterpret_cast<uintptr_t>(segment.addr) % alignment == 0)
+      {
+         return true;
+      }
+      WSI_LOG_WARNING("Shared memory at %p does not meet alignment %zu", segment.addr, alignment);
+      destroy(segment);
+      return false;
+   }
+
+   return create_sysv_segment(class_size, alignment, segment);
+}
+
+/**
+ * @brief Map @p size bytes of @p fd at an address aligned to @p alignment.
+ *
+ * Transparent huge pages only back the parts of a mapping that are aligned to the huge page size.
+ */
+static void *map_aligned(int fd, size_t size, size_t alignment)
+{
+   void *reservation = mmap(nullptr, size + alignment, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (reservation == MAP_FAILED)
+   {
+      return MAP_FAILED;
+   }
+
+   const uintptr_t start = reinterpret_cast<uintptr_t>(reservation);
+   const uintptr_t aligned = (start + alignment - 1) / alignment * alignment;
+   void *addr = mmap(reinterpret_cast<void *>(aligned), size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+   if (addr == MAP_FAILED)
+   {
+      munmap(reservation, size + alignment);
+      return MAP_FAILED;
+   }
+
+   if (aligned > start)
+   {
+      munmap(reservation, aligned - start);
+   }
+   if (start + alignment > aligned)
+   {
+      munmap(reinterpret_cast<void *>(aligned + size), start + alignment - aligned);
+   }
+   return addr;
+}
+
+bool shm_segment_pool::create_memfd_segment(size_t size, shm_segment &segment)
+{
+   int fd = -1;
+   void *addr = MAP_FAILED;
+
+   if (m_huge_pages == huge_pages::hugetlb)
+   {
+      const size_t huge_size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+      fd = memfd_create("mali-wsi-shm", MFD_CLOEXEC | MFD_HUGETLB);
+      if (fd >= 0 && ftruncate(fd, static_cast<off_t>(huge_size)) == 0)
+      {
+         /* hugetlbfs reserves the pages when mapping, so an empty reserve fails here rather than on first touch. */
+         addr = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      }
+
+      if (addr != MAP_FAILED)
+      {
+         size = huge_size;
+      }
+      else if (fd >= 0)
+      {
+         close(fd);
+         fd = -1;
+      }
+   }
+
+   if (addr == MAP_FAILED)
+   {
+      const bool use_thp = m_huge_pages != huge_pages::none && size >= HUGE_PAGE_SIZE;
+      if (use_thp)
+      {
+         size = (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+      }
+
+      fd = memfd_create("mali-wsi-shm", MFD_CLOEXEC);
+      if (fd < 0)
+      {
+         WSI_LOG_WARNING("memfd_create failed: errno=%d, using SysV shared memory", errno);
+         return false;
+      }
+
+      if (ftruncate(fd, static_cast<off_t>(size)) != 0)
+      {
+         WSI_LOG_WARNING("Failed to size memfd to %zu bytes: errno=%d, using SysV shared memory", size, errno);
+         close(fd);
+         return false;
+      }
+
+      addr = use_thp ? map_aligned(fd, size, HUGE_PAGE_SIZE) :
+                       mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED)
+      {
+         WSI_LOG_WARNING("Failed to map memfd: errno=%d, using SysV shared memory", errno);
+         close(fd);
+         return false;
+      }
+
+      if (use_thp)
+      {
+         madvise(addr, size, MADV_HUGEPAGE);
+      }
+   }
+
+   segment.seg = xcb_generate_id(m_connection);
+   segment.addr = addr;
+   segment.size = size;
+   segment.memfd = true;
+
+   /* xcb closes the fd once sent, the server keeps its own mapping and the memory goes with the last one. */
+   xcb_shm_attach_fd(m_connection, segment.seg, fd, 0);
+   return true;
+}
+
+bool shm_segment_pool::create_sysv_segment(size_t size, size_t alignment, shm_segment &segment)
+{
+   const int shm_id = shmget(IPC_PRIVATE, size, IPC_CREAT | SHM_PERMISSIONS);
+   if (shm_id < 0)
+   {
+      WSI_LOG_ERROR("Failed to create shared memory segment of size %zu", size);
+      return false;
+   }
+
+   void *addr = shmat(shm_id, nullptr, 0);
+   if (addr == (void *)-1)
+   {
+      WSI_LOG_ERROR("Failed to attach shared memory segment");
+      shmctl(shm_id, IPC_RMID, nullptr);
+      return false;
+   }
+
+   if (reinterpret_cast<uintptr_t>(addr) % alignment != 0)
+   {
+      WSI_LOG_WARNING("Shared memory segment at %p does not meet alignment %zu", addr, alignment);
+      shmdt(addr);
+      shmctl(shm_id, IPC_RMID, nullptr);
+      return false;
+   }
+
+   segment.seg = xcb_generate_id(m_connection);
+   segment.addr = addr;
+   segment.size = size;
+   segment.memfd = false;
+   xcb_shm_attach(m_connection, segment.seg, shm_id, 0);
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_unsynced_ids.push_back(shm_id);
+   return true;
+}
+
+void shm_segment_pool::release(shm_segment &segment)
+{
+   if (segment.seg == XCB_NONE)
+   {
+      return;
+   }
+
+   std::vector<shm_segment> evicted;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_free.push_back(segment);
+      m_free_bytes += segment.size;
+
+      size_t evict_count = 0;
+      while (m_free_bytes > m_max_free_bytes && evict_count < m_free.size())
+      {
+         m_free_bytes -= m_free[evict_count].size;
+         evict_count++;
+      }
+      evicted.assign(m_free.begin(), m_free.begin() + evict_count);
+      m_free.erase(m_free.begin(), m_free.begin() + evict_count);
+   }
+
+   for (auto &old_segment : evicted)
+   {
+      destroy(old_segment);
+   }
+   segment = {};
+}
+
+void shm_segment_pool::sync()
+{
+   std::vector<int> ids;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      ids.swap(m_unsynced_ids);
+   }
+
+   if (ids.empty())
+   {
+      return;
+   }
+
+   /* Requests are processed in order, so once this reply arrives every earlier attachment has been made. */
+   xcb_get_input_focus_reply_t *reply =
+      xcb_get_input_focus_reply(m_connection, xcb_get_input_focus(m_connection), nullptr);
+   free(reply);
+
+   for (int shm_id : ids)
+   {
+      shmctl(shm_id, IPC_RMID, nullptr);
+   }
+}
+
+void shm_segment_pool::destroy(shm_segment &segment)
+{
+   xcb_shm_detach(m_connection, segment.seg);
+   if (segment.memfd)
+   {
+      munmap(segment.addr, segment.size);
+   }
+   else
+   {
+      shmdt(segment.addr);
+   }
+   segment = {};
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
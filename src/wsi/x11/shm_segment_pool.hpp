@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file shm_segment_pool.hpp
+ *
+ * @brief Pool of MIT-SHM segments attached to an X11 connection, reused across swapchains of a surface.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+namespace wsi
+{
+namespace x11
+{
+
+/**
+ * @brief Shared memory mapped in the process and attached to the server.
+ */
+struct shm_segment
+{
+   xcb_shm_seg_t seg = XCB_NONE;
+   void *addr = nullptr;
+   size_t size = 0;
+   /* Mapped from a memfd passed to the server rather than from a SysV segment. */
+   bool memfd = false;
+};
+
+/**
+ * @brief Segments released by a swapchain are kept attached and handed to the next one on the same connection.
+ *
+ * Recreating a swapchain on resize would otherwise create, map and attach every segment again and wait for the
+ * server after each attachment. Segments are allocated in size classes so that a slightly larger window can still
+ * take over the segments of the previous swapchain. MALI_WRAPPER_X11_SHM_POOL_MB caps the memory kept unused.
+ *
+ * With MIT-SHM 1.2 segments are memfds passed to the server, which are not bound by the SysV shmmax/shmall limits and
+ * can be backed by huge pages, see MALI_WRAPPER_X11_SHM_HUGEPAGES. Older servers get SysV segments.
+ *
+ * Owned by the surface, whose connection must stay valid for its whole lifetime. Thread safe.
+ */
+class shm_segment_pool
+{
+public:
+   explicit shm_segment_pool(xcb_connection_t *connection);
+   ~shm_segment_pool();
+
+   shm_segment_pool(const shm_segment_pool &) = delete;
+   shm_segment_pool &operator=(const shm_segment_pool &) = delete;
+
+   /**
+    * @brief Allocate memfd segments from now on, for servers implementing MIT-SHM 1.2 or later.
+    */
+   void enable_attach_fd();
+
+   /**
+    * @brief Take a segment of at least @p size bytes, reusing a released one when one fits.
+    *
+    * New SysV segments are attached without waiting for the server, call sync() once a batch has been acquired.
+    *
+    * @param alignment Alignment the segment address must satisfy.
+    *
+    * @return true on success, false if no segment could be created.
+    */
+   bool acquire(size_t size, size_t alignment, shm_segment &segment);
+
+   /**
+    * @brief Give a segment back once the server no longer reads it and nothing else maps its memory.
+    */
+   void release(shm_segment &segment);
+
+   /**
+    * @brief Wait once for the server to attach every new SysV segment, then mark them for removal.
+    *
+    * Until then a crash would leak the segments, so this should follow each batch of acquisitions.
+    */
+   void sync();
+
+private:
+   enum class huge_pages
+   {
+      none,
+      /* Transparent huge pages requested with madvise, used when the kernel enables them for shmem. */
+      transparent,
+      /* Pages from the hugetlbfs reserve, falling back to transparent ones when it is empty. */
+      hugetlb,
+   };
+
+   bool create_memfd_segment(size_t size, shm_segment &segment);
+   bool create_sysv_segment(size_t size, size_t alignment, shm_segment &segment);
+   void destroy(shm_segment &segment);
+
+   xcb_connection_t *m_connection;
+   size_t m_max_free_bytes;
+   bool m_attach_fd = false;
+   huge_pages m_huge_pages = huge_pages::transparent;
+
+   std::mutex m_mutex;
+   /* Oldest first, so the cap evicts segments that have not been reused for longest. */
+   std::vector<shm_segment> m_free;
+   size_t m_free_bytes = 0;
+   /* Ids of segments the server may not have attached yet. */
+   std::vector<int> m_unsynced_ids;
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
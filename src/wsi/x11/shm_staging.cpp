@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file shm_staging.cpp
+ *
+ * @brief Ring of MIT-SHM staging buffers shared by all images of an X11 swapchain.
+ */
+
+#include "shm_staging.hpp"
+#include "present_backend.hpp"
+#include "utils/logging.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <xcb/xcbext.h>
+
+namespace wsi
+{
+namespace x11
+{
+
+static constexpr uint32_t DEFAULT_STAGING_SLOTS = 3;
+static constexpr uint32_t MIN_STAGING_SLOTS = 2;
+static constexpr uint32_t MAX_STAGING_SLOTS = 8;
+
+/**
+ * @brief Number of slots, three lets a copy, a server upload and a scanout overlap.
+ */
+static uint32_t get_staging_slot_count()
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_STAGING_SLOTS");
+   if (env == nullptr)
+   {
+      return DEFAULT_STAGING_SLOTS;
+   }
+
+   const long count = std::strtol(env, nullptr, 10);
+   return static_cast<uint32_t>(
+      std::clamp<long>(count, static_cast<long>(MIN_STAGING_SLOTS), static_cast<long>(MAX_STAGING_SLOTS)));
+}
+
+/**
+ * @brief Add @p damage to @p into, as the whole frame once the rectangles would have to be folded together.
+ */
+static void merge_damage(damage_region &into, const damage_region &damage)
+{
+   if (damage.is_full() || into.count() + damage.count() > damage_region::MAX_RECTS)
+   {
+      into.set_full();
+      return;
+   }
+
+   for (uint32_t i = 0; i < damage.count(); i++)
+   {
+      into.add(damage.rect(i));
+   }
+   into.optimize();
+}
+
+shm_staging_ring::~shm_staging_ring()
+{
+   for (auto &slot : m_slots)
+   {
+      wait_slot(slot);
+      destroy_slot(slot);
+   }
+}
+
+void shm_staging_ring::init(xcb_connection_t *connection, xcb_window_t window, present_backend *backend,
+                            shm_segment_pool *pool, bool pixmaps)
+{
+   m_connection = connection;
+   m_window = window;
+   m_backend = backend;
+   m_pool = pool;
+   m_pixmaps = pixmaps || backend != nullptr;
+   m_slots.resize(get_staging_slot_count());
+}
+
+bool shm_staging_ring::ensure_slot(staging_slot &slot, size_t size, uint16_t width, uint16_t height, uint8_t depth)
+{
+   if (slot.segment.size < size)
+   {
+      destroy_slot(slot);
+      slot.stale = damage_region(width, height);
+      slot.stale.set_full();
+      if (!m_pool->acquire(size, 1, slot.segment))
+      {
+         WSI_LOG_ERROR("Failed to allocate staging segment of size %zu", size);
+         return false;
+      }
+   }
+
+   if (m_pixmaps && (slot.pixmap == XCB_PIXMAP_NONE || slot.width != width || slot.height != height))
+   {
+      if (m_backend != nullptr)
+      {
+         m_backend->destroy_pixmap(slot.pixmap);
+         slot.pixmap = m_backend->create_pixmap(slot.segment.seg, 0, width, height, depth);
+      }
+      else
+      {
+         if (slot.pixmap != XCB_PIXMAP_NONE)
+         {
+            xcb_free_pixmap(m_connection, slot.pixmap);
+         }
+         slot.pixmap = xcb_generate_id(m_connection);
+         xcb_shm_create_pixmap(m_connection, slot.pixmap, m_window, width, height, depth, slot.segment.seg, 0);
+      }
+      slot.width = width;
+      slot.height = height;
+      slot.stale = damage_region(width, height);
+      slot.stale.set_full();
+   }
+
+   return true;
+}
+
+void shm_staging_ring::destroy_slot(staging_slot &slot)
+{
+   if (slot.pixmap != XCB_PIXMAP_NONE)
+   {
+      if (m_backend != nullptr)
+      {
+         m_backend->destroy_pixmap(slot.pixmap);
+      }
+      else
+      {
+         xcb_free_pixmap(m_connection, slot.pixmap);
+      }
+      slot.pixmap = XCB_PIXMAP_NONE;
+   }
+
+   m_pool->release(slot.segment);
+}
+
+bool shm_staging_ring::wait_slot(staging_slot &slot)
+{
+   if (m_backend != nullptr && !slot.read_pending)
+   {
+      return m_backend->wait_idle(slot.pixmap);
+   }
+
+   if (!slot.read_pending)
+   {
+      return true;
+   }
+   slot.read_pending = false;
+
+   /* The reply is queued behind the slot's puts, so normally it arrived while the rest of the ring was in use. */
+   xcb_get_input_focus_reply_t *reply = xcb_get_input_focus_reply(m_connection, slot.read_cookie, nullptr);
+   if (reply == nullptr)
+   {
+      return false;
+   }
+   free(reply);
+   return true;
+}
+
+bool shm_staging_ring::reserve(size_t size, uint16_t width, uint16_t height, uint8_t depth)
+{
+   for (auto &slot : m_slots)
+   {
+      if (!wait_slot(slot) || !ensure_slot(slot, size, width, height, depth))
+      {
+         return false;
+      }
+   }
+
+   /* A single round trip covers the segments of every slot. */
+   m_pool->sync();
+   return true;
+}
+
+staging_slot *shm_staging_ring::acquire(size_t size, uint16_t width, uint16_t height, uint8_t depth)
+{
+   staging_slot &slot = m_slots[m_next_slot];
+   m_next_slot = (m_next_slot + 1) % m_slots.size();
+
+   if (!wait_slot(slot))
+   {
+      WSI_LOG_ERROR("Lost the X connection while waiting for a staging buffer");
+      return nullptr;
+   }
+
+   if (!ensure_slot(slot, size, width, height, depth))
+   {
+      return nullptr;
+   }
+   m_pool->sync();
+   return &slot;
+}
+
+bool shm_staging_ring::is_next_slot_ready()
+{
+   if (m_slots.empty())
+   {
+      return true;
+   }
+
+   staging_slot &slot = m_slots[m_next_slot];
+   if (!slot.read_pending)
+   {
+      return m_backend == nullptr || m_backend->is_idle(slot.pixmap);
+   }
+
+   void *reply = nullptr;
+   xcb_generic_error_t *error = nullptr;
+   if (!xcb_poll_for_reply(m_connection, slot.read_cookie.sequence, &reply, &error))
+   {
+      return false;
+   }
+
+   /* Also taken when the connection broke, acquire() then fails on its own. */
+   free(reply);
+   free(error);
+   slot.read_pending = false;
+   return true;
+}
+
+void shm_staging_ring::release(staging_slot &slot)
+{
+   slot.read_cookie = xcb_get_input_focus(m_connection);
+   slot.read_pending = true;
+}
+
+damage_region shm_staging_ring::take_damage(staging_slot &slot, const damage_region &damage)
+{
+   damage_region copied = slot.stale;
+   merge_damage(copied, damage);
+   slot.stale = damage_region(slot.width, slot.height);
+
+   for (auto &other : m_slots)
+   {
+      if (&other != &slot)
+      {
+         merge_damage(other.stale, damage);
+      }
+   }
+   return copied;
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
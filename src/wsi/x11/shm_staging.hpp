@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file shm_staging.hpp
+ *
+ * @brief Ring of MIT-SHM staging buffers shared by all images of an X11 swapchain.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+
+#include "present_damage.hpp"
+#include "shm_segment_pool.hpp"
+
+namespace wsi
+{
+namespace x11
+{
+
+class present_backend;
+
+/**
+ * @brief One staging buffer of the ring.
+ */
+struct staging_slot
+{
+   shm_segment segment;
+
+   /* Pixmap over the segment when presenting through the Present extension or compositing with RENDER, sized for
+    * the last frame. */
+   xcb_pixmap_t pixmap = XCB_PIXMAP_NONE;
+   uint16_t width = 0;
+   uint16_t height = 0;
+
+   /* Round trip queued behind the requests reading the slot, its reply means the server is done with them. */
+   xcb_get_input_focus_cookie_t read_cookie = {};
+   bool read_pending = false;
+
+   /* What changed in the frames written into other slots since this one was last written, see take_damage(). */
+   damage_region stale{ 0, 0 };
+};
+
+/**
+ * @brief Fixed depth ring of SHM segments that frames are copied into before the server reads them.
+ *
+ * Frames take slots in turn, so a frame only waits when the server has not yet finished the frame that used its slot
+ * a full ring earlier. Segments grow to the largest frame seen and are shared by every image of the swapchain
+ * instead of being owned per image. They come from the surface's segment pool and go back to it with the ring, so
+ * the next swapchain of the surface starts with them.
+ */
+class shm_staging_ring
+{
+public:
+   shm_staging_ring() = default;
+   ~shm_staging_ring();
+
+   shm_staging_ring(const shm_staging_ring &) = delete;
+   shm_staging_ring &operator=(const shm_staging_ring &) = delete;
+
+   /**
+    * @brief Set up the ring, MALI_WRAPPER_X11_STAGING_SLOTS overrides the number of slots.
+    *
+    * @param backend Present extension backend whose pixmaps and idle events track the slots, or nullptr to track
+    *                them with a round trip after SHM puts.
+    * @param pool    Pool the segments are taken from and returned to.
+    * @param pixmaps Whether slots need pixmaps without @p backend too, for requests other than SHM puts.
+    */
+   void init(xcb_connection_t *connection, xcb_window_t window, present_backend *backend, shm_segment_pool *pool,
+             bool pixmaps);
+
+   /**
+    * @brief Make every slot large enough for frames of the given size, so the first frames do not allocate.
+    */
+   bool reserve(size_t size, uint16_t width, uint16_t height, uint8_t depth);
+
+   /**
+    * @brief Take the next slot, waiting until the server no longer reads it.
+    *
+    * @return The slot, or nullptr if it could not be allocated or the window is gone.
+    */
+   staging_slot *acquire(size_t size, uint16_t width, uint16_t height, uint8_t depth);
+
+   /**
+    * @brief Whether acquire() would get its slot without waiting for the server, polling the slot's round trip.
+    */
+   bool is_next_slot_ready();
+
+   /**
+    * @brief Mark the slot as read by the requests sent so far. Not needed when the slot's pixmap was presented
+    *        through Present, whose idle events track it.
+    */
+   void release(staging_slot &slot);
+
+   /**
+    * @brief Region to copy into a slot for a frame with @p damage, when the server reads the whole slot.
+    *
+    * That is @p damage plus whatever the frames written into the other slots changed since this slot was last
+    * written, or the whole frame if that does not fit damage_region::MAX_RECTS rectangles. The other slots are marked
+    * as missing @p damage in turn.
+    */
+   damage_region take_damage(staging_slot &slot, const damage_region &damage);
+
+private:
+   bool ensure_slot(staging_slot &slot, size_t size, uint16_t width, uint16_t height, uint8_t depth);
+   void destroy_slot(staging_slot &slot);
+   bool wait_slot(staging_slot &slot);
+
+   xcb_connection_t *m_connection = nullptr;
+   xcb_window_t m_window = XCB_NONE;
+   present_backend *m_backend = nullptr;
+   shm_segment_pool *m_pool = nullptr;
+   bool m_pixmaps = false;
+
+   std::vector<staging_slot> m_slots;
+   uint32_t m_next_slot = 0;
+};
+
+} /* namespace x11 */
+} /* namespace wsi */
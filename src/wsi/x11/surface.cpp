@@ -26,6 +26,18 @@
  * @brief Implementation of a x11 WSI Surface
  */
 
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/shm.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 #include <xcb/xcb.h>
 #include <xcb/xproto.h>
 #include <xcb/shm.h>
@@ -43,13 +55,188 @@ struct surface::init_parameters
    const util::allocator &allocator;
    xcb_connection_t *connection;
    xcb_window_t window;
+   /* Owned by the surface once passed, nullptr to present over connection. */
+   xcb_connection_t *private_connection;
 };
 
+static bool is_private_connection_allowed()
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_PRIVATE_CONNECTION");
+   return env == nullptr || std::strcmp(env, "0") != 0;
+}
+
+/**
+ * @brief Whether MIT-SHM may be used. Set MALI_WRAPPER_X11_SHM=0 to send frames over the connection instead.
+ */
+static bool is_shm_allowed()
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_SHM");
+   return env == nullptr || std::strcmp(env, "0") != 0;
+}
+
+/**
+ * @brief Whether frames of hidden windows are skipped. Set MALI_WRAPPER_X11_SKIP_HIDDEN=0 to always copy them.
+ */
+static bool is_visibility_tracking_allowed()
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_SKIP_HIDDEN");
+   return env == nullptr || std::strcmp(env, "0") != 0;
+}
+
+/**
+ * @brief Check that the server can attach memory of ours, costing one round trip.
+ *
+ * Servers announce MIT-SHM to remote clients too, and a server in another IPC namespace cannot find SysV segments, so
+ * the extension being there is not enough.
+ *
+ * @param attach_fd Probe with a memfd passed over the socket, for MIT-SHM 1.2, rather than a SysV segment.
+ */
+static bool can_attach_shm(xcb_connection_t *connection, bool attach_fd)
+{
+   constexpr size_t PROBE_SIZE = 4096;
+   const xcb_shm_seg_t seg = xcb_generate_id(connection);
+   xcb_void_cookie_t cookie;
+   int shm_id = -1;
+
+   if (attach_fd)
+   {
+      const int fd = memfd_create("mali-wsi-shm-probe", MFD_CLOEXEC);
+      if (fd < 0 || ftruncate(fd, PROBE_SIZE) != 0)
+      {
+         if (fd >= 0)
+         {
+            close(fd);
+         }
+         return false;
+      }
+      /* libxcb closes the descriptor once it is sent. */
+      cookie = xcb_shm_attach_fd_checked(connection, seg, fd, 1);
+   }
+   else
+   {
+      shm_id = shmget(IPC_PRIVATE, PROBE_SIZE, IPC_CREAT | 0600);
+      if (shm_id < 0)
+      {
+         return false;
+      }
+      cookie = xcb_shm_attach_checked(connection, seg, shm_id, 1);
+   }
+
+   xcb_generic_error_t *error = xcb_request_check(connection, cookie);
+   if (shm_id >= 0)
+   {
+      shmctl(shm_id, IPC_RMID, nullptr);
+   }
+
+   if (error != nullptr)
+   {
+      free(error);
+      return false;
+   }
+
+   xcb_shm_detach(connection, seg);
+   return true;
+}
+
+/**
+ * @brief Work out a display name reaching the server at the other end of @p connection.
+ *
+ * Connections carry no display name, so it is derived from the socket address, X11 servers listening on
+ * /tmp/.X11-unix/X<n> or TCP port 6000 + n. $DISPLAY is the fallback for anything else.
+ */
+static std::string get_display_name(xcb_connection_t *connection)
+{
+   sockaddr_storage address = {};
+   socklen_t length = sizeof(address);
+   if (getpeername(xcb_get_file_descriptor(connection), reinterpret_cast<sockaddr *>(&address), &length) == 0)
+   {
+      if (address.ss_family == AF_UNIX)
+      {
+         /* Abstract socket names start with a NUL byte instead of a '/'. */
+         const auto *unix_address = reinterpret_cast<const sockaddr_un *>(&address);
+         const size_t path_offset = offsetof(sockaddr_un, sun_path);
+         const char *path = unix_address->sun_path;
+         size_t path_length = length > path_offset ? length - path_offset : 0;
+         if (path_length > 0 && path[0] == '\0')
+         {
+            path++;
+            path_length--;
+         }
+
+         const std::string socket_path(path, strnlen(path, path_length));
+         static const std::string x11_socket_prefix = "/tmp/.X11-unix/X";
+         if (socket_path.compare(0, x11_socket_prefix.size(), x11_socket_prefix) == 0 &&
+             socket_path.size() > x11_socket_prefix.size())
+         {
+            return ":" + socket_path.substr(x11_socket_prefix.size());
+         }
+      }
+      else if (address.ss_family == AF_INET)
+      {
+         const auto *inet_address = reinterpret_cast<const sockaddr_in *>(&address);
+         char host[INET_ADDRSTRLEN];
+         const int display = ntohs(inet_address->sin_port) - 6000;
+         if (display >= 0 && inet_ntop(AF_INET, &inet_address->sin_addr, host, sizeof(host)) != nullptr)
+         {
+            return std::string(host) + ":" + std::to_string(display);
+         }
+      }
+   }
+
+   const char *display = std::getenv("DISPLAY");
+   return display != nullptr ? display : "";
+}
+
+/**
+ * @brief Open a second connection to the server of @p connection, on which @p window is visible.
+ *
+ * @return The connection, or nullptr if it could not be opened or reaches another server.
+ */
+static xcb_connection_t *open_private_connection(xcb_connection_t *connection, xcb_window_t window)
+{
+   const std::string display_name = get_display_name(connection);
+   if (display_name.empty())
+   {
+      return nullptr;
+   }
+
+   xcb_connection_t *private_connection = xcb_connect(display_name.c_str(), nullptr);
+   if (xcb_connection_has_error(private_connection))
+   {
+      WSI_LOG_WARNING("Could not open a presentation connection to %s", display_name.c_str());
+      xcb_disconnect(private_connection);
+      return nullptr;
+   }
+
+   /* A reused display number may belong to another server, the window's root tells them apart. */
+   auto *app_geometry = xcb_get_geometry_reply(connection, xcb_get_geometry(connection, window), nullptr);
+   auto *private_geometry =
+      xcb_get_geometry_reply(private_connection, xcb_get_geometry(private_connection, window), nullptr);
+   const bool same_server =
+      app_geometry != nullptr && private_geometry != nullptr && app_geometry->root == private_geometry->root;
+   free(app_geometry);
+   free(private_geometry);
+
+   if (!same_server)
+   {
+      WSI_LOG_WARNING("%s does not show window 0x%x, presenting over the application's connection",
+                      display_name.c_str(), window);
+      xcb_disconnect(private_connection);
+      return nullptr;
+   }
+
+   return private_connection;
+}
+
 surface::surface(const init_parameters &params)
    : wsi::surface()
    , m_connection(params.connection)
    , m_window(params.window)
+   , m_private_connection(params.private_connection)
+   , m_present_connection(params.private_connection != nullptr ? params.private_connection : params.connection)
    , properties(this, params.allocator)
+   , m_shm_pool(m_present_connection)
+   , m_output_model(m_present_connection)
 {
 }
 
@@ -59,18 +246,42 @@ surface::~surface()
 
 bool surface::init()
 {
-   auto shm_cookie = xcb_shm_query_version_unchecked(m_connection);
-   auto shm_reply = xcb_shm_query_version_reply(m_connection, shm_cookie, nullptr);
+   auto shm_cookie = xcb_shm_query_version_unchecked(m_present_connection);
+   auto shm_reply = xcb_shm_query_version_reply(m_present_connection, shm_cookie, nullptr);
 
-   m_has_shm = shm_reply != nullptr;
+   /* MIT-SHM 1.2 takes segments as file descriptors, which only unix sockets can carry. */
+   const int fd = xcb_get_file_descriptor(m_present_connection);
+   sockaddr_storage address = {};
+   socklen_t length = sizeof(address);
+   const bool unix_socket =
+      getpeername(fd, reinterpret_cast<sockaddr *>(&address), &length) == 0 && address.ss_family == AF_UNIX;
+   const bool attach_fd = unix_socket && shm_reply != nullptr &&
+                          (shm_reply->major_version > 1 ||
+                           (shm_reply->major_version == 1 && shm_reply->minor_version >= 2));
+   m_has_shm = shm_reply != nullptr && is_shm_allowed() && can_attach_shm(m_present_connection, attach_fd);
    free(shm_reply);
+
+   if (m_has_shm && attach_fd)
+   {
+      m_shm_pool.enable_attach_fd();
+   }
+
+   /* Selecting the events on the application's connection would replace its own event mask. */
+   if (m_private_connection != nullptr && is_visibility_tracking_allowed())
+   {
+      m_visibility.init(m_present_connection, m_window);
+   }
+   if (m_private_connection != nullptr)
+   {
+      m_output_model.enable_change_notify();
+   }
    return true;
 }
 
 bool surface::get_size_and_depth(uint32_t *width, uint32_t *height, int *depth)
 {
-   auto cookie = xcb_get_geometry(m_connection, m_window);
-   if (auto *geom = xcb_get_geometry_reply(m_connection, cookie, nullptr))
+   auto cookie = xcb_get_geometry(m_present_connection, m_window);
+   if (auto *geom = xcb_get_geometry_reply(m_present_connection, cookie, nullptr))
    {
       *width = static_cast<uint32_t>(geom->width);
       *height = static_cast<uint32_t>(geom->height);
@@ -81,6 +292,51 @@ bool surface::get_size_and_depth(uint32_t *width, uint32_t *height, int *depth)
    return false;
 }
 
+bool surface::get_visual(xcb_visualtype_t *visual)
+{
+   auto cookie = xcb_get_window_attributes(m_present_connection, m_window);
+   auto *attributes = xcb_get_window_attributes_reply(m_present_connection, cookie, nullptr);
+   if (attributes == nullptr)
+   {
+      return false;
+   }
+
+   xcb_visualtype_t *visual_type = connection_get_visualtype(m_present_connection, attributes->visual);
+   free(attributes);
+   if (visual_type == nullptr)
+   {
+      return false;
+   }
+
+   *visual = *visual_type;
+   return true;
+}
+
+void surface::process_present_events()
+{
+   if (m_private_connection == nullptr)
+   {
+      return;
+   }
+
+   std::lock_guard<std::mutex> lock(m_event_mutex);
+   while (xcb_generic_event_t *event = xcb_poll_for_event(m_present_connection))
+   {
+      if (event->response_type == 0)
+      {
+         const auto *error = reinterpret_cast<xcb_generic_error_t *>(event);
+         WSI_LOG_DEBUG("Presentation request %u.%u failed with X error %u", error->major_code, error->minor_code,
+                       error->error_code);
+      }
+      else
+      {
+         m_visibility.handle_event(event);
+         m_output_model.handle_event(event);
+      }
+      free(event);
+   }
+}
+
 wsi::surface_properties &surface::get_properties()
 {
    return properties;
@@ -112,7 +368,10 @@ util::unique_ptr<surface> surface::make_surface(const util::allocator &allocator
       WSI_LOG_WARNING("Window 0x%x query returned NULL during surface creation\n", window);
    }
 
-   init_parameters params{ allocator, conn, window };
+   xcb_connection_t *private_connection =
+      is_private_connection_allowed() ? open_private_connection(conn, window) : nullptr;
+
+   init_parameters params{ allocator, conn, window, private_connection };
    auto wsi_surface = allocator.make_unique<surface>(params);
    if (wsi_surface != nullptr)
    {
@@ -128,6 +387,10 @@ util::unique_ptr<surface> surface::make_surface(const util::allocator &allocator
    else
    {
       WSI_LOG_ERROR("Failed to allocate surface for window 0x%x\n", window);
+      if (private_connection != nullptr)
+      {
+         xcb_disconnect(private_connection);
+      }
    }
    return nullptr;
 }
@@ -27,12 +27,17 @@
  */
 
 #pragma once
+#include <memory>
+#include <mutex>
 #include <vulkan/vk_icd.h>
 #include <xcb/xcb.h>
 #include <xcb/xproto.h>
 #include <xcb/shm.h>
 #include "wsi/surface.hpp"
 #include "surface_properties.hpp"
+#include "shm_segment_pool.hpp"
+#include "randr_outputs.hpp"
+#include "window_visibility.hpp"
 
 namespace wsi
 {
@@ -63,11 +68,55 @@ public:
 
    bool get_size_and_depth(uint32_t *width, uint32_t *height, int *depth);
 
+   /**
+    * @brief Get the visual of the window, which describes its pixel layout.
+    *
+    * @return true on success, false otherwise.
+    */
+   bool get_visual(xcb_visualtype_t *visual);
+
    xcb_connection_t *get_connection()
    {
       return m_connection;
    }
 
+   /**
+    * @brief Connection presentation requests go through.
+    *
+    * A private connection to the same display when one could be opened, so presenting neither contends with the
+    * application's event loop for the connection nor lands errors in its event queue. The application's connection
+    * otherwise, or with MALI_WRAPPER_X11_PRIVATE_CONNECTION=0.
+    */
+   xcb_connection_t *get_present_connection()
+   {
+      return m_present_connection;
+   }
+
+   /**
+    * @brief Whether get_present_connection() is a private connection, whose descriptor nothing but presentation reads.
+    */
+   bool has_private_connection() const
+   {
+      return m_private_connection != nullptr;
+   }
+
+   /**
+    * @brief Handle the events and errors queued on a private presentation connection, which nothing else reads.
+    *
+    * Visibility changes of the window and RandR configuration changes are recorded, everything else is discarded.
+    */
+   void process_present_events();
+
+   /**
+    * @brief Whether the window may be on screen as of the last process_present_events().
+    *
+    * Only tracked over a private presentation connection, always true otherwise.
+    */
+   bool is_window_visible() const
+   {
+      return m_visibility.is_visible();
+   }
+
    xcb_window_t get_window()
    {
       return m_window;
@@ -78,14 +127,50 @@ public:
       return m_has_shm;
    }
 
+   /**
+    * @brief SHM segments shared by the swapchains of the surface, so recreating one does not allocate them again.
+    */
+   shm_segment_pool &get_shm_pool()
+   {
+      return m_shm_pool;
+   }
+
+   /**
+    * @brief Layout of the connection's outputs, used to find the refresh rate of the output showing the window.
+    */
+   randr_output_model &get_output_model()
+   {
+      return m_output_model;
+   }
+
 private:
+   struct connection_deleter
+   {
+      void operator()(xcb_connection_t *connection) const
+      {
+         xcb_disconnect(connection);
+      }
+   };
+
    xcb_connection_t *m_connection;
    xcb_window_t m_window;
+
+   /* Declared ahead of the members using it, so that it is disconnected after they are gone. */
+   std::unique_ptr<xcb_connection_t, connection_deleter> m_private_connection;
+   xcb_connection_t *m_present_connection;
+
    /** Surface properties specific to the X11 surface. */
    surface_properties properties;
 
-   /** X11 extension capabilities */
+   /** Whether the server has MIT-SHM and can attach memory of this process. */
    bool m_has_shm = false;
+
+   shm_segment_pool m_shm_pool;
+   randr_output_model m_output_model;
+
+   /* Fed by process_present_events(), which may run on the presenting threads of several swapchains. */
+   std::mutex m_event_mutex;
+   window_visibility m_visibility;
 };
 
 } /* namespace x11 */
@@ -49,16 +49,21 @@ namespace x11
 
 void surface_properties::populate_present_mode_compatibilities()
 {
-   std::array<present_mode_compatibility, 2> compatible_present_modes_list = {
+   std::array<present_mode_compatibility, 4> compatible_present_modes_list = {
       present_mode_compatibility{ VK_PRESENT_MODE_FIFO_KHR, 1, { VK_PRESENT_MODE_FIFO_KHR } },
-      present_mode_compatibility{ VK_PRESENT_MODE_MAILBOX_KHR, 1, { VK_PRESENT_MODE_MAILBOX_KHR } }
+      present_mode_compatibility{ VK_PRESENT_MODE_MAILBOX_KHR, 1, { VK_PRESENT_MODE_MAILBOX_KHR } },
+      present_mode_compatibility{
+         VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR, 1, { VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR } },
+      present_mode_compatibility{
+         VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR, 1, { VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR } },
    };
-   m_compatible_present_modes = compatible_present_modes<2>(compatible_present_modes_list);
+   m_compatible_present_modes = compatible_present_modes<4>(compatible_present_modes_list);
 }
 
 surface_properties::surface_properties(surface *wsi_surface, const util::allocator &allocator)
    : specific_surface(wsi_surface)
-   , m_supported_modes({ VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR })
+   , m_supported_modes({ VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+                         VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR, VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR })
 {
    UNUSED(allocator);
    populate_present_mode_compatibilities();
@@ -86,6 +91,12 @@ VkResult surface_properties::get_surface_capabilities(VkPhysicalDevice physical_
    specific_surface->get_size_and_depth(&surface_capabilities->currentExtent.width,
                                         &surface_capabilities->currentExtent.height, &depth);
 
+   /* Rotated images are turned upright while copied for presentation, see shm_presenter::set_pre_transform. */
+   surface_capabilities->supportedTransforms = VK_SURFACE_TRANSFORM_IDENTITY_BIT_KHR |
+                                               VK_SURFACE_TRANSFORM_ROTATE_90_BIT_KHR |
+                                               VK_SURFACE_TRANSFORM_ROTATE_180_BIT_KHR |
+                                               VK_SURFACE_TRANSFORM_ROTATE_270_BIT_KHR;
+
    /* Composite alpha */
    surface_capabilities->supportedCompositeAlpha = static_cast<VkCompositeAlphaFlagBitsKHR>(
       VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR | VK_COMPOSITE_ALPHA_PRE_MULTIPLIED_BIT_KHR |
@@ -117,7 +128,10 @@ VkResult surface_properties::get_surface_capabilities(VkPhysicalDevice physical_
    return VK_SUCCESS;
 }
 
+/* Reported in reverse order. The RGBA formats are swizzled on the CPU, so they come last. */
 std::vector<VkFormat> support_formats {
+   VK_FORMAT_R8G8B8A8_UNORM,
+   VK_FORMAT_R8G8B8A8_SRGB,
    VK_FORMAT_B8G8R8A8_UNORM, 
    VK_FORMAT_B8G8R8A8_SRGB
 };
@@ -253,7 +267,7 @@ static xcb_visualtype_t *screen_get_visualtype(xcb_screen_t *screen, xcb_visuali
    return NULL;
 }
 
-static xcb_visualtype_t *connection_get_visualtype(xcb_connection_t *conn, xcb_visualid_t visual_id)
+xcb_visualtype_t *connection_get_visualtype(xcb_connection_t *conn, xcb_visualid_t visual_id)
 {
    xcb_screen_iterator_t screen_iter = xcb_setup_roots_iterator(xcb_get_setup(conn));
 
@@ -344,9 +358,14 @@ bool surface_properties::is_surface_extension_enabled(const wsi::instance_privat
 void surface_properties::get_surface_present_scaling_and_gravity(
    VkSurfacePresentScalingCapabilitiesEXT *scaling_capabilities)
 {
-   scaling_capabilities->supportedPresentScaling = 0;
-   scaling_capabilities->supportedPresentGravityX = 0;
-   scaling_capabilities->supportedPresentGravityY = 0;
+   /* The SHM presenter scales on the CPU, see shm_presenter::set_present_scaling. */
+   scaling_capabilities->supportedPresentScaling = VK_PRESENT_SCALING_ONE_TO_ONE_BIT_EXT |
+                                                   VK_PRESENT_SCALING_ASPECT_RATIO_STRETCH_BIT_EXT |
+                                                   VK_PRESENT_SCALING_STRETCH_BIT_EXT;
+   scaling_capabilities->supportedPresentGravityX =
+      VK_PRESENT_GRAVITY_MIN_BIT_EXT | VK_PRESENT_GRAVITY_MAX_BIT_EXT | VK_PRESENT_GRAVITY_CENTERED_BIT_EXT;
+   scaling_capabilities->supportedPresentGravityY =
+      VK_PRESENT_GRAVITY_MIN_BIT_EXT | VK_PRESENT_GRAVITY_MAX_BIT_EXT | VK_PRESENT_GRAVITY_CENTERED_BIT_EXT;
 }
 
 bool surface_properties::is_compatible_present_modes(VkPresentModeKHR present_mode_a, VkPresentModeKHR present_mode_b)
@@ -358,15 +377,12 @@ bool surface_properties::is_compatible_present_modes(VkPresentModeKHR present_mo
 void surface_properties::get_present_timing_surface_caps(
    VkPresentTimingSurfaceCapabilitiesEXT *present_timing_surface_caps)
 {
+   /* Only the refresh duration is measured, no per-present stage time is recorded or targeted. */
    present_timing_surface_caps->presentTimingSupported = VK_TRUE;
-   present_timing_surface_caps->presentAtAbsoluteTimeSupported = VK_TRUE;
-   present_timing_surface_caps->presentAtRelativeTimeSupported = VK_TRUE;
-   present_timing_surface_caps->presentStageQueries =
-      VK_PRESENT_STAGE_QUEUE_OPERATIONS_END_BIT_EXT | VK_PRESENT_STAGE_IMAGE_LATCHED_BIT_EXT |
-      VK_PRESENT_STAGE_IMAGE_FIRST_PIXEL_OUT_BIT_EXT | VK_PRESENT_STAGE_IMAGE_FIRST_PIXEL_VISIBLE_BIT_EXT;
-   present_timing_surface_caps->presentStageTargets = VK_PRESENT_STAGE_IMAGE_LATCHED_BIT_EXT |
-                                                      VK_PRESENT_STAGE_IMAGE_FIRST_PIXEL_OUT_BIT_EXT |
-                                                      VK_PRESENT_STAGE_IMAGE_FIRST_PIXEL_VISIBLE_BIT_EXT;
+   present_timing_surface_caps->presentAtAbsoluteTimeSupported = VK_FALSE;
+   present_timing_surface_caps->presentAtRelativeTimeSupported = VK_FALSE;
+   present_timing_surface_caps->presentStageQueries = VK_PRESENT_STAGE_QUEUE_OPERATIONS_END_BIT_EXT;
+   present_timing_surface_caps->presentStageTargets = 0;
 }
 #endif
 
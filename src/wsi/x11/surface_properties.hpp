@@ -24,6 +24,7 @@
 
 #pragma once
 
+#include <xcb/xcb.h>
 #include <wsi/surface_properties.hpp>
 #include <wsi/compatible_present_modes.hpp>
 
@@ -74,15 +75,22 @@ private:
    surface *specific_surface;
 
    /* List of supported presentation modes */
-   std::array<VkPresentModeKHR, 2> m_supported_modes;
+   std::array<VkPresentModeKHR, 4> m_supported_modes;
 
    /* Stores compatible presentation modes */
-   compatible_present_modes<2> m_compatible_present_modes;
+   compatible_present_modes<4> m_compatible_present_modes;
 
    void populate_present_mode_compatibilities() override;
 
    void get_surface_present_scaling_and_gravity(VkSurfacePresentScalingCapabilitiesEXT *scaling_capabilities) override;
 };
 
+/**
+ * @brief Find the visual type of @p visual_id on any screen of @p conn.
+ *
+ * @return The visual type, or nullptr if no screen has it.
+ */
+xcb_visualtype_t *connection_get_visualtype(xcb_connection_t *conn, xcb_visualid_t visual_id);
+
 } // namespace x11
 } // namespace wsi
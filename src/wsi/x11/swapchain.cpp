@@ -29,17 +29,20 @@
  */
 
 #include <cassert>
+#include <cerrno>
 #include <chrono>
+#include <climits>
 #include <condition_variable>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <system_error>
-#include <thread>
 
 #include <dlfcn.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <unistd.h>
 #include "../layer_utils/timed_semaphore.hpp"
@@ -54,21 +57,65 @@
 #include "utils/logging.hpp"
 #include "../layer_utils/macros.hpp"
 #include "wsi/external_memory.hpp"
+#include "wsi/host_memory_ranking.hpp"
 #include "wsi/swapchain_base.hpp"
 #include "wsi/extensions/present_id.hpp"
+#include "wsi/extensions/swapchain_maintenance.hpp"
 #include "shm_presenter.hpp"
+#include "present_timing_handler.hpp"
 
 namespace wsi
 {
 namespace x11
 {
 
-#define X11_SWAPCHAIN_MAX_PENDING_COMPLETIONS 128
+/**
+ * @brief Whether SHM segments may be imported as image memory. Set MALI_WRAPPER_X11_ZERO_COPY=0 to always copy.
+ */
+static bool is_zero_copy_allowed()
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_ZERO_COPY");
+   return env == nullptr || std::strcmp(env, "0") != 0;
+}
+
+/**
+ * @brief Whether applications render to optimal images copied on the GPU. Set MALI_WRAPPER_X11_GPU_COPY=1 to enable.
+ */
+static bool is_gpu_copy_requested()
+{
+   const char *env = std::getenv("MALI_WRAPPER_X11_GPU_COPY");
+   return env != nullptr && std::strcmp(env, "1") == 0;
+}
+
+/**
+ * @brief Whether the application keeps rendering to a single image that the presenter keeps reading.
+ */
+static bool is_shared_present_mode(VkPresentModeKHR present_mode)
+{
+   return present_mode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR ||
+          present_mode == VK_PRESENT_MODE_SHARED_CONTINUOUS_REFRESH_KHR;
+}
+
+/**
+ * @brief Format the GPU copy should produce, X11 TrueColor visuals being BGRX in practice.
+ */
+static VkFormat get_staging_format(VkFormat format)
+{
+   switch (format)
+   {
+   case VK_FORMAT_R8G8B8A8_UNORM:
+      return VK_FORMAT_B8G8R8A8_UNORM;
+   case VK_FORMAT_R8G8B8A8_SRGB:
+      return VK_FORMAT_B8G8R8A8_SRGB;
+   default:
+      return format;
+   }
+}
 
 swapchain::swapchain(wsi::device_private_data &dev_data, const VkAllocationCallbacks *pAllocator,
                      surface &wsi_surface)
    : swapchain_base(dev_data, pAllocator)
-   , m_connection(wsi_surface.get_connection())
+   , m_connection(wsi_surface.get_present_connection())
    , m_window(wsi_surface.get_window())
    , m_wsi_surface(&wsi_surface)
    , m_wsi_allocator(nullptr)
@@ -83,33 +130,21 @@ swapchain::swapchain(wsi::device_private_data &dev_data, const VkAllocationCallb
 
 swapchain::~swapchain()
 {
-   auto thread_status_lock = std::unique_lock<std::mutex>(m_thread_status_lock);
+   /* Call the base's teardown */
+   teardown();
 
-   if (m_present_event_thread_run)
+   if (m_copy_command_pool != VK_NULL_HANDLE)
    {
-      m_present_event_thread_run = false;
-      m_thread_status_cond.notify_all();
-      thread_status_lock.unlock();
-
-      if (m_present_event_thread.joinable())
-      {
-         m_present_event_thread.join();
-      }
-
-      thread_status_lock.lock();
+      m_device_data.disp.DestroyCommandPool(m_device, m_copy_command_pool, get_allocation_callbacks());
    }
-
-   thread_status_lock.unlock();
-
-   /* Call the base's teardown */
-   teardown();
 }
 
 VkResult swapchain::init_platform(VkDevice device, const VkSwapchainCreateInfoKHR *swapchain_create_info,
                                   bool &use_presentation_thread)
 {
    UNUSED(device);
-   UNUSED(swapchain_create_info);
+   m_memory_props = {};
+   m_memory_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
    m_device_data.instance_data.disp.GetPhysicalDeviceMemoryProperties2KHR(m_device_data.physical_device,
                                                                           &m_memory_props);
    if (m_wsi_surface == nullptr)
@@ -118,6 +153,9 @@ VkResult swapchain::init_platform(VkDevice device, const VkSwapchainCreateInfoKH
       return VK_ERROR_INITIALIZATION_FAILED;
    }
 
+   /* Copied frames are read back by the CPU, rank host memory before the images are allocated. */
+   probe_host_memory_read_speed(m_device_data);
+
    WSIALLOC_ASSERT_VERSION();
    if (wsialloc_new(&m_wsi_allocator) != WSIALLOC_ERROR_NONE)
    {
@@ -135,12 +173,27 @@ VkResult swapchain::init_platform(VkDevice device, const VkSwapchainCreateInfoKH
          return VK_ERROR_INITIALIZATION_FAILED;
       }
 
-      VkResult init_result = m_shm_presenter->init(m_connection, m_window, m_wsi_surface);
+      TRY_LOG_CALL(init_gpu_copy(swapchain_create_info));
+
+      /* The presenter reads whatever the GPU copy produced when there is one. */
+      const VkFormat presented_format =
+         m_copy_command_pool != VK_NULL_HANDLE ? m_staging_format : swapchain_create_info->imageFormat;
+      VkResult init_result = m_shm_presenter->init(m_connection, m_window, m_wsi_surface, presented_format);
       if (init_result != VK_SUCCESS)
       {
          WSI_LOG_ERROR("Failed to initialize SHM presenter");
          return init_result;
       }
+
+      auto *maintenance1 = get_swapchain_extension<wsi_ext_swapchain_maintenance1>();
+      if (maintenance1 != nullptr && maintenance1->get_scaling_behavior() != 0)
+      {
+         m_shm_presenter->set_present_scaling(maintenance1->get_scaling_behavior(),
+                                              maintenance1->get_present_gravity_x(),
+                                              maintenance1->get_present_gravity_y());
+      }
+
+      m_shm_presenter->set_pre_transform(swapchain_create_info->preTransform);
    }
    catch (const std::exception &e)
    {
@@ -149,25 +202,69 @@ VkResult swapchain::init_platform(VkDevice device, const VkSwapchainCreateInfoKH
       return VK_ERROR_INITIALIZATION_FAILED;
    }
 
-   try
+   /* Zero-copy images are SHM segments, which the server must be able to attach. */
+   if (m_device_data.is_device_extension_enabled(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) &&
+       is_zero_copy_allowed() && m_wsi_surface->has_shm())
    {
-      m_present_event_thread = std::thread(&swapchain::present_event_thread, this);
+      VkPhysicalDeviceExternalMemoryHostPropertiesEXT host_memory_props = {};
+      host_memory_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+      VkPhysicalDeviceProperties2KHR device_props = {};
+      device_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+      device_props.pNext = &host_memory_props;
+      m_device_data.instance_data.disp.GetPhysicalDeviceProperties2KHR(m_device_data.physical_device, &device_props);
+
+      m_host_pointer_alignment = host_memory_props.minImportedHostPointerAlignment;
    }
-   catch (const std::system_error &)
+
+   /*
+    * Page flipping is scheduled for every present mode, MAILBOX included, so vkQueuePresentKHR never waits for
+    * the copy, the server or frame pacing. For MAILBOX, page_flip() only presents the newest queued frame, for
+    * SHARED_CONTINUOUS_REFRESH it keeps presenting the shared image. SHARED_DEMAND_REFRESH is the exception: each
+    * present uploads the shared image right away, and there is nothing to queue since the image is never released.
+    */
+   use_presentation_thread = (m_present_mode != VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR);
+
+   return VK_SUCCESS;
+}
+
+VkResult swapchain::init_gpu_copy(const VkSwapchainCreateInfoKHR *swapchain_create_info)
+{
+   /* The copy only runs on presents, a continuously refreshed image would show the same frame over and over. */
+   if (!is_gpu_copy_requested() || is_shared_present_mode(m_present_mode))
    {
-      return VK_ERROR_INITIALIZATION_FAILED;
+      return VK_SUCCESS;
    }
-   catch (const std::bad_alloc &)
+
+   /* Channels are swapped by blitting, which both formats must support in the tiling they are used with. */
+   const VkFormat format = swapchain_create_info->imageFormat;
+   m_staging_format = get_staging_format(format);
+   if (m_staging_format != format)
    {
-      return VK_ERROR_INITIALIZATION_FAILED;
+      VkFormatProperties2KHR src_props = {};
+      src_props.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2_KHR;
+      m_device_data.instance_data.disp.GetPhysicalDeviceFormatProperties2KHR(m_device_data.physical_device, format,
+                                                                             &src_props);
+
+      VkFormatProperties2KHR dst_props = {};
+      dst_props.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2_KHR;
+      m_device_data.instance_data.disp.GetPhysicalDeviceFormatProperties2KHR(m_device_data.physical_device,
+                                                                             m_staging_format, &dst_props);
+
+      if ((src_props.formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) == 0 ||
+          (dst_props.formatProperties.linearTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) == 0)
+      {
+         m_staging_format = format;
+      }
    }
 
-   /*
-    * When VK_PRESENT_MODE_MAILBOX_KHR has been chosen by the application we don't
-    * initialize the page flip thread so the present_image function can be called
-    * during vkQueuePresent.
-    */
-   use_presentation_thread = (m_present_mode != VK_PRESENT_MODE_MAILBOX_KHR);
+   /* Like the swapchain's own queue, this assumes presents come from queue family 0, the only one Mali exposes. */
+   VkCommandPoolCreateInfo pool_info = {};
+   pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+   pool_info.queueFamilyIndex = 0;
+   TRY_LOG(m_device_data.disp.CreateCommandPool(m_device, &pool_info, get_allocation_callbacks(),
+                                                &m_copy_command_pool),
+           "Failed to create command pool for GPU copies");
 
    return VK_SUCCESS;
 }
@@ -420,9 +517,36 @@ VkResult swapchain::create_swapchain_image(VkImageCreateInfo image_create_info,
 
    if (m_shm_presenter)
    {
+      if (m_copy_command_pool != VK_NULL_HANDLE)
+      {
+         return create_gpu_copy_image(image_create_info, image, image_data);
+      }
+
+      if (m_host_pointer_alignment != 0)
+      {
+         VkResult result = create_zero_copy_image(image_create_info, image, image_data);
+         if (result == VK_SUCCESS)
+         {
+            return VK_SUCCESS;
+         }
+
+         WSI_LOG_WARNING("Importing SHM as image memory failed (%d), falling back to copied presentation", result);
+         image_data->external_mem.release_host_memory();
+         if (image.image != VK_NULL_HANDLE)
+         {
+            m_device_data.disp.DestroyImage(m_device, image.image, get_allocation_callbacks());
+            image.image = VK_NULL_HANDLE;
+         }
+         m_shm_presenter->destroy_image_resources(image_data);
+
+         /* Whatever made the driver reject this import applies to the remaining images too. */
+         m_host_pointer_alignment = 0;
+      }
+
+      /* The presenter invalidates before reading, so non-coherent memory qualifies when it reads back faster. */
       VkMemoryPropertyFlags optimal = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
                                       VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
-      VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+      VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
 
       TRY_LOG_CALL(image_data->external_mem.configure_for_host_visible(image_create_info, required, optimal));
 
@@ -438,47 +562,199 @@ VkResult swapchain::create_swapchain_image(VkImageCreateInfo image_create_info,
    }
 }
 
-void swapchain::present_event_thread()
+VkResult swapchain::create_zero_copy_image(VkImageCreateInfo image_create_info, swapchain_image &image,
+                                           x11_image_data *image_data)
 {
-   auto thread_status_lock = std::unique_lock<std::mutex>(m_thread_status_lock);
-   m_present_event_thread_run = true;
-
-   while (m_present_event_thread_run)
+   /* The server reads the segment as-is, so it must use the same 32bpp layout and orientation the GPU renders. */
+   uint32_t surface_width, surface_height;
+   int depth = 0;
+   if (!m_wsi_surface->get_size_and_depth(&surface_width, &surface_height, &depth) || (depth != 24 && depth != 32) ||
+       m_shm_presenter->needs_pixel_conversion() || m_shm_presenter->needs_rotation())
    {
-      auto assume_forward_progress = false;
+      return VK_ERROR_FORMAT_NOT_SUPPORTED;
+   }
 
-      for (auto &image : m_swapchain_images)
-      {
-         if (image.status == swapchain_image::INVALID)
-            continue;
+   VkExternalMemoryImageCreateInfoKHR external_info = {};
+   external_info.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO_KHR;
+   external_info.pNext = image_create_info.pNext;
+   external_info.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+   image_create_info.pNext = &external_info;
+   image_create_info.tiling = VK_IMAGE_TILING_LINEAR;
+   TRY(m_device_data.disp.CreateImage(m_device, &image_create_info, get_allocation_callbacks(), &image.image));
+
+   VkMemoryRequirements mem_requirements;
+   m_device_data.disp.GetImageMemoryRequirements(m_device, image.image, &mem_requirements);
+   const VkDeviceSize size =
+      (mem_requirements.size + m_host_pointer_alignment - 1) / m_host_pointer_alignment * m_host_pointer_alignment;
+
+   TRY(m_shm_presenter->create_zero_copy_segment(image_data, size, m_host_pointer_alignment));
+
+   VkMemoryPropertyFlags optimal = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                   VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+   VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+   image_data->external_mem.configure_for_host_pointer(image_data->shm_addr, size, required, optimal);
+   TRY(image_data->external_mem.allocate_and_bind_image(image.image, image_create_info));
+
+   image_data->zero_copy = true;
+   return VK_SUCCESS;
+}
 
-         auto data = reinterpret_cast<x11_image_data *>(image.data);
-         if (data->pending_completions.size() != 0)
+VkResult swapchain::create_gpu_copy_image(VkImageCreateInfo image_create_info, swapchain_image &image,
+                                          x11_image_data *image_data)
+{
+   /* Only the first layer is presented, so that is all the staging image holds. */
+   VkImageCreateInfo staging_create_info = image_create_info;
+   staging_create_info.pNext = nullptr;
+   staging_create_info.flags = 0;
+   staging_create_info.format = m_staging_format;
+   staging_create_info.arrayLayers = 1;
+   staging_create_info.tiling = VK_IMAGE_TILING_LINEAR;
+   staging_create_info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+   staging_create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+   staging_create_info.queueFamilyIndexCount = 0;
+   staging_create_info.pQueueFamilyIndices = nullptr;
+
+   VkMemoryPropertyFlags optimal = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                   VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+   VkMemoryPropertyFlags required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+   TRY_LOG_CALL(image_data->external_mem.configure_for_host_visible(staging_create_info, required, optimal));
+   TRY_LOG(m_device_data.disp.CreateImage(m_device, &staging_create_info, get_allocation_callbacks(),
+                                          &image_data->staging_image),
+           "Failed to create staging image");
+   TRY_LOG_CALL(image_data->external_mem.allocate_and_bind_image(image_data->staging_image, staging_create_info));
+
+   image_create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+   image_create_info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+   TRY_LOG(m_device_data.disp.CreateImage(m_device, &image_create_info, get_allocation_callbacks(), &image.image),
+           "Failed to create image for GPU copies");
+
+   VkMemoryRequirements mem_requirements;
+   m_device_data.disp.GetImageMemoryRequirements(m_device, image.image, &mem_requirements);
+
+   VkMemoryAllocateInfo alloc_info = {};
+   alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+   alloc_info.allocationSize = mem_requirements.size;
+   alloc_info.memoryTypeIndex = UINT32_MAX;
+
+   const VkMemoryPropertyFlags props_to_try[] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 };
+   for (VkMemoryPropertyFlags props : props_to_try)
+   {
+      for (uint32_t i = 0; i < m_memory_props.memoryProperties.memoryTypeCount; i++)
+      {
+         if ((mem_requirements.memoryTypeBits & (1u << i)) != 0 &&
+             (m_memory_props.memoryProperties.memoryTypes[i].propertyFlags & props) == props)
          {
-            assume_forward_progress = true;
+            alloc_info.memoryTypeIndex = i;
             break;
          }
       }
-
-      if (!assume_forward_progress)
-      {
-         m_thread_status_cond.wait(thread_status_lock);
-         continue;
-      }
-
-      if (error_has_occured())
+      if (alloc_info.memoryTypeIndex != UINT32_MAX)
       {
          break;
       }
+   }
+   if (alloc_info.memoryTypeIndex == UINT32_MAX)
+   {
+      return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+   }
+
+   TRY_LOG(m_device_data.disp.AllocateMemory(m_device, &alloc_info, get_allocation_callbacks(),
+                                             &image_data->render_memory),
+           "Failed to allocate image memory for GPU copies");
+   TRY_LOG(m_device_data.disp.BindImageMemory(m_device, image.image, image_data->render_memory, 0),
+           "Failed to bind image memory for GPU copies");
+
+   return record_gpu_copy(image.image, image_create_info, image_data);
+}
+
+VkResult swapchain::record_gpu_copy(VkImage image, const VkImageCreateInfo &image_create_info,
+                                    x11_image_data *image_data)
+{
+   VkCommandBufferAllocateInfo alloc_info = {};
+   alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+   alloc_info.commandPool = m_copy_command_pool;
+   alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+   alloc_info.commandBufferCount = 1;
+   TRY_LOG(m_device_data.disp.AllocateCommandBuffers(m_device, &alloc_info, &image_data->copy_command_buffer),
+           "Failed to allocate command buffer for GPU copies");
+   VkCommandBuffer command_buffer = image_data->copy_command_buffer;
+   if (m_device_data.SetDeviceLoaderData)
+   {
+      TRY_LOG_CALL(m_device_data.SetDeviceLoaderData(m_device, command_buffer));
+   }
+
+   /* Submitted again on every present of the image, never while the previous submission is pending. */
+   VkCommandBufferBeginInfo begin_info = {};
+   begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+   TRY(m_device_data.disp.BeginCommandBuffer(command_buffer, &begin_info));
 
-      thread_status_lock.unlock();
+   const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+   const VkImageSubresourceLayers layers = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
 
-      thread_status_lock.lock();
-      std::this_thread::sleep_for(std::chrono::milliseconds(1)); // Short polling interval
+   /*
+    * The present semaphores block the transfer stage, which chains them to the application's rendering. The staging
+    * image was last read by the presenter before the image could be presented again, so its contents can go.
+    */
+   VkImageMemoryBarrier to_transfer[2] = {};
+   to_transfer[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+   to_transfer[0].srcAccessMask = 0;
+   to_transfer[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+   to_transfer[0].oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+   to_transfer[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+   to_transfer[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   to_transfer[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+   to_transfer[0].image = image;
+   to_transfer[0].subresourceRange = range;
+   to_transfer[1] = to_transfer[0];
+   to_transfer[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+   to_transfer[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+   to_transfer[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+   to_transfer[1].image = image_data->staging_image;
+   m_device_data.disp.CmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                         VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, to_transfer);
+
+   const uint32_t width = image_create_info.extent.width;
+   const uint32_t height = image_create_info.extent.height;
+   if (m_staging_format == image_create_info.format)
+   {
+      VkImageCopy region = {};
+      region.srcSubresource = layers;
+      region.dstSubresource = layers;
+      region.extent = { width, height, 1 };
+      m_device_data.disp.CmdCopyImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                      image_data->staging_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+   }
+   else
+   {
+      /* Same size on both sides, so the blit only swaps channels. */
+      VkImageBlit region = {};
+      region.srcSubresource = layers;
+      region.srcOffsets[1] = { static_cast<int32_t>(width), static_cast<int32_t>(height), 1 };
+      region.dstSubresource = layers;
+      region.dstOffsets[1] = region.srcOffsets[1];
+      m_device_data.disp.CmdBlitImage(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                      image_data->staging_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region,
+                                      VK_FILTER_NEAREST);
    }
 
-   m_present_event_thread_run = false;
-   m_thread_status_cond.notify_all();
+   /* Hand the image back in the layout it was presented in, and the copy to the presenter's reads. */
+   VkImageMemoryBarrier after_transfer[2] = {};
+   after_transfer[0] = to_transfer[0];
+   after_transfer[0].dstAccessMask = 0;
+   after_transfer[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+   after_transfer[0].newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+   after_transfer[1] = to_transfer[1];
+   after_transfer[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+   after_transfer[1].dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+   after_transfer[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+   after_transfer[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+   m_device_data.disp.CmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                         VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0,
+                                         nullptr, 0, nullptr, 2, after_transfer);
+
+   TRY_LOG(m_device_data.disp.EndCommandBuffer(command_buffer), "Failed to record GPU copy");
+   return VK_SUCCESS;
 }
 
 void swapchain::present_image(const pending_present_request &pending_present)
@@ -486,28 +762,33 @@ void swapchain::present_image(const pending_present_request &pending_present)
    auto image_data = reinterpret_cast<x11_image_data *>(m_swapchain_images[pending_present.image_index].data);
    auto thread_status_lock = std::unique_lock<std::mutex>(m_thread_status_lock);
 
-   while (image_data->pending_completions.size() == X11_SWAPCHAIN_MAX_PENDING_COMPLETIONS)
+   /* Demand refresh presents from vkQueuePresentKHR, before anything waited for the frame to be rendered. */
+   if (m_present_mode == VK_PRESENT_MODE_SHARED_DEMAND_REFRESH_KHR)
    {
-      if (!m_present_event_thread_run)
-      {
-         if (m_device_data.is_present_id_enabled())
-         {
-            auto *ext = get_swapchain_extension<wsi_ext_present_id>(true);
-            ext->set_present_id(pending_present.present_id);
-         }
-         return unpresent_image(pending_present.image_index);
-      }
-      m_thread_status_cond.wait(thread_status_lock);
+      image_wait_present(m_swapchain_images[pending_present.image_index], UINT64_MAX);
    }
 
    m_send_sbc++;
    uint32_t serial = (uint32_t)m_send_sbc;
 
-   VkResult present_result = m_shm_presenter->present_image(image_data, serial);
+   VkResult present_result = m_shm_presenter->present_image(image_data, serial, pending_present.damage_rects.data(),
+                                                            pending_present.damage_rect_count, m_present_mode);
    if (present_result != VK_SUCCESS)
    {
       WSI_LOG_ERROR("Failed to present image using presentation strategy: %d", present_result);
+      /* Reported by the next acquire, which also stops continuous refresh from retrying a broken window. */
+      set_error_state(present_result == VK_ERROR_SURFACE_LOST_KHR || present_result == VK_ERROR_DEVICE_LOST ?
+                         present_result :
+                         VK_ERROR_OUT_OF_DATE_KHR);
+   }
+
+#if VULKAN_WSI_LAYER_EXPERIMENTAL
+   auto *present_timing = get_swapchain_extension<wsi_ext_present_timing_x11>();
+   if (present_timing != nullptr)
+   {
+      present_timing->set_refresh_duration(m_shm_presenter->get_refresh_duration_ns());
    }
+#endif
 
    if (m_device_data.is_present_id_enabled())
    {
@@ -521,7 +802,11 @@ void swapchain::present_image(const pending_present_request &pending_present)
    if (present_result == VK_SUCCESS)
    {
       image_index_to_unpresent = pending_present.image_index;
-      should_unpresent = true;
+      /* A zero-copy image goes back to the application only once the server stopped reading it. The application
+       * writes a shared image while it is presented anyway. */
+      image_data->held_by_server = m_page_flip_run && !is_shared_present_mode(m_present_mode) &&
+                                   !m_shm_presenter->is_image_released(image_data);
+      should_unpresent = !image_data->held_by_server;
    }
    else
    {
@@ -578,7 +863,7 @@ VkResult swapchain::get_free_buffer(uint64_t *timeout)
    {
       while (!free_image_found())
       {
-         if (!m_present_event_thread_run)
+         if (error_has_occured())
             return VK_ERROR_OUT_OF_DATE_KHR;
 
          m_thread_status_cond.wait(thread_status_lock);
@@ -590,7 +875,7 @@ VkResult swapchain::get_free_buffer(uint64_t *timeout)
 
       while (!free_image_found())
       {
-         if (!m_present_event_thread_run)
+         if (error_has_occured())
             return VK_ERROR_OUT_OF_DATE_KHR;
 
          if (m_thread_status_cond.wait_until(thread_status_lock, time_point) == std::cv_status::timeout)
@@ -606,6 +891,13 @@ VkResult swapchain::get_free_buffer(uint64_t *timeout)
 
 void swapchain::destroy_image(wsi::swapchain_image &image)
 {
+   auto data = reinterpret_cast<x11_image_data *>(image.data);
+   if (data != nullptr && data->copy_command_buffer != VK_NULL_HANDLE)
+   {
+      /* The copy of the last present may still be reading the image. */
+      image_wait_present(image, UINT64_MAX);
+   }
+
    std::unique_lock<std::recursive_mutex> image_status_lock(m_image_status_mutex);
    if (image.status != wsi::swapchain_image::INVALID)
    {
@@ -620,15 +912,31 @@ void swapchain::destroy_image(wsi::swapchain_image &image)
 
    image_status_lock.unlock();
 
-   if (image.data != nullptr)
+   if (data != nullptr)
    {
-      auto data = reinterpret_cast<x11_image_data *>(image.data);
-
-      if (m_shm_presenter && data != nullptr)
+      if (m_shm_presenter)
       {
+         if (data->zero_copy)
+         {
+            /* The imported memory must not outlive the segment backing it. */
+            data->external_mem.release_host_memory();
+         }
          m_shm_presenter->destroy_image_resources(data);
       }
 
+      if (data->copy_command_buffer != VK_NULL_HANDLE)
+      {
+         m_device_data.disp.FreeCommandBuffers(m_device, m_copy_command_pool, 1, &data->copy_command_buffer);
+      }
+      if (data->staging_image != VK_NULL_HANDLE)
+      {
+         m_device_data.disp.DestroyImage(m_device, data->staging_image, get_allocation_callbacks());
+      }
+      if (data->render_memory != VK_NULL_HANDLE)
+      {
+         m_device_data.disp.FreeMemory(m_device, data->render_memory, get_allocation_callbacks());
+      }
+
       m_allocator.destroy(1, data);
       image.data = nullptr;
    }
@@ -638,13 +946,108 @@ VkResult swapchain::image_set_present_payload(swapchain_image &image, VkQueue qu
                                               const queue_submit_semaphores &semaphores, const void *submission_pnext)
 {
    auto data = reinterpret_cast<x11_image_data *>(image.data);
-   return data->present_fence.set_payload(queue, semaphores, submission_pnext);
+   /* A sync file only outlives its payload when waiting for it failed, the swapchain is then in an error state. */
+   data->present_fence_fd = util::fd_owner();
+   return data->present_fence.set_payload(queue, semaphores, submission_pnext, data->copy_command_buffer);
 }
 
 VkResult swapchain::image_wait_present(swapchain_image &image, uint64_t timeout)
 {
    auto data = reinterpret_cast<x11_image_data *>(image.data);
-   return data->present_fence.wait_payload(timeout);
+   if (!data->present_fence_fd.is_valid())
+   {
+      return data->present_fence.wait_payload(timeout);
+   }
+
+   /* The payload moved into the sync file when page flipping exported it. */
+   const uint64_t timeout_ms = timeout / 1000000 + (timeout % 1000000 != 0 ? 1 : 0);
+   pollfd fence_poll = { data->present_fence_fd.get(), POLLIN, 0 };
+   int res;
+   do
+   {
+      res = poll(&fence_poll, 1, timeout_ms > INT_MAX ? -1 : static_cast<int>(timeout_ms));
+   } while (res < 0 && errno == EINTR);
+
+   if (res == 0)
+   {
+      return VK_TIMEOUT;
+   }
+   if (res < 0)
+   {
+      WSI_LOG_ERROR("Failed to wait for the present fence sync file: %s", strerror(errno));
+      return VK_ERROR_DEVICE_LOST;
+   }
+
+   data->present_fence_fd = util::fd_owner();
+   return VK_SUCCESS;
+}
+
+VkResult swapchain::image_poll_present(swapchain_image &image, present_wait &wait)
+{
+   auto data = reinterpret_cast<x11_image_data *>(image.data);
+   if (!data->present_fence_fd.is_valid())
+   {
+      const VkResult result = data->present_fence.wait_payload(0);
+      if (result != VK_TIMEOUT)
+      {
+         return result;
+      }
+
+      auto fence_fd = data->present_fence.export_sync_fd();
+      if (!fence_fd.has_value())
+      {
+         WSI_LOG_WARNING("Failed to export the present fence, polling it instead");
+         return swapchain_base::image_poll_present(image, wait);
+      }
+      if (!fence_fd->is_valid())
+      {
+         /* Signalled since the wait above. */
+         return VK_SUCCESS;
+      }
+      data->present_fence_fd = std::move(*fence_fd);
+   }
+
+   const VkResult result = image_wait_present(image, 0);
+   if (result == VK_TIMEOUT)
+   {
+      wait.add_fd(data->present_fence_fd.get());
+      return VK_NOT_READY;
+   }
+   return result;
+}
+
+bool swapchain::poll_presentation_engine(present_wait &wait)
+{
+   const bool ready = m_shm_presenter->poll_ready(m_present_mode, wait);
+
+   std::unique_lock<std::recursive_mutex> image_status_lock(m_image_status_mutex);
+   bool holding = false;
+   for (uint32_t i = 0; i < m_swapchain_images.size(); i++)
+   {
+      auto data = reinterpret_cast<x11_image_data *>(m_swapchain_images[i].data);
+      if (data == nullptr || !data->held_by_server)
+      {
+         continue;
+      }
+
+      if (m_shm_presenter->is_image_released(data))
+      {
+         data->held_by_server = false;
+         unpresent_image(i);
+      }
+      else
+      {
+         holding = true;
+      }
+   }
+
+   image_status_lock.unlock();
+
+   if (holding)
+   {
+      m_shm_presenter->wait_for_events(wait);
+   }
+   return ready;
 }
 
 VkResult swapchain::bind_swapchain_image(VkDevice &device, const VkBindImageMemoryInfo *bind_image_mem_info,
@@ -653,6 +1056,10 @@ VkResult swapchain::bind_swapchain_image(VkDevice &device, const VkBindImageMemo
    UNUSED(device);
    const wsi::swapchain_image &swapchain_image = m_swapchain_images[bind_sc_info->imageIndex];
    auto image_data = reinterpret_cast<x11_image_data *>(swapchain_image.data);
+   if (image_data->render_memory != VK_NULL_HANDLE)
+   {
+      return m_device_data.disp.BindImageMemory(m_device, bind_image_mem_info->image, image_data->render_memory, 0);
+   }
    return image_data->external_mem.bind_swapchain_image_memory(bind_image_mem_info->image);
 }
 
@@ -669,6 +1076,24 @@ VkResult swapchain::add_required_extensions(VkDevice device, const VkSwapchainCr
       }
    }
 
+   if (m_device_data.is_swapchain_maintenance1_enabled())
+   {
+      if (!add_swapchain_extension(m_allocator.make_unique<wsi_ext_swapchain_maintenance1>(m_allocator)))
+      {
+         return VK_ERROR_OUT_OF_HOST_MEMORY;
+      }
+   }
+
+#if VULKAN_WSI_LAYER_EXPERIMENTAL
+   if (swapchain_create_info->flags & VK_SWAPCHAIN_CREATE_PRESENT_TIMING_BIT_EXT)
+   {
+      if (!add_swapchain_extension(wsi_ext_present_timing_x11::create(m_allocator)))
+      {
+         return VK_ERROR_OUT_OF_HOST_MEMORY;
+      }
+   }
+#endif
+
    return VK_SUCCESS;
 }
 
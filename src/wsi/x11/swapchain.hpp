@@ -61,13 +61,6 @@ namespace wsi
 namespace x11
 {
 
-struct pending_completion
-{
-   uint32_t serial;
-   uint64_t present_id;
-   std::optional<std::chrono::steady_clock::time_point> timestamp;
-};
-
 struct x11_image_data
 {
    x11_image_data(const VkDevice &device, const util::allocator &allocator)
@@ -77,25 +70,44 @@ struct x11_image_data
 
    external_memory external_mem;
    xcb_pixmap_t pixmap = XCB_PIXMAP_NONE;
-   std::vector<pending_completion> pending_completions;
 
-   fence_sync present_fence;
+   sync_fd_fence_sync present_fence;
 
+   /* Sync file exported from present_fence while page flipping waits for its payload, see image_poll_present(). */
+   util::fd_owner present_fence_fd;
+
+   /* Segment backing a zero-copy image, copied frames go through the presenter's staging ring instead. */
    xcb_shm_seg_t shm_seg = XCB_NONE;
-   int shm_id = -1;
    void *shm_addr = nullptr;
    size_t shm_size = 0;
 
-   xcb_shm_seg_t shm_seg_alt = XCB_NONE;
-   int shm_id_alt = -1;
-   void *shm_addr_alt = nullptr;
-   bool use_alt_buffer = false;
+   /* Pixmap over shm_seg, only when presenting through the Present extension. */
+   xcb_pixmap_t shm_pixmap = XCB_PIXMAP_NONE;
 
    uint32_t width = 0;
    uint32_t height = 0;
    uint32_t stride = 0;
    int depth = 0;
 
+   /* The SHM segment is imported as the image memory, so presenting needs no CPU copy. */
+   bool zero_copy = false;
+
+   /* Round trip queued behind the SHM puts of a zero-copy image, without the Present extension. */
+   xcb_get_input_focus_cookie_t read_cookie = {};
+   bool read_pending = false;
+
+   /* Presented zero-copy image the server may still read, given back once it is done, see
+    * poll_presentation_engine(). */
+   bool held_by_server = false;
+
+   /*
+    * With GPU copies the application renders to an optimal image backed by render_memory, and each present submits
+    * copy_command_buffer to copy it into staging_image, the linear image external_mem backs and the presenter reads.
+    */
+   VkDeviceMemory render_memory = VK_NULL_HANDLE;
+   VkImage staging_image = VK_NULL_HANDLE;
+   VkCommandBuffer copy_command_buffer = VK_NULL_HANDLE;
+
    void *cpu_buffer = nullptr;
    size_t cpu_buffer_size = 0;
 
@@ -194,6 +206,17 @@ protected:
 
    VkResult image_wait_present(swapchain_image &image, uint64_t timeout) override;
 
+   /**
+    * @brief Exports the pending present payload as a sync file for page flipping to wait on.
+    */
+   VkResult image_poll_present(swapchain_image &image, present_wait &wait) override;
+
+   /**
+    * @brief Handles the server's events, gives back the zero-copy images it released and checks that the presenter
+    *        can take a frame without blocking.
+    */
+   bool poll_presentation_engine(present_wait &wait) override;
+
    /**
     * @brief Bind image to a swapchain
     *
@@ -237,6 +260,35 @@ protected:
 
 private:
    VkResult allocate_image(VkImageCreateInfo &image_create_info, x11_image_data *image_data);
+
+   /**
+    * @brief Creates an image whose memory is an imported SHM segment.
+    *
+    * @return VK_SUCCESS on success. On failure the caller must release any partially created resources.
+    */
+   VkResult create_zero_copy_image(VkImageCreateInfo image_create_info, swapchain_image &image,
+                                   x11_image_data *image_data);
+
+   /**
+    * @brief Set up copying presented images on the GPU, when enabled with MALI_WRAPPER_X11_GPU_COPY=1.
+    *
+    * Applications then render to optimal images, which Mali can compress, instead of linear host-visible ones.
+    */
+   VkResult init_gpu_copy(const VkSwapchainCreateInfoKHR *swapchain_create_info);
+
+   /**
+    * @brief Creates an optimal image in device memory, with a linear host-visible image to copy it into.
+    *
+    * @return VK_SUCCESS on success. On failure the caller must release any partially created resources.
+    */
+   VkResult create_gpu_copy_image(VkImageCreateInfo image_create_info, swapchain_image &image,
+                                  x11_image_data *image_data);
+
+   /**
+    * @brief Record the commands copying @p image into the image's staging image, submitted on every present.
+    */
+   VkResult record_gpu_copy(VkImage image, const VkImageCreateInfo &image_create_info, x11_image_data *image_data);
+
    VkResult allocate_wsialloc(VkImageCreateInfo &image_create_info, x11_image_data *image_data,
                               util::vector<wsialloc_format> &importable_formats, wsialloc_format *allocated_format,
                               bool avoid_allocation);
@@ -258,6 +310,21 @@ private:
     */
    std::unique_ptr<shm_presenter> m_shm_presenter;
 
+   /**
+    * @brief minImportedHostPointerAlignment of the device, or 0 when zero-copy presentation is not used.
+    */
+   VkDeviceSize m_host_pointer_alignment = 0;
+
+   /**
+    * @brief Pool of the per-image copy commands, VK_NULL_HANDLE when applications render to linear images.
+    */
+   VkCommandPool m_copy_command_pool = VK_NULL_HANDLE;
+
+   /**
+    * @brief Format of the staging images, a channel swap of the image format when the GPU copy converts it.
+    */
+   VkFormat m_staging_format = VK_FORMAT_UNDEFINED;
+
    /**
     * @brief Image creation parameters used for all swapchain images.
     */
@@ -282,9 +349,6 @@ private:
 
    VkPhysicalDeviceMemoryProperties2 m_memory_props;
 
-   void present_event_thread();
-   bool m_present_event_thread_run;
-   std::thread m_present_event_thread;
    std::mutex m_thread_status_lock;
    std::condition_variable m_thread_status_cond;
    util::ring_buffer<xcb_pixmap_t, 6> m_free_buffer_pool;
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file window_visibility.cpp
+ *
+ * @brief Tracking of whether an X11 window can currently be seen, to stop copying frames nobody looks at.
+ */
+
+#include "window_visibility.hpp"
+#include "utils/logging.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+namespace wsi
+{
+namespace x11
+{
+
+static xcb_atom_t get_atom_reply(xcb_connection_t *connection, xcb_intern_atom_cookie_t cookie)
+{
+   xcb_atom_t atom = XCB_ATOM_NONE;
+   if (auto *reply = xcb_intern_atom_reply(connection, cookie, nullptr))
+   {
+      atom = reply->atom;
+      free(reply);
+   }
+   return atom;
+}
+
+void window_visibility::init(xcb_connection_t *connection, xcb_window_t window)
+{
+   m_connection = connection;
+   m_window = window;
+
+   static const char wm_state_name[] = "_NET_WM_STATE";
+   static const char wm_state_hidden_name[] = "_NET_WM_STATE_HIDDEN";
+   const auto wm_state_cookie = xcb_intern_atom(m_connection, 0, strlen(wm_state_name), wm_state_name);
+   const auto wm_state_hidden_cookie =
+      xcb_intern_atom(m_connection, 0, strlen(wm_state_hidden_name), wm_state_hidden_name);
+
+   /* Selected before the state is queried, so a change in between is not missed. */
+   const uint32_t event_mask =
+      XCB_EVENT_MASK_STRUCTURE_NOTIFY | XCB_EVENT_MASK_VISIBILITY_CHANGE | XCB_EVENT_MASK_PROPERTY_CHANGE;
+   xcb_change_window_attributes(m_connection, m_window, XCB_CW_EVENT_MASK, &event_mask);
+   const auto attributes_cookie = xcb_get_window_attributes(m_connection, m_window);
+
+   m_wm_state_atom = get_atom_reply(m_connection, wm_state_cookie);
+   m_wm_state_hidden_atom = get_atom_reply(m_connection, wm_state_hidden_cookie);
+
+   if (auto *attributes = xcb_get_window_attributes_reply(m_connection, attributes_cookie, nullptr))
+   {
+      m_unmapped = attributes->map_state != XCB_MAP_STATE_VIEWABLE;
+      free(attributes);
+   }
+
+   update_wm_state();
+}
+
+void window_visibility::update_wm_state()
+{
+   if (m_wm_state_atom == XCB_ATOM_NONE || m_wm_state_hidden_atom == XCB_ATOM_NONE)
+   {
+      return;
+   }
+
+   /* Window managers set few states, 32 atoms is plenty. */
+   auto *reply = xcb_get_property_reply(
+      m_connection, xcb_get_property(m_connection, 0, m_window, m_wm_state_atom, XCB_ATOM_ATOM, 0, 32), nullptr);
+   if (reply == nullptr)
+   {
+      return;
+   }
+
+   bool hidden = false;
+   const auto *atoms = static_cast<const xcb_atom_t *>(xcb_get_property_value(reply));
+   const int count = xcb_get_property_value_length(reply) / static_cast<int>(sizeof(xcb_atom_t));
+   for (int i = 0; i < count && !hidden; i++)
+   {
+      hidden = atoms[i] == m_wm_state_hidden_atom;
+   }
+   free(reply);
+
+   m_hidden = hidden;
+}
+
+void window_visibility::handle_event(const xcb_generic_event_t *event)
+{
+   if (m_connection == nullptr)
+   {
+      return;
+   }
+
+   switch (event->response_type & ~0x80)
+   {
+   case XCB_MAP_NOTIFY:
+      if (reinterpret_cast<const xcb_map_notify_event_t *>(event)->window == m_window)
+      {
+         m_unmapped = false;
+      }
+      break;
+   case XCB_UNMAP_NOTIFY:
+      if (reinterpret_cast<const xcb_unmap_notify_event_t *>(event)->window == m_window)
+      {
+         m_unmapped = true;
+      }
+      break;
+   case XCB_VISIBILITY_NOTIFY:
+   {
+      const auto *visibility = reinterpret_cast<const xcb_visibility_notify_event_t *>(event);
+      if (visibility->window == m_window)
+      {
+         m_obscured = visibility->state == XCB_VISIBILITY_FULLY_OBSCURED;
+      }
+      break;
+   }
+   case XCB_PROPERTY_NOTIFY:
+   {
+      const auto *property = reinterpret_cast<const xcb_property_notify_event_t *>(event);
+      if (property->window == m_window && property->atom == m_wm_state_atom)
+      {
+         update_wm_state();
+      }
+      break;
+   }
+   default:
+      break;
+   }
+}
+
+} /* namespace x11 */
+} /* namespace wsi */
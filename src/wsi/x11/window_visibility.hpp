@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2025 Arm Limited.
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file window_visibility.hpp
+ *
+ * @brief Tracking of whether an X11 window can currently be seen, to stop copying frames nobody looks at.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <xcb/xcb.h>
+
+namespace wsi
+{
+namespace x11
+{
+
+/**
+ * @brief Follows the map state, the obscured state and the _NET_WM_STATE_HIDDEN flag of a window.
+ *
+ * Event masks are per client, so the events are selected on a connection of our own to leave the application's mask
+ * alone. Events are fed in by whoever reads that connection.
+ *
+ * Compositing managers redirect windows offscreen, where the server reports them unobscured whatever covers them;
+ * minimised and unmapped windows are still noticed.
+ *
+ * Owned by the surface, whose connection must stay valid for its whole lifetime. is_visible() may be called from any
+ * thread, events must be handled by one thread at a time.
+ */
+class window_visibility
+{
+public:
+   /**
+    * @brief Select the window's events on @p connection and query its current state.
+    *
+    * @param connection Connection the application does not use.
+    * @param window     Window to follow.
+    */
+   void init(xcb_connection_t *connection, xcb_window_t window);
+
+   /**
+    * @brief Update the state from an event read off the connection, other events are ignored.
+    */
+   void handle_event(const xcb_generic_event_t *event);
+
+   /**
+    * @brief Whether any part of the window may be on screen, always true unless initialised.
+    */
+   bool is_visible() const
+   {
+      return !m_unmapped.load(std::memory_order_relaxed) && !m_obscured.load(std::memory_order_relaxed) &&
+             !m_hidden.load(std::memory_order_relaxed);
+   }
+
+private:
+   /**
+    * @brief Read _NET_WM_STATE and look for _NET_WM_STATE_HIDDEN, a round trip.
+    */
+   void update_wm_state();
+
+   xcb_connection_t *m_connection = nullptr;
+   xcb_window_t m_window = XCB_NONE;
+   xcb_atom_t m_wm_state_atom = XCB_ATOM_NONE;
+   xcb_atom_t m_wm_state_hidden_atom = XCB_ATOM_NONE;
+
+   std::atomic<bool> m_unmapped{ false };
+   std::atomic<bool> m_obscured{ false };
+   std::atomic<bool> m_hidden{ false };
+};
+
+} /* namespace x11 */
+} /* namespace wsi */